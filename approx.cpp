@@ -0,0 +1,434 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "approx.h"
+#include "ir.h"
+#include "dsl.h"
+
+struct ApproxContext
+{
+    ir_kernel_t     kernel;
+    variable_t*     vars;           // shallow copy of expr->vars, var_id value is changed
+    int             var_id;
+
+    double          tolerance;
+    size_t          max_degree;
+
+    double*         nodes;          // function in max_degree + 1 Chebyshev nodes
+    double*         cheb;           // Chebyshev coefficients
+    double*         check;          // function on check grid
+    double*         prev;           // T_{k-1}, T_k and their sum in monomials of t
+    double*         cur;
+    double*         mono;
+    double*         coeffs;         // mono scaled to (var - center)
+};
+
+static ExpressionErrors ApproxContextCtor(ApproxContext* ctx, const expr_t* expr, const int var_id,
+                                          const double tolerance, const size_t max_degree, error_t* error);
+static void             ApproxContextDtor(ApproxContext* ctx);
+
+static double   CalculateFunction(ApproxContext* ctx, const double x, error_t* error);
+static double   CalculateHorner(const double* coeffs, const size_t degree, const double center, const double x);
+
+static bool     FitPiece(ApproxContext* ctx, const double left, const double right, approx_piece_t* piece,
+                         error_t* error);
+static void     Approximate(ApproxContext* ctx, approx_t* approx, const double left, const double right,
+                            const int depth, error_t* error);
+
+static void     AddPiece(approx_t* approx, approx_piece_t* piece, error_t* error);
+static expr_t*  MakeHornerExpression(const ApproxContext* ctx, const variable_t* vars, const size_t vars_amt,
+                                     const approx_piece_t* piece, error_t* error);
+
+//------------------------------------------------------------------
+
+static ExpressionErrors ApproxContextCtor(ApproxContext* ctx, const expr_t* expr, const int var_id,
+                                          const double tolerance, const size_t max_degree, error_t* error)
+{
+    assert(ctx);
+    assert(expr);
+    assert(error);
+
+    ctx->var_id     = var_id;
+    ctx->tolerance  = tolerance;
+    ctx->max_degree = max_degree;
+
+    size_t amt = max_degree + 1;
+
+    ctx->vars   = (variable_t*) calloc(expr->max_vars_amt, sizeof(variable_t));
+    ctx->nodes  = (double*)     calloc(amt, sizeof(double));
+    ctx->cheb   = (double*)     calloc(amt, sizeof(double));
+    ctx->check  = (double*)     calloc(APPROX_CHECK_POINTS, sizeof(double));
+    ctx->prev   = (double*)     calloc(amt, sizeof(double));
+    ctx->cur    = (double*)     calloc(amt, sizeof(double));
+    ctx->mono   = (double*)     calloc(amt, sizeof(double));
+    ctx->coeffs = (double*)     calloc(amt, sizeof(double));
+
+    if (ctx->vars == nullptr || ctx->nodes == nullptr || ctx->cheb == nullptr || ctx->check == nullptr ||
+        ctx->prev == nullptr || ctx->cur == nullptr   || ctx->mono == nullptr || ctx->coeffs == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "APPROXIMATION";
+        return ExpressionErrors::ALLOCATE_MEMORY;
+    }
+
+    memcpy(ctx->vars, expr->vars, expr->max_vars_amt * sizeof(variable_t));
+
+    return IrKernelCtor(&ctx->kernel, &expr, 1, error);
+}
+
+//------------------------------------------------------------------
+
+static void ApproxContextDtor(ApproxContext* ctx)
+{
+    assert(ctx);
+
+    IrKernelDtor(&ctx->kernel);
+
+    free(ctx->vars);
+    free(ctx->nodes);
+    free(ctx->cheb);
+    free(ctx->check);
+    free(ctx->prev);
+    free(ctx->cur);
+    free(ctx->mono);
+    free(ctx->coeffs);
+}
+
+//------------------------------------------------------------------
+
+static double CalculateFunction(ApproxContext* ctx, const double x, error_t* error)
+{
+    assert(ctx);
+    assert(error);
+
+    double result = NAN;
+
+    ctx->vars[ctx->var_id].value = x;
+    IrKernelCalculate(&ctx->kernel, ctx->vars, &result, error);
+
+    if (error->code == (int) ExpressionErrors::NONE && !isfinite(result))
+    {
+        error->code = (int) ExpressionErrors::INVALID_EXPRESSION_FORMAT;
+        error->data = "APPROXIMATION RANGE";
+    }
+
+    return result;
+}
+
+//------------------------------------------------------------------
+
+// same operations in the same order as expression from MakeHornerExpression
+static double CalculateHorner(const double* coeffs, const size_t degree, const double center, const double x)
+{
+    assert(coeffs);
+
+    double shift  = x - center;
+    double result = coeffs[degree];
+
+    for (size_t k = degree; k-- > 0; )
+        result = result * shift + coeffs[k];
+
+    return result;
+}
+
+//------------------------------------------------------------------
+
+// true if tolerance is met, piece gets lowest such degree or the most accurate one
+static bool FitPiece(ApproxContext* ctx, const double left, const double right, approx_piece_t* piece,
+                     error_t* error)
+{
+    assert(ctx);
+    assert(piece);
+    assert(error);
+
+    size_t amt    = ctx->max_degree + 1;
+    double center = (left + right) / 2;
+    double half   = (right - left) / 2;
+
+    for (size_t j = 0; j < amt && error->code == (int) ExpressionErrors::NONE; j++)
+    {
+        double x      = center + half * cos(M_PI * ((double) j + 0.5) / (double) amt);
+        ctx->nodes[j] = CalculateFunction(ctx, x, error);
+    }
+
+    for (size_t i = 0; i < APPROX_CHECK_POINTS && error->code == (int) ExpressionErrors::NONE; i++)
+    {
+        double x      = left + (right - left) * (double) i / (APPROX_CHECK_POINTS - 1);
+        ctx->check[i] = CalculateFunction(ctx, x, error);
+    }
+
+    if (error->code != (int) ExpressionErrors::NONE)
+        return false;
+
+    for (size_t k = 0; k < amt; k++)
+    {
+        double sum = 0;
+
+        for (size_t j = 0; j < amt; j++)
+            sum += ctx->nodes[j] * cos(M_PI * (double) k * ((double) j + 0.5) / (double) amt);
+
+        ctx->cheb[k] = ((k == 0) ? 1.0 : 2.0) * sum / (double) amt;
+    }
+
+    // partial sums of series are converted to monomials of t = (var - center) / half degree by degree
+    memset(ctx->prev, 0, amt * sizeof(double));
+    memset(ctx->cur,  0, amt * sizeof(double));
+    memset(ctx->mono, 0, amt * sizeof(double));
+
+    piece->left      = left;
+    piece->right     = right;
+    piece->center    = center;
+    piece->max_error = INFINITY;
+
+    bool met = false;
+
+    for (size_t n = 0; n < amt && !met; n++)
+    {
+        if (n == 0)
+            ctx->cur[0] = 1;
+        else if (n == 1)
+        {
+            ctx->prev[0] = 1;
+            ctx->cur[0]  = 0;
+            ctx->cur[1]  = 1;
+        }
+        else
+        {
+            // T_n = 2t * T_{n-1} - T_{n-2}
+            for (size_t k = n; k > 0; k--)
+            {
+                double next  = 2 * ctx->cur[k - 1] - ctx->prev[k];
+                ctx->prev[k] = ctx->cur[k];
+                ctx->cur[k]  = next;
+            }
+
+            double next  = -ctx->prev[0];
+            ctx->prev[0] = ctx->cur[0];
+            ctx->cur[0]  = next;
+        }
+
+        double scale = 1;
+        for (size_t k = 0; k <= n; k++)
+        {
+            ctx->mono[k]  += ctx->cheb[n] * ctx->cur[k];
+            ctx->coeffs[k] = ctx->mono[k] / scale;
+            scale         *= half;
+        }
+
+        double max_error = 0;
+        for (size_t i = 0; i < APPROX_CHECK_POINTS; i++)
+        {
+            double x     = left + (right - left) * (double) i / (APPROX_CHECK_POINTS - 1);
+            double delta = fabs(CalculateHorner(ctx->coeffs, n, center, x) - ctx->check[i]);
+
+            if (delta > max_error)
+                max_error = delta;
+        }
+
+        if (max_error < piece->max_error)
+        {
+            piece->max_error = max_error;
+            piece->degree    = n;
+            memcpy(piece->coeffs, ctx->coeffs, (n + 1) * sizeof(double));
+        }
+
+        met = (max_error <= ctx->tolerance);
+    }
+
+    return met;
+}
+
+//------------------------------------------------------------------
+
+static void AddPiece(approx_t* approx, approx_piece_t* piece, error_t* error)
+{
+    assert(approx);
+    assert(piece);
+    assert(error);
+
+    if (approx->pieces_amt == approx->capacity)
+    {
+        size_t          capacity = (approx->capacity == 0) ? 4 : approx->capacity * 2;
+        approx_piece_t* pieces   = (approx_piece_t*) realloc(approx->pieces, capacity * sizeof(approx_piece_t));
+        if (pieces == nullptr)
+        {
+            error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+            error->data = "APPROXIMATION PIECES";
+            return;
+        }
+
+        approx->pieces   = pieces;
+        approx->capacity = capacity;
+    }
+
+    approx->pieces[approx->pieces_amt++] = *piece;
+
+    if (piece->max_error > approx->max_error)
+        approx->max_error = piece->max_error;
+}
+
+//------------------------------------------------------------------
+
+static expr_t* MakeHornerExpression(const ApproxContext* ctx, const variable_t* vars, const size_t vars_amt,
+                                    const approx_piece_t* piece, error_t* error)
+{
+    assert(ctx);
+    assert(vars);
+    assert(piece);
+    assert(error);
+
+    expr_t* poly = MakeExpression(error, vars_amt);
+    if (error->code != (int) ExpressionErrors::NONE)
+        return nullptr;
+
+    CopyVariablesArray(vars, poly->vars, error);
+    if (error->code != (int) ExpressionErrors::NONE)
+        return poly;
+
+    Node* root = _NUM(piece->coeffs[piece->degree]);
+
+    for (size_t k = piece->degree; k-- > 0; )
+    {
+        root = _ADD(_MUL(root, _SUB(_VAR(ctx->var_id), _NUM(piece->center))), _NUM(piece->coeffs[k]));
+    }
+
+    DestructNodes(poly->root);
+    poly->root = root;
+
+    return poly;
+}
+
+//------------------------------------------------------------------
+
+static void Approximate(ApproxContext* ctx, approx_t* approx, const double left, const double right,
+                        const int depth, error_t* error)
+{
+    assert(ctx);
+    assert(approx);
+    assert(error);
+
+    approx_piece_t piece = {};
+
+    piece.coeffs = (double*) calloc(ctx->max_degree + 1, sizeof(double));
+    if (piece.coeffs == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "APPROXIMATION PIECES";
+        return;
+    }
+
+    bool met = FitPiece(ctx, left, right, &piece, error);
+
+    if (error->code == (int) ExpressionErrors::NONE && (met || depth == APPROX_MAX_DEPTH))
+    {
+        AddPiece(approx, &piece, error);
+        if (error->code == (int) ExpressionErrors::NONE)
+            return;
+    }
+
+    free(piece.coeffs);
+
+    if (error->code != (int) ExpressionErrors::NONE)
+        return;
+
+    double middle = (left + right) / 2;
+
+    Approximate(ctx, approx, left,   middle, depth + 1, error);
+    if (error->code == (int) ExpressionErrors::NONE)
+        Approximate(ctx, approx, middle, right, depth + 1, error);
+}
+
+//------------------------------------------------------------------
+
+ExpressionErrors ApproximationCtor(approx_t* approx, const expr_t* expr, const char* var,
+                                   const double left, const double right, const double tolerance,
+                                   const size_t max_degree, error_t* error)
+{
+    assert(approx);
+    assert(expr);
+    assert(var);
+    assert(error);
+    assert(left < right);
+    assert(tolerance > 0);
+    assert(max_degree <= APPROX_MAX_DEGREE);
+
+    memset(approx, 0, sizeof(approx_t));
+
+    int var_id = FindVariableAmongSaved(expr->vars, var);
+    if (var_id == NO_VARIABLE)
+    {
+        error->code = (int) ExpressionErrors::NO_DIFF_VARIABLE;
+        error->data = var;
+        return ExpressionErrors::NO_DIFF_VARIABLE;
+    }
+
+    approx->var_id = var_id;
+
+    ApproxContext ctx = {};
+
+    if (ApproxContextCtor(&ctx, expr, var_id, tolerance, max_degree, error) == ExpressionErrors::NONE)
+        Approximate(&ctx, approx, left, right, 0, error);
+
+    for (size_t i = 0; i < approx->pieces_amt && error->code == (int) ExpressionErrors::NONE; i++)
+        approx->pieces[i].poly = MakeHornerExpression(&ctx, expr->vars, expr->max_vars_amt,
+                                                      &approx->pieces[i], error);
+
+    ApproxContextDtor(&ctx);
+
+    if (error->code != (int) ExpressionErrors::NONE)
+        ApproximationDtor(approx);
+
+    return (ExpressionErrors) error->code;
+}
+
+//------------------------------------------------------------------
+
+void ApproximationDtor(approx_t* approx)
+{
+    assert(approx);
+
+    for (size_t i = 0; i < approx->pieces_amt; i++)
+    {
+        free(approx->pieces[i].coeffs);
+
+        if (approx->pieces[i].poly != nullptr)
+        {
+            ExpressionDtor(approx->pieces[i].poly);
+            free(approx->pieces[i].poly);
+        }
+    }
+
+    free(approx->pieces);
+
+    approx->pieces     = nullptr;
+    approx->pieces_amt = 0;
+    approx->capacity   = 0;
+    approx->max_error  = 0;
+}
+
+//------------------------------------------------------------------
+
+double CalculateApproximation(const approx_t* approx, const double x)
+{
+    assert(approx);
+    assert(approx->pieces_amt > 0);
+
+    // first piece with x <= right, the last one if there is no such
+    size_t lo = 0;
+    size_t hi = approx->pieces_amt - 1;
+
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+
+        if (x <= approx->pieces[mid].right)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+
+    const approx_piece_t* piece = &approx->pieces[lo];
+
+    return CalculateHorner(piece->coeffs, piece->degree, piece->center, x);
+}
@@ -0,0 +1,53 @@
+#ifndef __APPROX_H_
+#define __APPROX_H_
+
+#include "expression/expression.h"
+
+// ======================================================================
+// POLYNOMIAL APPROXIMATION
+// ======================================================================
+
+// expression of one variable (others keep their values) is interpolated in Chebyshev nodes,
+// series is cut to the lowest degree that meets tolerance on dense check grid; if no degree
+// up to max_degree does, range is halved, so result is piecewise
+
+static const size_t APPROX_MAX_DEGREE       = 32;
+static const size_t APPROX_CHECK_POINTS     = 2048;
+static const int    APPROX_MAX_DEPTH        = 12;       // at most 2^depth pieces
+
+struct ApproxPiece
+{
+    double      left;
+    double      right;
+
+    double      center;
+    double*     coeffs;             // of (var - center)^k, degree + 1 of them
+    size_t      degree;
+
+    expr_t*     poly;               // same polynomial in Horner form
+    double      max_error;          // on check grid
+};
+typedef struct ApproxPiece approx_piece_t;
+
+struct Approximation
+{
+    int                 var_id;
+
+    approx_piece_t*     pieces;     // sorted, adjacent
+    size_t              pieces_amt;
+    size_t              capacity;
+
+    double              max_error;  // over all pieces, may exceed tolerance only at depth limit
+};
+typedef struct Approximation approx_t;
+
+// function must be finite on [left, right], otherwise INVALID_EXPRESSION_FORMAT
+ExpressionErrors    ApproximationCtor(approx_t* approx, const expr_t* expr, const char* var,
+                                      const double left, const double right, const double tolerance,
+                                      const size_t max_degree, error_t* error);
+void                ApproximationDtor(approx_t* approx);
+
+// value of piece containing x, outer pieces are extrapolated
+double              CalculateApproximation(const approx_t* approx, const double x);
+
+#endif
@@ -0,0 +1,362 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "broadcast.h"
+#include "columns.h"
+#include "ir.h"
+
+struct BroadcastProgram
+{
+    const ir_t*         ir;
+    const variable_t*   vars;
+    MathTier            tier;
+
+    int                 direct;         // output operator writing to result in place or NO_IR_VALUE
+    bool*               uniform;        // does not depend on arrays, calculated once
+
+    const double**      values;         // current chunk of every instruction
+    double*             scratch;        // COLUMNS_CHUNK_ROWS for every instruction
+    double*             zeros;          // operand of unary operators
+};
+
+static bool     IsArrayVariable(const variable_t* var);
+static double   GetScalarValue(const variable_t* var);
+
+static void     CollectBroadcastSize(const Node* node, const variable_t* vars, size_t* size, bool* found,
+                                     error_t* error);
+
+static void     ClassifyBroadcast(BroadcastProgram* prog);
+static void     CalculateBroadcastUniform(BroadcastProgram* prog, error_t* error);
+static void     CalculateBroadcastChunk(BroadcastProgram* prog, double* result, const size_t start,
+                                        const size_t amt, error_t* error);
+
+static ExpressionErrors BroadcastProgramCtor(BroadcastProgram* prog, const size_t instr_amt, error_t* error);
+static void             BroadcastProgramDtor(BroadcastProgram* prog);
+
+//------------------------------------------------------------------
+
+static bool IsArrayVariable(const variable_t* var)
+{
+    assert(var);
+
+    return var->array != nullptr && var->array_size != 1;
+}
+
+//------------------------------------------------------------------
+
+static double GetScalarValue(const variable_t* var)
+{
+    assert(var);
+
+    return (var->array != nullptr) ? var->array[0] : var->value;
+}
+
+//------------------------------------------------------------------
+
+ExpressionErrors SetVariableArray(variable_t* vars, const char* name, const double* array, const size_t size,
+                                  error_t* error)
+{
+    assert(vars);
+    assert(name);
+    assert(error);
+    assert(array || size == 0);
+
+    int id = FindVariableAmongSaved(vars, name);
+    if (id == NO_VARIABLE)
+    {
+        error->code = (int) ExpressionErrors::NO_DIFF_VARIABLE;
+        error->data = name;
+        return ExpressionErrors::NO_DIFF_VARIABLE;
+    }
+
+    vars[id].array      = array;
+    vars[id].array_size = (array != nullptr) ? size : 0;
+
+    return ExpressionErrors::NONE;
+}
+
+//------------------------------------------------------------------
+
+static void CollectBroadcastSize(const Node* node, const variable_t* vars, size_t* size, bool* found,
+                                 error_t* error)
+{
+    assert(vars);
+    assert(size);
+    assert(found);
+    assert(error);
+
+    if (node == nullptr || error->code != (int) ExpressionErrors::NONE)
+        return;
+
+    if (node->type == NodeType::VARIABLE)
+    {
+        const variable_t* var = &vars[node->value.var];
+
+        if (!IsArrayVariable(var))
+            return;
+
+        if (!*found)
+        {
+            *size  = var->array_size;
+            *found = true;
+        }
+        else if (*size != var->array_size)
+        {
+            error->code = (int) ExpressionErrors::SIZE_MISMATCH;
+            error->data = var->variable_name;
+        }
+
+        return;
+    }
+
+    CollectBroadcastSize(node->left,  vars, size, found, error);
+    CollectBroadcastSize(node->right, vars, size, found, error);
+}
+
+//------------------------------------------------------------------
+
+ExpressionErrors GetBroadcastSize(const expr_t* expr, const variable_t* vars, size_t* size, error_t* error)
+{
+    assert(expr);
+    assert(vars);
+    assert(size);
+    assert(error);
+
+    bool found = false;
+
+    *size = 1;
+    CollectBroadcastSize(expr->root, vars, size, &found, error);
+
+    return (ExpressionErrors) error->code;
+}
+
+//------------------------------------------------------------------
+
+static ExpressionErrors BroadcastProgramCtor(BroadcastProgram* prog, const size_t instr_amt, error_t* error)
+{
+    assert(prog);
+    assert(error);
+
+    prog->uniform = (bool*)          calloc(instr_amt + 1, sizeof(bool));
+    prog->values  = (const double**) calloc(instr_amt + 1, sizeof(double*));
+    prog->scratch = (double*)        calloc((instr_amt + 1) * COLUMNS_CHUNK_ROWS, sizeof(double));
+    prog->zeros   = (double*)        calloc(COLUMNS_CHUNK_ROWS, sizeof(double));
+
+    if (prog->uniform == nullptr || prog->values == nullptr || prog->scratch == nullptr || prog->zeros == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "BROADCAST PROGRAM";
+        return ExpressionErrors::ALLOCATE_MEMORY;
+    }
+
+    return ExpressionErrors::NONE;
+}
+
+//------------------------------------------------------------------
+
+static void BroadcastProgramDtor(BroadcastProgram* prog)
+{
+    assert(prog);
+
+    free(prog->uniform);
+    free(prog->values);
+    free(prog->scratch);
+    free(prog->zeros);
+}
+
+//------------------------------------------------------------------
+
+static void ClassifyBroadcast(BroadcastProgram* prog)
+{
+    assert(prog);
+
+    const ir_t* ir = prog->ir;
+
+    for (size_t i = 0; i < ir->size; i++)
+    {
+        const IrInstruction* instr = &ir->code[i];
+
+        switch (instr->type)
+        {
+            case (NodeType::VARIABLE):
+                prog->uniform[i] = !IsArrayVariable(&prog->vars[instr->value.var]);
+                break;
+
+            case (NodeType::OPERATOR):
+                prog->uniform[i] = (instr->left  == NO_IR_VALUE || prog->uniform[instr->left]) &&
+                                   (instr->right == NO_IR_VALUE || prog->uniform[instr->right]);
+                break;
+
+            case (NodeType::NUMBER):
+            case (NodeType::POISON):
+            default:
+                prog->uniform[i] = true;
+                break;
+        }
+    }
+
+    int id = ir->outputs[0];
+
+    prog->direct = NO_IR_VALUE;
+    if (id != NO_IR_VALUE && !prog->uniform[id] && ir->code[id].type == NodeType::OPERATOR)
+        prog->direct = id;
+}
+
+//------------------------------------------------------------------
+
+static void CalculateBroadcastUniform(BroadcastProgram* prog, error_t* error)
+{
+    assert(prog);
+    assert(error);
+
+    const ir_t* ir = prog->ir;
+
+    for (size_t i = 0; i < ir->size; i++)
+    {
+        if (!prog->uniform[i])
+            continue;
+
+        const IrInstruction* instr = &ir->code[i];
+        double*              dest  = prog->scratch + i * COLUMNS_CHUNK_ROWS;
+
+        prog->values[i] = dest;
+
+        switch (instr->type)
+        {
+            case (NodeType::NUMBER):
+                for (size_t elem = 0; elem < COLUMNS_CHUNK_ROWS; elem++)
+                    dest[elem] = instr->value.val;
+                break;
+
+            case (NodeType::VARIABLE):
+            {
+                double value = GetScalarValue(&prog->vars[instr->value.var]);
+
+                for (size_t elem = 0; elem < COLUMNS_CHUNK_ROWS; elem++)
+                    dest[elem] = value;
+                break;
+            }
+
+            case (NodeType::OPERATOR):
+            {
+                const double* left  = (instr->left  != NO_IR_VALUE) ? prog->values[instr->left]  : prog->zeros;
+                const double* right = (instr->right != NO_IR_VALUE) ? prog->values[instr->right] : prog->zeros;
+
+                CalculateColumnOperation(instr->value.opt, left, right, dest, COLUMNS_CHUNK_ROWS, prog->tier, error);
+                break;
+            }
+
+            case (NodeType::POISON):
+            default:
+                error->code = (int) ExpressionErrors::INVALID_EXPRESSION_FORMAT;
+                break;
+        }
+
+        if (error->code != (int) ExpressionErrors::NONE)
+            return;
+    }
+}
+
+//------------------------------------------------------------------
+
+static void CalculateBroadcastChunk(BroadcastProgram* prog, double* result, const size_t start,
+                                    const size_t amt, error_t* error)
+{
+    assert(prog);
+    assert(result);
+    assert(error);
+
+    const ir_t* ir = prog->ir;
+
+    for (size_t i = 0; i < ir->size; i++)
+    {
+        if (prog->uniform[i])
+            continue;
+
+        const IrInstruction* instr = &ir->code[i];
+        double*              dest  = prog->scratch + i * COLUMNS_CHUNK_ROWS;
+
+        if (instr->type == NodeType::VARIABLE)
+        {
+            prog->values[i] = prog->vars[instr->value.var].array + start;
+            continue;
+        }
+
+        if ((int) i == prog->direct)
+            dest = result + start;
+
+        const double* left  = (instr->left  != NO_IR_VALUE) ? prog->values[instr->left]  : prog->zeros;
+        const double* right = (instr->right != NO_IR_VALUE) ? prog->values[instr->right] : prog->zeros;
+
+        CalculateColumnOperation(instr->value.opt, left, right, dest, amt, prog->tier, error);
+        if (error->code != (int) ExpressionErrors::NONE)
+            return;
+
+        prog->values[i] = dest;
+    }
+
+    if (prog->direct == NO_IR_VALUE)
+    {
+        int id = ir->outputs[0];
+
+        memcpy(result + start, (id != NO_IR_VALUE) ? prog->values[id] : prog->zeros, amt * sizeof(double));
+    }
+}
+
+//------------------------------------------------------------------
+
+ExpressionErrors CalculateExpressionArray(const expr_t* expr, const variable_t* vars, double* result,
+                                          const size_t result_size, error_t* error)
+{
+    return CalculateExpressionArray(expr, vars, result, result_size, MathTier::LIBM, error);
+}
+
+//------------------------------------------------------------------
+
+ExpressionErrors CalculateExpressionArray(const expr_t* expr, const variable_t* vars, double* result,
+                                          const size_t result_size, const MathTier tier, error_t* error)
+{
+    assert(expr);
+    assert(vars);
+    assert(result || result_size == 0);
+    assert(error);
+
+    size_t size = 0;
+
+    if (GetBroadcastSize(expr, vars, &size, error) != ExpressionErrors::NONE)
+        return (ExpressionErrors) error->code;
+
+    if (size != result_size)
+    {
+        error->code = (int) ExpressionErrors::SIZE_MISMATCH;
+        error->data = "RESULT";
+        return ExpressionErrors::SIZE_MISMATCH;
+    }
+
+    ir_kernel_t      kernel = {};
+    BroadcastProgram prog   = {};
+
+    if (IrKernelCtor(&kernel, &expr, 1, error)                 == ExpressionErrors::NONE &&
+        BroadcastProgramCtor(&prog, kernel.ir.size, error)    == ExpressionErrors::NONE)
+    {
+        prog.ir   = &kernel.ir;
+        prog.vars = vars;
+        prog.tier = tier;
+
+        ClassifyBroadcast(&prog);
+        CalculateBroadcastUniform(&prog, error);
+
+        for (size_t start = 0; start < size && error->code == (int) ExpressionErrors::NONE;
+             start += COLUMNS_CHUNK_ROWS)
+        {
+            size_t amt = (size - start < COLUMNS_CHUNK_ROWS) ? size - start : COLUMNS_CHUNK_ROWS;
+
+            CalculateBroadcastChunk(&prog, result, start, amt, error);
+        }
+    }
+
+    BroadcastProgramDtor(&prog);
+    IrKernelDtor(&kernel);
+
+    return (ExpressionErrors) error->code;
+}
@@ -0,0 +1,30 @@
+#ifndef __BROADCAST_H_
+#define __BROADCAST_H_
+
+#include "expression/expression.h"
+#include "math_tiers.h"
+
+// ======================================================================
+// ARRAY VARIABLES
+// ======================================================================
+
+// variable with array != nullptr holds array_size values, others are scalars; every operator
+// broadcasts like NumPy: scalars and arrays of size 1 are repeated for each element,
+// other arrays must have the same size, which becomes size of result
+
+// data is not copied and must outlive calculations, nullptr makes variable scalar again
+ExpressionErrors SetVariableArray(variable_t* vars, const char* name, const double* array, const size_t size,
+                                  error_t* error);
+
+// size of result for variables used in expr, SIZE_MISMATCH if they can not be broadcast
+ExpressionErrors GetBroadcastSize(const expr_t* expr, const variable_t* vars, size_t* size, error_t* error);
+
+// result must have GetBroadcastSize elements; calculated in one pass of chunks,
+// subexpressions of scalars only once
+ExpressionErrors CalculateExpressionArray(const expr_t* expr, const variable_t* vars, double* result,
+                                          const size_t result_size, error_t* error);
+// same with math functions of given tier
+ExpressionErrors CalculateExpressionArray(const expr_t* expr, const variable_t* vars, double* result,
+                                          const size_t result_size, const MathTier tier, error_t* error);
+
+#endif
@@ -2,6 +2,7 @@
 #include <string.h>
 
 #include "calculation.h"
+#include "taylor.h"
 #include "expression/visual.h"
 #include "expression/expr_output.h"
 #include "common/input_and_output.h"
@@ -41,13 +42,18 @@
 
 static const double EPSILON  = 1e-9;
 
-static double CalculateExpressionSubtree(const expr_t* expr, Node* root, error_t* error);
+template <typename T>
+static T CalculateExpressionSubtree(const variable_t* vars, Node* root, error_t* error);
 
-static double OperatorAction(const double NUMBER_1, const double NUMBER_2,
-                                      const Operators operation, error_t* error);
+template <typename T>
+static T OperatorAction(const T NUMBER_1, const T NUMBER_2, const Operators operation, error_t* error);
 
 static bool AreEqual(const double a, const double b);
 
+static dual_t DualOperatorAction(const dual_t left, const dual_t right, const Operators operation,
+                                 error_t* error);
+static dual_t CalculateDualSubtree(const variable_t* vars, const Node* node, const int var_id, error_t* error);
+
 static void UniteExpressionSubtree(expr_t* expr, Node* node, error_t* error);
 
 // ======================================================================
@@ -77,7 +83,7 @@ static expr_t* DifferentiateExpression(const expr_t* expr, const int var_id, err
 static expr_t* MakeExpressionWithSameVars(const expr_t* expr, const char* var, int* id, error_t* error);
 static expr_t* MakeExpressionWithSameVars(const expr_t* expr, error_t* error);
 
-static inline int Factorial(const int n);
+static void    PrintSymbolicDerivatives(expr_t* expr, const int var_id, const int n, error_t* error, FILE* fp);
 
 static void    CalculateLinearParams(const expr_t* expr, const int var_id, double* tang, double* b,
                                      error_t* error, FILE* fp = nullptr);
@@ -97,19 +103,25 @@ static bool AreEqual(const double a, const double b)
 
 //------------------------------------------------------------------
 
+// actions mix T with double constants, so result is cast back to T
+
 #define DEF_OP(name, symb, priority, arg_amt, action, ...)      \
             case (Operators::name):                             \
-                return action;                                  \
+                return (T) (action);                            \
 
-static double OperatorAction(const double NUMBER_1, const double NUMBER_2,
-                                      const Operators operation, error_t* error)
+template <typename T>
+static T OperatorAction(const T NUMBER_1, const T NUMBER_2, const Operators operation, error_t* error)
 {
+    // pi in arccot action is double, so it is taken in T
+    if (operation == Operators::ARCCOT)
+        return acos((T) -1) / 2 - atan(NUMBER_2);
+
     switch (operation)
     {
         #include "operations.h"
         default:
             error->code = (int) ExpressionErrors::UNKNOWN_OPERATION;
-            return POISON;
+            return (T) POISON;
     }
 }
 
@@ -117,17 +129,37 @@ static double OperatorAction(const double NUMBER_1, const double NUMBER_2,
 
 //------------------------------------------------------------------
 
-static double CalculateExpressionSubtree(const expr_t* expr, Node* node, error_t* error)
+double CalculateOperation(const double left, const double right, const Operators operation, error_t* error)
 {
-    assert(expr);
+    assert(error);
+
+    return OperatorAction<double>(left, right, operation, error);
+}
+
+//:::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <typename T>
+T CalculateOperationAs(const T left, const T right, const Operators operation, error_t* error)
+{
+    assert(error);
+
+    return OperatorAction<T>(left, right, operation, error);
+}
+
+//------------------------------------------------------------------
+
+template <typename T>
+static T CalculateExpressionSubtree(const variable_t* vars, Node* node, error_t* error)
+{
+    assert(vars);
     assert(error);
 
     if (!node) return 0;
 
     if (node->left == nullptr && node->right == nullptr)
     {
-        if (TYPE(node) == NodeType::NUMBER)             return VAL(node);
-        else if (TYPE(node) == NodeType::VARIABLE)      return expr->vars[VAR(node)].value;
+        if (TYPE(node) == NodeType::NUMBER)             return (T) VAL(node);
+        else if (TYPE(node) == NodeType::VARIABLE)      return (T) vars[VAR(node)].value;
         else
         {
             error->code = (int) ExpressionErrors::INVALID_EXPRESSION_FORMAT;
@@ -135,8 +167,8 @@ static double CalculateExpressionSubtree(const expr_t* expr, Node* node, error_t
         }
     }
 
-    double left_result  = CalculateExpressionSubtree(expr, node->left, error);
-    double right_result = CalculateExpressionSubtree(expr, node->right, error);
+    T left_result  = CalculateExpressionSubtree<T>(vars, node->left, error);
+    T right_result = CalculateExpressionSubtree<T>(vars, node->right, error);
 
     if (TYPE(node) != NodeType::OPERATOR)
     {
@@ -144,12 +176,12 @@ static double CalculateExpressionSubtree(const expr_t* expr, Node* node, error_t
         return 0;
     }
 
-    double result = OperatorAction(left_result, right_result, OPT(node), error);
+    T result = OperatorAction<T>(left_result, right_result, OPT(node), error);
 
     if (error->code == (int) ExpressionErrors::NONE)
         return result;
     else
-        return POISON;
+        return (T) POISON;
 
 }
 
@@ -160,7 +192,154 @@ double CalculateExpression(const expr_t* expr, error_t* error)
     assert(error);
     assert(expr);
 
-    return CalculateExpressionSubtree(expr, expr->root, error);
+    return CalculateExpressionSubtree<double>(expr->vars, expr->root, error);
+}
+
+//:::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+double CalculateExpression(const expr_t* expr, const variable_t* vars, error_t* error)
+{
+    assert(error);
+    assert(expr);
+    assert(vars);
+
+    return CalculateExpressionSubtree<double>(vars, expr->root, error);
+}
+
+//:::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+template <typename T>
+T CalculateExpressionAs(const expr_t* expr, const variable_t* vars, error_t* error)
+{
+    assert(error);
+    assert(expr);
+    assert(vars);
+
+    return CalculateExpressionSubtree<T>(vars, expr->root, error);
+}
+
+template float       CalculateExpressionAs<float>(const expr_t* expr, const variable_t* vars, error_t* error);
+template double      CalculateExpressionAs<double>(const expr_t* expr, const variable_t* vars, error_t* error);
+template long double CalculateExpressionAs<long double>(const expr_t* expr, const variable_t* vars, error_t* error);
+
+template float       CalculateOperationAs<float>(const float left, const float right,
+                                                 const Operators operation, error_t* error);
+template double      CalculateOperationAs<double>(const double left, const double right,
+                                                  const Operators operation, error_t* error);
+template long double CalculateOperationAs<long double>(const long double left, const long double right,
+                                                       const Operators operation, error_t* error);
+
+//:::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+long double CalculateExpression(const expr_t* expr, const variable_t* vars, const ScalarType type, error_t* error)
+{
+    assert(error);
+    assert(expr);
+    assert(vars);
+
+    switch (type)
+    {
+        case (ScalarType::FLOAT):
+            return CalculateExpressionAs<float>(expr, vars, error);
+        case (ScalarType::DOUBLE):
+            return CalculateExpressionAs<double>(expr, vars, error);
+        case (ScalarType::LONG_DOUBLE):
+            return CalculateExpressionAs<long double>(expr, vars, error);
+        default:
+            error->code = (int) ExpressionErrors::UNKNOWN;
+            return POISON;
+    }
+}
+
+//------------------------------------------------------------------
+
+#define DEF_OP(name, symb, priority, arg_amt, action, gnu_symb, type, tex_symb,                       \
+               need_left_brackets, left_is_figure, need_right_brackets, right_is_figure, diff,        \
+               partial_1, partial_2, ...)                                                             \
+            case (Operators::name):                                                                 \
+                return (kid == NodeKid::LEFT) ? (partial_1) : (partial_2);                          \
+
+double CalculatePartial(const double NUMBER_1, const double NUMBER_2, const double RESULT,
+                        const Operators operation, const NodeKid kid, error_t* error)
+{
+    assert(error);
+
+    switch (operation)
+    {
+        #include "operations.h"
+        default:
+            error->code = (int) ExpressionErrors::UNKNOWN_OPERATION;
+            return POISON;
+    }
+}
+
+#undef DEF_OP
+
+//------------------------------------------------------------------
+
+// term of operand with zero derivative is skipped, so pow by constant does not take log of negative base
+static dual_t DualOperatorAction(const dual_t left, const dual_t right, const Operators operation,
+                                 error_t* error)
+{
+    assert(error);
+
+    double result     = CalculateOperation(left.val, right.val, operation, error);
+    double derivative = 0;
+
+    if (fpclassify(left.der) != FP_ZERO)
+        derivative += left.der * CalculatePartial(left.val, right.val, result, operation, NodeKid::LEFT, error);
+    if (fpclassify(right.der) != FP_ZERO)
+        derivative += right.der * CalculatePartial(left.val, right.val, result, operation, NodeKid::RIGHT, error);
+
+    return {result, derivative};
+}
+
+//------------------------------------------------------------------
+
+static dual_t CalculateDualSubtree(const variable_t* vars, const Node* node, const int var_id, error_t* error)
+{
+    assert(vars);
+    assert(error);
+
+    if (!node) return {0, 0};
+
+    if (node->left == nullptr && node->right == nullptr)
+    {
+        if (TYPE(node) == NodeType::NUMBER)             return {VAL(node), 0};
+        else if (TYPE(node) == NodeType::VARIABLE)      return {vars[VAR(node)].value, (VAR(node) == var_id) ? 1.0 : 0};
+        else
+        {
+            error->code = (int) ExpressionErrors::INVALID_EXPRESSION_FORMAT;
+            return {0, 0};
+        }
+    }
+
+    dual_t left_result  = CalculateDualSubtree(vars, node->left, var_id, error);
+    dual_t right_result = CalculateDualSubtree(vars, node->right, var_id, error);
+
+    if (TYPE(node) != NodeType::OPERATOR)
+    {
+        error->code = (int) ExpressionErrors::INVALID_EXPRESSION_FORMAT;
+        return {0, 0};
+    }
+
+    dual_t result = DualOperatorAction(left_result, right_result, OPT(node), error);
+
+    if (error->code == (int) ExpressionErrors::NONE)
+        return result;
+    else
+        return {POISON, POISON};
+}
+
+//------------------------------------------------------------------
+
+dual_t CalculateExpressionDual(const expr_t* expr, const variable_t* vars, const int var_id, error_t* error)
+{
+    assert(expr);
+    assert(vars);
+    assert(error);
+
+    return CalculateDualSubtree(vars, expr->root, var_id, error);
 }
 
 //------------------------------------------------------------------
@@ -221,7 +400,7 @@ static void UniteExpressionSubtree(expr_t* expr, Node* node, error_t* error)
     assert(expr);
     assert(error);
 
-    double num = CalculateExpressionSubtree(expr, node, error);
+    double num = CalculateExpressionSubtree<double>(expr->vars, node, error);
     if (error->code != (int) ExpressionErrors::NONE)
         return;
 
@@ -721,20 +900,40 @@ static expr_t* DifferentiateExpression(const expr_t* expr, const int var_id, err
 
 //------------------------------------------------------------------
 
-static inline int Factorial(const int n)
+// only shows derivatives, their values are not used
+static void PrintSymbolicDerivatives(expr_t* expr, const int var_id, const int n, error_t* error, FILE* fp)
 {
-    if (!n) return 1;
+    assert(expr);
+    assert(error);
 
-    if (n < 0) return -1;
+    if (fp == nullptr)
+        return;
 
-    int result = 1;
+    expr_t* derivative = expr;
 
-    for (int i = 2; i <= n; i++)
+    for (int i = 1; i <= n; i++)
     {
-        result *= i;
+        PRINT(fp, "We need to differentiate this:\n");
+        PRINT_EXPR(fp, derivative);
+
+        expr_t* next = DifferentiateExpression(derivative, var_id, error, fp);
+
+        if (derivative != expr)
+        {
+            ExpressionDtor(derivative);
+            free(derivative);
+        }
+
+        derivative = next;
+        if (error->code != (int) ExpressionErrors::NONE)
+            break;
     }
 
-    return result;
+    if (derivative != nullptr && derivative != expr)
+    {
+        ExpressionDtor(derivative);
+        free(derivative);
+    }
 }
 
 //------------------------------------------------------------------
@@ -745,6 +944,13 @@ expr_t* TaylorSeries(expr_t* expr, const int n, const char* var, const double va
     assert(expr);
     assert(error);
 
+    if (n < 0)
+    {
+        error->code = (int) ExpressionErrors::INVALID_ORDER;
+        error->data = "TAYLOR SERIES";
+        return nullptr;
+    }
+
     PRINT(fp, "Lets find Taylor series of:\n");
     PRINT_EXPR(fp, expr);
 
@@ -756,29 +962,42 @@ expr_t* TaylorSeries(expr_t* expr, const int n, const char* var, const double va
     double prev_val          = expr->vars[var_id].value;
     expr->vars[var_id].value = val;
 
-    expr_t* diff_expr     = expr;
-    double  calc          = CalculateExpressionSubtree(diff_expr, diff_expr->root, error);
-    Node*   taylor_series = _NUM(0);
+    double* coeffs = (double*) calloc((size_t) n + 1, sizeof(double));
+    if (coeffs == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "TAYLOR DERIVATIVES";
+        return nullptr;
+    }
+
+    // coefficients of every order come from series arithmetic, so they do not depend on n;
+    // symbolic derivatives grow exponentially and are only shown for low orders
+    if (n <= TAYLOR_SYMBOLIC_MAX_ORDER)
+        PrintSymbolicDerivatives(expr, var_id, n, error, fp);
+    else
+        PRINT(fp, "Differentiating it so many times is boring, so we will find coefficients by series.\n");
+
+    if (error->code == (int) ExpressionErrors::NONE)
+        CalculateTaylorCoefficients(expr, expr->vars, var, val, (size_t) n, coeffs, error);
+
+    if (error->code != (int) ExpressionErrors::NONE)
+    {
+        free(coeffs);
+        return nullptr;
+    }
+
+    Node* taylor_series = _NUM(0);
 
     for (int i = 0; i <= n; i++)
     {
         taylor_series = _ADD(taylor_series,
-                             _MUL(_DIV(_NUM(calc), _NUM((double) Factorial(i))),
+                             _MUL(_NUM(coeffs[i]),
                                   _DEG(_SUB(_VAR(var_id), _NUM(expr->vars[var_id].value)),
                                        _NUM((double) i))));
-
-        PRINT(fp, "We need to differentiate this:\n");
-        PRINT_EXPR(fp, diff_expr);
-
-        diff_expr = DifferentiateExpression(diff_expr, var_id, error, fp);
-        if (error->code != (int) ExpressionErrors::NONE)
-            return nullptr;
-
-        calc = CalculateExpressionSubtree(diff_expr, diff_expr->root, error);
-        if (error->code != (int) ExpressionErrors::NONE)
-            return nullptr;
     }
 
+    free(coeffs);
+
     new_expr->root = taylor_series;
 
     SimplifyExpression(new_expr, error, fp);
@@ -876,25 +1095,20 @@ static void CalculateLinearParams(const expr_t* expr, const int var_id, double*
 
     PRINT(fp, "We must differentiate expression to find tangent parameters.\n")
 
-    expr_t* d_expr   = DifferentiateExpression(expr, var_id, error, fp);
+    // only derivative value is needed, so it goes through the tree together with function value
+    dual_t result = CalculateExpressionDual(expr, expr->vars, var_id, error);
     if (error->code != (int) ExpressionErrors::NONE) return;
 
     PrintInfixExpression(stdout, expr);
-    PrintInfixExpression(stdout, d_expr);
 
-    double  tan      = CalculateExpressionSubtree(d_expr, d_expr->root, error);
-    if (error->code != (int) ExpressionErrors::NONE) return;
-
-    double  func_val = CalculateExpressionSubtree(expr, expr->root, error);
-    if (error->code != (int) ExpressionErrors::NONE) return;
+    double  func_val = result.val;
+    double  tan      = result.der;
 
     printf("%lg %lg\n", tan, func_val);
 
     *b    = func_val - (tan * expr->vars[var_id].value);
     *tang = tan;
 
-    ExpressionDtor(d_expr);
-
     return;
 }
 
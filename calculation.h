@@ -4,11 +4,57 @@
 #include "expression/expression.h"
 
 double CalculateExpression(const expr_t* expr, error_t* error);
+double CalculateExpression(const expr_t* expr, const variable_t* vars, error_t* error);
+double CalculateOperation(const double left, const double right, const Operators operation, error_t* error);
+
+// partial of operator's action by its left or right operand, result is value of the action;
+// unary operators have only right operand
+double CalculatePartial(const double left, const double right, const double result, const Operators operation,
+                        const NodeKid kid, error_t* error);
+
+// same evaluator in other precision; constants and variables are stored in double and rounded on load
+
+enum class ScalarType
+{
+    FLOAT,
+    DOUBLE,
+    LONG_DOUBLE,
+};
+
+template <typename T>
+T           CalculateExpressionAs(const expr_t* expr, const variable_t* vars, error_t* error);
+template <typename T>
+T           CalculateOperationAs(const T left, const T right, const Operators operation, error_t* error);
+
+extern template float       CalculateExpressionAs<float>(const expr_t*, const variable_t*, error_t*);
+extern template double      CalculateExpressionAs<double>(const expr_t*, const variable_t*, error_t*);
+extern template long double CalculateExpressionAs<long double>(const expr_t*, const variable_t*, error_t*);
+
+extern template float       CalculateOperationAs<float>(const float, const float, const Operators, error_t*);
+extern template double      CalculateOperationAs<double>(const double, const double, const Operators, error_t*);
+extern template long double CalculateOperationAs<long double>(const long double, const long double,
+                                                              const Operators, error_t*);
+
+long double CalculateExpression(const expr_t* expr, const variable_t* vars, const ScalarType type, error_t* error);
+
+// forward mode: value and derivative by one variable go through the tree together,
+// rules are partials of operators from operations.h
+
+struct Dual
+{
+    double val;
+    double der;
+};
+typedef struct Dual dual_t;
+
+// one pass without allocations; var_id = NO_VARIABLE gives zero derivative
+dual_t      CalculateExpressionDual(const expr_t* expr, const variable_t* vars, const int var_id, error_t* error);
 
 void SimplifyExpression(expr_t* expr, error_t* error, FILE* fp = nullptr);
 
 expr_t* DifferentiateExpression(const expr_t* expr, const char* var, error_t* error, FILE* fp = nullptr);
 
+// n < 0 is INVALID_ORDER
 expr_t* TaylorSeries(expr_t* expr, const int n, const char* var, const double val, error_t* error, FILE* fp = nullptr);
 
 expr_t* GetExpressionsDifference(expr_t* expr_1, expr_t* expr_2, error_t* error, FILE* fp = nullptr);
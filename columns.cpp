@@ -0,0 +1,662 @@
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "columns.h"
+#include "ir.h"
+#include "calculation.h"
+
+struct ColumnsProgram
+{
+    const ir_t*             ir;
+    const double*           var_values;
+    const int*              var_columns;
+    MathTier                tier;
+
+    const columns_file_t*   in;
+    const columns_file_t*   out;
+
+    int*                    in_column;      // column of every variable instruction
+    int*                    out_column;     // output column operator writes in place
+    bool*                   uniform;        // does not depend on columns, calculated once
+
+    const double**          values;         // current chunk of every instruction
+    double*                 scratch;        // COLUMNS_CHUNK_ROWS for every instruction
+    double*                 zeros;          // operand of unary operators
+};
+
+static size_t   ColumnTypeSize(const ColumnType type);
+static size_t   AlignOffset(const size_t offset);
+static bool     CheckColumnsLayout(const columns_file_t* file);
+
+static void     ClassifyInstructions(ColumnsProgram* prog);
+static void     CalculateUniform(ColumnsProgram* prog, error_t* error);
+static void     CalculateChunk(ColumnsProgram* prog, const size_t start, const size_t amt, error_t* error);
+static void     WriteChunkOutputs(ColumnsProgram* prog, const size_t start, const size_t amt);
+
+static ExpressionErrors ColumnsProgramCtor(ColumnsProgram* prog, const size_t instr_amt, error_t* error);
+static void             ColumnsProgramDtor(ColumnsProgram* prog);
+
+//------------------------------------------------------------------
+
+static size_t ColumnTypeSize(const ColumnType type)
+{
+    switch (type)
+    {
+        case (ColumnType::FLOAT64):
+            return sizeof(double);
+        case (ColumnType::FLOAT32):
+            return sizeof(float);
+        default:
+            return 0;
+    }
+}
+
+//------------------------------------------------------------------
+
+static size_t AlignOffset(const size_t offset)
+{
+    return (offset + COLUMNS_ALIGNMENT - 1) / COLUMNS_ALIGNMENT * COLUMNS_ALIGNMENT;
+}
+
+//------------------------------------------------------------------
+
+static bool CheckColumnsLayout(const columns_file_t* file)
+{
+    assert(file);
+
+    if (file->size < sizeof(ColumnsHeader))
+        return false;
+
+    const ColumnsHeader* header = (const ColumnsHeader*) file->data;
+
+    if (memcmp(header->magic, COLUMNS_MAGIC, sizeof(COLUMNS_MAGIC)) != 0 || header->version != COLUMNS_VERSION)
+        return false;
+
+    if ((file->size - sizeof(ColumnsHeader)) / sizeof(ColumnDescriptor) < header->columns_amt)
+        return false;
+
+    const ColumnDescriptor* columns = (const ColumnDescriptor*) (file->data + sizeof(ColumnsHeader));
+
+    for (uint32_t i = 0; i < header->columns_amt; i++)
+    {
+        size_t elem_size = ColumnTypeSize(columns[i].type);
+
+        // sizes are compared by division, so huge rows amount does not overflow
+        if (elem_size == 0 || columns[i].offset % elem_size != 0 || columns[i].offset > file->size ||
+            (file->size - columns[i].offset) / elem_size < header->rows_amt)
+            return false;
+
+        if (memchr(columns[i].name, '\0', MAX_COLUMN_NAME_LEN) == nullptr)
+            return false;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------
+
+void ColumnsFileOpen(columns_file_t* file, const char* name, error_t* error)
+{
+    assert(file);
+    assert(name);
+    assert(error);
+
+    *file    = {};
+    file->fd = open(name, O_RDONLY);
+
+    struct stat info = {};
+
+    if (file->fd < 0 || fstat(file->fd, &info) != 0)
+    {
+        ColumnsFileClose(file);
+
+        error->code = (int) ERRORS::OPEN_FILE;
+        error->data = name;
+        return;
+    }
+
+    file->size = (size_t) info.st_size;
+
+    if (file->size > 0)
+    {
+        void* data = mmap(nullptr, file->size, PROT_READ, MAP_PRIVATE, file->fd, 0);
+
+        if (data != MAP_FAILED)
+        {
+            file->data = (unsigned char*) data;
+            madvise(data, file->size, MADV_SEQUENTIAL);
+        }
+    }
+
+    if (file->data == nullptr || !CheckColumnsLayout(file))
+    {
+        ColumnsFileClose(file);
+
+        error->code = (int) ERRORS::READ_FILE;
+        error->data = name;
+        return;
+    }
+
+    file->header  = (const ColumnsHeader*)    file->data;
+    file->columns = (const ColumnDescriptor*) (file->data + sizeof(ColumnsHeader));
+}
+
+//------------------------------------------------------------------
+
+void ColumnsFileCreate(columns_file_t* file, const char* name, const char* const* column_names,
+                       const ColumnType* types, const size_t columns_amt, const size_t rows_amt, error_t* error)
+{
+    assert(file);
+    assert(name);
+    assert(column_names);
+    assert(types);
+    assert(error);
+
+    *file = {};
+
+    size_t size = AlignOffset(sizeof(ColumnsHeader) + columns_amt * sizeof(ColumnDescriptor));
+
+    for (size_t i = 0; i < columns_amt; i++)
+        size = AlignOffset(size + rows_amt * ColumnTypeSize(types[i]));
+
+    file->fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if (file->fd < 0 || ftruncate(file->fd, (off_t) size) != 0)
+    {
+        ColumnsFileClose(file);
+
+        error->code = (int) ERRORS::OPEN_FILE;
+        error->data = name;
+        return;
+    }
+
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file->fd, 0);
+    if (data == MAP_FAILED)
+    {
+        ColumnsFileClose(file);
+
+        error->code = (int) ERRORS::OPEN_FILE;
+        error->data = name;
+        return;
+    }
+
+    file->data = (unsigned char*) data;
+    file->size = size;
+
+    ColumnsHeader*    header  = (ColumnsHeader*)    file->data;
+    ColumnDescriptor* columns = (ColumnDescriptor*) (file->data + sizeof(ColumnsHeader));
+
+    memcpy(header->magic, COLUMNS_MAGIC, sizeof(COLUMNS_MAGIC));
+    header->version     = COLUMNS_VERSION;
+    header->columns_amt = (uint32_t) columns_amt;
+    header->rows_amt    = rows_amt;
+
+    size_t offset = AlignOffset(sizeof(ColumnsHeader) + columns_amt * sizeof(ColumnDescriptor));
+
+    for (size_t i = 0; i < columns_amt; i++)
+    {
+        strncpy(columns[i].name, column_names[i], MAX_COLUMN_NAME_LEN - 1);
+        columns[i].type   = types[i];
+        columns[i].offset = offset;
+
+        offset = AlignOffset(offset + rows_amt * ColumnTypeSize(types[i]));
+    }
+
+    file->header  = header;
+    file->columns = columns;
+}
+
+//------------------------------------------------------------------
+
+void ColumnsFileClose(columns_file_t* file)
+{
+    assert(file);
+
+    if (file->data != nullptr)
+        munmap(file->data, file->size);
+
+    if (file->fd >= 0)
+        close(file->fd);
+
+    *file    = {};
+    file->fd = -1;
+}
+
+//------------------------------------------------------------------
+
+int FindColumn(const columns_file_t* file, const char* name)
+{
+    assert(file);
+    assert(name);
+
+    for (uint32_t i = 0; i < file->header->columns_amt; i++)
+        if (!strncmp(file->columns[i].name, name, MAX_COLUMN_NAME_LEN))
+            return (int) i;
+
+    return NO_COLUMN;
+}
+
+//------------------------------------------------------------------
+
+// operation is chosen once for whole chunk, so loop body is one action and can be vectorized
+
+#define NUMBER_1 left[i]
+#define NUMBER_2 right[i]
+
+#define DEF_OP(name, symb, priority, arg_amt, action, ...)      \
+            case (Operators::name):                             \
+                for (size_t i = 0; i < amt; i++)                \
+                    result[i] = (action);                       \
+                break;                                          \
+
+void CalculateColumnOperation(const Operators operation, const double* left, const double* right,
+                              double* result, const size_t amt, error_t* error)
+{
+    assert(left);
+    assert(right);
+    assert(result);
+    assert(error);
+
+    switch (operation)
+    {
+        #include "operations.h"
+        default:
+            error->code = (int) ExpressionErrors::UNKNOWN_OPERATION;
+            break;
+    }
+}
+
+#undef DEF_OP
+#undef NUMBER_1
+#undef NUMBER_2
+
+//------------------------------------------------------------------
+
+static ExpressionErrors ColumnsProgramCtor(ColumnsProgram* prog, const size_t instr_amt, error_t* error)
+{
+    assert(prog);
+    assert(error);
+
+    prog->in_column  = (int*)            calloc(instr_amt + 1, sizeof(int));
+    prog->out_column = (int*)            calloc(instr_amt + 1, sizeof(int));
+    prog->uniform    = (bool*)           calloc(instr_amt + 1, sizeof(bool));
+    prog->values     = (const double**)  calloc(instr_amt + 1, sizeof(double*));
+    prog->scratch    = (double*)         calloc((instr_amt + 1) * COLUMNS_CHUNK_ROWS, sizeof(double));
+    prog->zeros      = (double*)         calloc(COLUMNS_CHUNK_ROWS, sizeof(double));
+
+    if (prog->in_column == nullptr || prog->out_column == nullptr || prog->uniform == nullptr ||
+        prog->values == nullptr || prog->scratch == nullptr || prog->zeros == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "COLUMNS PROGRAM";
+        return ExpressionErrors::ALLOCATE_MEMORY;
+    }
+
+    return ExpressionErrors::NONE;
+}
+
+//------------------------------------------------------------------
+
+static void ColumnsProgramDtor(ColumnsProgram* prog)
+{
+    assert(prog);
+
+    free(prog->in_column);
+    free(prog->out_column);
+    free(prog->uniform);
+    free(prog->values);
+    free(prog->scratch);
+    free(prog->zeros);
+}
+
+//------------------------------------------------------------------
+
+static void ClassifyInstructions(ColumnsProgram* prog)
+{
+    assert(prog);
+
+    const ir_t* ir = prog->ir;
+
+    for (size_t i = 0; i < ir->size; i++)
+    {
+        const IrInstruction* instr = &ir->code[i];
+
+        prog->in_column[i]  = NO_COLUMN;
+        prog->out_column[i] = NO_COLUMN;
+
+        switch (instr->type)
+        {
+            case (NodeType::VARIABLE):
+                prog->in_column[i] = prog->var_columns[instr->value.var];
+                prog->uniform[i]   = (prog->in_column[i] == NO_COLUMN);
+                break;
+
+            case (NodeType::OPERATOR):
+                prog->uniform[i] = (instr->left  == NO_IR_VALUE || prog->uniform[instr->left]) &&
+                                   (instr->right == NO_IR_VALUE || prog->uniform[instr->right]);
+                break;
+
+            case (NodeType::NUMBER):
+            case (NodeType::POISON):
+            default:
+                prog->uniform[i] = true;
+                break;
+        }
+    }
+
+    // float64 output is written by its instruction directly, other outputs are copied after chunk
+    for (size_t out = 0; out < ir->outputs_amt; out++)
+    {
+        int id = ir->outputs[out];
+
+        if (id == NO_IR_VALUE || prog->uniform[id] || ir->code[id].type != NodeType::OPERATOR)
+            continue;
+
+        if (prog->out->columns[out].type == ColumnType::FLOAT64 && prog->out_column[id] == NO_COLUMN)
+            prog->out_column[id] = (int) out;
+    }
+}
+
+//------------------------------------------------------------------
+
+static void CalculateUniform(ColumnsProgram* prog, error_t* error)
+{
+    assert(prog);
+    assert(error);
+
+    const ir_t* ir = prog->ir;
+
+    for (size_t i = 0; i < ir->size; i++)
+    {
+        if (!prog->uniform[i])
+            continue;
+
+        const IrInstruction* instr = &ir->code[i];
+        double*              dest  = prog->scratch + i * COLUMNS_CHUNK_ROWS;
+
+        prog->values[i] = dest;
+
+        switch (instr->type)
+        {
+            case (NodeType::NUMBER):
+                for (size_t row = 0; row < COLUMNS_CHUNK_ROWS; row++)
+                    dest[row] = instr->value.val;
+                break;
+
+            case (NodeType::VARIABLE):
+                for (size_t row = 0; row < COLUMNS_CHUNK_ROWS; row++)
+                    dest[row] = prog->var_values[instr->value.var];
+                break;
+
+            case (NodeType::OPERATOR):
+            {
+                const double* left  = (instr->left  != NO_IR_VALUE) ? prog->values[instr->left]  : prog->zeros;
+                const double* right = (instr->right != NO_IR_VALUE) ? prog->values[instr->right] : prog->zeros;
+
+                CalculateColumnOperation(instr->value.opt, left, right, dest, COLUMNS_CHUNK_ROWS, prog->tier, error);
+                break;
+            }
+
+            case (NodeType::POISON):
+            default:
+                error->code = (int) ExpressionErrors::INVALID_EXPRESSION_FORMAT;
+                break;
+        }
+
+        if (error->code != (int) ExpressionErrors::NONE)
+            return;
+    }
+}
+
+//------------------------------------------------------------------
+
+static void CalculateChunk(ColumnsProgram* prog, const size_t start, const size_t amt, error_t* error)
+{
+    assert(prog);
+    assert(error);
+
+    const ir_t* ir = prog->ir;
+
+    for (size_t i = 0; i < ir->size; i++)
+    {
+        if (prog->uniform[i])
+            continue;
+
+        const IrInstruction* instr = &ir->code[i];
+        double*              dest  = prog->scratch + i * COLUMNS_CHUNK_ROWS;
+
+        if (instr->type == NodeType::VARIABLE)
+        {
+            const ColumnDescriptor* column = &prog->in->columns[prog->in_column[i]];
+            const unsigned char*    data   = prog->in->data + column->offset;
+
+            if (column->type == ColumnType::FLOAT64)
+                prog->values[i] = (const double*) data + start;
+            else
+            {
+                const float* floats = (const float*) data + start;
+
+                for (size_t row = 0; row < amt; row++)
+                    dest[row] = floats[row];
+
+                prog->values[i] = dest;
+            }
+
+            continue;
+        }
+
+        if (prog->out_column[i] != NO_COLUMN)
+            dest = (double*) (prog->out->data + prog->out->columns[prog->out_column[i]].offset) + start;
+
+        const double* left  = (instr->left  != NO_IR_VALUE) ? prog->values[instr->left]  : prog->zeros;
+        const double* right = (instr->right != NO_IR_VALUE) ? prog->values[instr->right] : prog->zeros;
+
+        CalculateColumnOperation(instr->value.opt, left, right, dest, amt, prog->tier, error);
+        if (error->code != (int) ExpressionErrors::NONE)
+            return;
+
+        prog->values[i] = dest;
+    }
+}
+
+//------------------------------------------------------------------
+
+static void WriteChunkOutputs(ColumnsProgram* prog, const size_t start, const size_t amt)
+{
+    assert(prog);
+
+    const ir_t* ir = prog->ir;
+
+    for (size_t out = 0; out < ir->outputs_amt; out++)
+    {
+        int id = ir->outputs[out];
+
+        if (id != NO_IR_VALUE && prog->out_column[id] == (int) out)
+            continue;
+
+        const double*           values = (id != NO_IR_VALUE) ? prog->values[id] : prog->zeros;
+        const ColumnDescriptor* column = &prog->out->columns[out];
+        unsigned char*          data   = prog->out->data + column->offset;
+
+        if (column->type == ColumnType::FLOAT64)
+            memcpy((double*) data + start, values, amt * sizeof(double));
+        else
+        {
+            float* floats = (float*) data + start;
+
+            for (size_t row = 0; row < amt; row++)
+                floats[row] = (float) values[row];
+        }
+    }
+}
+
+//------------------------------------------------------------------
+
+void MatchColumnsVariables(const expr_t* expr, const columns_file_t* in, double* var_values, int* var_columns)
+{
+    assert(expr);
+    assert(in);
+    assert(var_values);
+    assert(var_columns);
+
+    for (size_t i = 0; i < expr->max_vars_amt; i++)
+    {
+        var_values[i]  = expr->vars[i].value;
+        var_columns[i] = expr->vars[i].isfree ? NO_COLUMN : FindColumn(in, expr->vars[i].variable_name);
+    }
+}
+
+//------------------------------------------------------------------
+
+ExpressionErrors ColumnsKernelCtor(ir_kernel_t* kernel, const expr_t* expr, const char* const* diff_vars,
+                                   const size_t diff_amt, error_t* error)
+{
+    assert(kernel);
+    assert(expr);
+    assert(error);
+    assert(diff_vars || diff_amt == 0);
+
+    const expr_t** outputs     = (const expr_t**) calloc(diff_amt + 1, sizeof(expr_t*));
+    expr_t**       derivatives = (expr_t**)       calloc(diff_amt + 1, sizeof(expr_t*));
+    if (outputs == nullptr || derivatives == nullptr)
+    {
+        free(outputs);
+        free(derivatives);
+
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "COLUMNS OUTPUTS";
+        return ExpressionErrors::ALLOCATE_MEMORY;
+    }
+
+    outputs[0] = expr;
+
+    for (size_t i = 0; i < diff_amt && error->code == (int) ExpressionErrors::NONE; i++)
+    {
+        derivatives[i] = DifferentiateExpression(expr, diff_vars[i], error);
+        outputs[i + 1] = derivatives[i];
+    }
+
+    if (error->code == (int) ExpressionErrors::NONE)
+        IrKernelCtor(kernel, outputs, diff_amt + 1, error);
+
+    for (size_t i = 0; derivatives[i] != nullptr; i++)
+    {
+        ExpressionDtor(derivatives[i]);
+        free(derivatives[i]);
+    }
+    free(derivatives);
+    free(outputs);
+
+    return (ExpressionErrors) error->code;
+}
+
+//------------------------------------------------------------------
+
+ExpressionErrors CalculateIrColumns(const ir_t* ir, const double* var_values, const int* var_columns,
+                                    const columns_file_t* in, const columns_file_t* out,
+                                    const size_t first_row, const size_t rows_amt, error_t* error)
+{
+    return CalculateIrColumns(ir, var_values, var_columns, in, out, first_row, rows_amt, MathTier::LIBM, error);
+}
+
+//------------------------------------------------------------------
+
+ExpressionErrors CalculateIrColumns(const ir_t* ir, const double* var_values, const int* var_columns,
+                                    const columns_file_t* in, const columns_file_t* out,
+                                    const size_t first_row, const size_t rows_amt, const MathTier tier,
+                                    error_t* error)
+{
+    assert(ir);
+    assert(var_values);
+    assert(var_columns);
+    assert(in);
+    assert(out);
+    assert(error);
+
+    if (out->header->columns_amt != ir->outputs_amt || out->header->rows_amt != in->header->rows_amt ||
+        first_row > in->header->rows_amt || in->header->rows_amt - first_row < rows_amt)
+    {
+        error->code = (int) ExpressionErrors::INVALID_EXPRESSION_FORMAT;
+        error->data = "COLUMNS LAYOUT";
+        return ExpressionErrors::INVALID_EXPRESSION_FORMAT;
+    }
+
+    ColumnsProgram prog = {};
+
+    if (ColumnsProgramCtor(&prog, ir->size, error) == ExpressionErrors::NONE)
+    {
+        prog.ir          = ir;
+        prog.var_values  = var_values;
+        prog.var_columns = var_columns;
+        prog.tier        = tier;
+        prog.in          = in;
+        prog.out         = out;
+
+        ClassifyInstructions(&prog);
+        CalculateUniform(&prog, error);
+
+        size_t end = first_row + rows_amt;
+
+        for (size_t start = first_row; start < end && error->code == (int) ExpressionErrors::NONE;
+             start += COLUMNS_CHUNK_ROWS)
+        {
+            size_t amt = (end - start < COLUMNS_CHUNK_ROWS) ? end - start : COLUMNS_CHUNK_ROWS;
+
+            CalculateChunk(&prog, start, amt, error);
+
+            if (error->code == (int) ExpressionErrors::NONE)
+                WriteChunkOutputs(&prog, start, amt);
+        }
+    }
+
+    ColumnsProgramDtor(&prog);
+
+    return (ExpressionErrors) error->code;
+}
+
+//------------------------------------------------------------------
+
+ExpressionErrors CalculateExpressionColumns(const expr_t* expr, const char* const* diff_vars, const size_t diff_amt,
+                                            const columns_file_t* in, const columns_file_t* out, error_t* error)
+{
+    return CalculateExpressionColumns(expr, diff_vars, diff_amt, in, out, MathTier::LIBM, error);
+}
+
+//------------------------------------------------------------------
+
+ExpressionErrors CalculateExpressionColumns(const expr_t* expr, const char* const* diff_vars, const size_t diff_amt,
+                                            const columns_file_t* in, const columns_file_t* out,
+                                            const MathTier tier, error_t* error)
+{
+    assert(expr);
+    assert(in);
+    assert(out);
+    assert(error);
+
+    ir_kernel_t kernel      = {};
+    double*     var_values  = (double*) calloc(expr->max_vars_amt + 1, sizeof(double));
+    int*        var_columns = (int*)    calloc(expr->max_vars_amt + 1, sizeof(int));
+
+    if (var_values == nullptr || var_columns == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "COLUMNS VARIABLES";
+    }
+    else if (ColumnsKernelCtor(&kernel, expr, diff_vars, diff_amt, error) == ExpressionErrors::NONE)
+    {
+        MatchColumnsVariables(expr, in, var_values, var_columns);
+
+        CalculateIrColumns(&kernel.ir, var_values, var_columns, in, out, 0, in->header->rows_amt, tier, error);
+
+        IrKernelDtor(&kernel);
+    }
+
+    free(var_values);
+    free(var_columns);
+
+    return (ExpressionErrors) error->code;
+}
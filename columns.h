@@ -0,0 +1,102 @@
+#ifndef __COLUMNS_H_
+#define __COLUMNS_H_
+
+#include <stdint.h>
+
+#include "expression/expression.h"
+#include "ir.h"
+#include "math_tiers.h"
+
+// ======================================================================
+// COLUMNS FILE
+// ======================================================================
+
+// little-endian file: header, column descriptors, then every column as one contiguous array
+// aligned to COLUMNS_ALIGNMENT; file is mapped, so columns are read in place
+
+static const char     COLUMNS_MAGIC[8]     = {'D', 'I', 'F', 'F', 'C', 'O', 'L', '\0'};
+static const uint32_t COLUMNS_VERSION      = 1;
+static const size_t   MAX_COLUMN_NAME_LEN  = 32;
+static const size_t   COLUMNS_ALIGNMENT    = 64;
+
+enum class ColumnType : uint32_t
+{
+    FLOAT64 = 0,
+    FLOAT32 = 1,
+};
+
+struct ColumnsHeader
+{
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    columns_amt;
+    uint64_t    rows_amt;
+};
+
+struct ColumnDescriptor
+{
+    char        name[MAX_COLUMN_NAME_LEN];
+    ColumnType  type;
+    uint32_t    reserved;
+    uint64_t    offset;             // from file start
+};
+
+struct ColumnsFile
+{
+    int                     fd;
+    unsigned char*          data;
+    size_t                  size;
+
+    const ColumnsHeader*    header;
+    const ColumnDescriptor* columns;
+};
+typedef struct ColumnsFile columns_file_t;
+
+// file errors are reported with ERRORS::OPEN_FILE and ERRORS::READ_FILE, data is file name
+void    ColumnsFileOpen(columns_file_t* file, const char* name, error_t* error);
+void    ColumnsFileCreate(columns_file_t* file, const char* name, const char* const* column_names,
+                          const ColumnType* types, const size_t columns_amt, const size_t rows_amt, error_t* error);
+void    ColumnsFileClose(columns_file_t* file);
+
+int     FindColumn(const columns_file_t* file, const char* name);
+
+static const int NO_COLUMN = -1;
+
+// ======================================================================
+// CHUNKED EVALUATION
+// ======================================================================
+
+// rows go in chunks of COLUMNS_CHUNK_ROWS, every IR instruction is one loop over chunk;
+// float64 columns are read from mapping and outputs are written to it without copies,
+// subexpressions without columns are calculated once
+
+static const size_t COLUMNS_CHUNK_ROWS = 512;
+
+// one operator over amt rows, unary operators take right operand
+void             CalculateColumnOperation(const Operators operation, const double* left, const double* right,
+                                          double* result, const size_t amt, error_t* error);
+
+// input columns are matched with variables by name, other variables keep values from expr->vars;
+// out must have diff_amt + 1 columns with in's rows amount: expression, then derivatives by diff_vars
+ExpressionErrors CalculateExpressionColumns(const expr_t* expr, const char* const* diff_vars, const size_t diff_amt,
+                                            const columns_file_t* in, const columns_file_t* out, error_t* error);
+// same with math functions of given tier
+ExpressionErrors CalculateExpressionColumns(const expr_t* expr, const char* const* diff_vars, const size_t diff_amt,
+                                            const columns_file_t* in, const columns_file_t* out,
+                                            const MathTier tier, error_t* error);
+
+// parts of it for callers that split rows: kernel outputs are expr and its derivatives by diff_vars,
+// var_columns[i] is input column of variable i or NO_COLUMN, then var_values[i] is used
+ExpressionErrors ColumnsKernelCtor(ir_kernel_t* kernel, const expr_t* expr, const char* const* diff_vars,
+                                   const size_t diff_amt, error_t* error);
+void             MatchColumnsVariables(const expr_t* expr, const columns_file_t* in, double* var_values,
+                                       int* var_columns);
+ExpressionErrors CalculateIrColumns(const ir_t* ir, const double* var_values, const int* var_columns,
+                                    const columns_file_t* in, const columns_file_t* out,
+                                    const size_t first_row, const size_t rows_amt, error_t* error);
+ExpressionErrors CalculateIrColumns(const ir_t* ir, const double* var_values, const int* var_columns,
+                                    const columns_file_t* in, const columns_file_t* out,
+                                    const size_t first_row, const size_t rows_amt, const MathTier tier,
+                                    error_t* error);
+
+#endif
@@ -0,0 +1,728 @@
+#include <ctype.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "csv_stream.h"
+#include "calculation.h"
+#include "ir.h"
+#include "jit.h"
+
+// every batch goes FREE -> PARSED -> CALCULATED -> FREE, and every stage takes batches in the same
+// cyclic order, so one state per batch is enough to pass it between threads
+
+enum class CsvBatchState
+{
+    FREE,
+    PARSED,
+    CALCULATED,
+};
+
+struct CsvBatch
+{
+    CsvBatchState   state;
+    bool            last;           // input ended on this batch
+
+    size_t          rows;
+    double*         args;           // rows * args_amt values of header variables
+    double*         results;        // rows * outputs_amt
+};
+
+struct CsvPipeline
+{
+    FILE*           in;
+    FILE*           out;
+
+    CsvBatch        batches[CSV_BATCHES_AMT];
+
+    int*            column_args;    // argument of every column or NO_CSV_ARG
+    size_t          columns_amt;
+    int*            arg_vars;       // variable of every argument
+    size_t          args_amt;
+    size_t          outputs_amt;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  changed;
+
+    bool            stop;           // set by first failed stage, others leave as soon as they see it
+    error_t         error;
+};
+
+static const int    NO_CSV_ARG       = -1;
+static const size_t CSV_NUMBER_LEN   = 32;                      // "%.17g" with sign and exponent fits
+
+static const double EXACT_POWERS_10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                         1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+static const int    MAX_EXACT_POWER_10 = 22;
+static const uint64_t MAX_EXACT_MANTISSA = (uint64_t) 1 << 53;
+
+static char*    StripLine(char* line);
+static const char* SkipSpaces(const char* str);
+
+static void     ParseCsvHeader(CsvPipeline* pipe, char* header, const expr_t* expr, error_t* error);
+static bool     ParseCsvRow(const CsvPipeline* pipe, const char* line, double* args);
+
+static bool     WaitBatch(CsvPipeline* pipe, CsvBatch* batch, const CsvBatchState state);
+static void     PassBatch(CsvPipeline* pipe, CsvBatch* batch, const CsvBatchState state);
+static void     StopPipeline(CsvPipeline* pipe, const error_t* error);
+
+static void*    ReadCsvRows(void* pipeline);
+static void*    WriteCsvRows(void* pipeline);
+static void     CalculateCsvRows(CsvPipeline* pipe, ir_kernel_t* kernel, const jit_t* jits, variable_t* vars);
+
+static jit_t*   CompileCsvOutputs(const expr_t** outputs, const size_t outputs_amt, const ir_kernel_t* kernel);
+static void     DestroyCsvOutputs(jit_t* jits, const size_t outputs_amt);
+
+static void     PrintCsvHeader(FILE* out, const char* const* diff_vars, const size_t diff_amt);
+
+static ExpressionErrors PipelineCtor(CsvPipeline* pipe, error_t* error);
+static void             PipelineDtor(CsvPipeline* pipe);
+
+//------------------------------------------------------------------
+
+double ParseCsvNumber(const char* str, const char** end)
+{
+    assert(str);
+    assert(end);
+
+    const char* ptr = str;
+
+    bool negative = (*ptr == '-');
+    if (*ptr == '-' || *ptr == '+')
+        ptr++;
+
+    uint64_t mantissa = 0;
+    int      exponent = 0;
+    bool     exact    = true;
+    bool     digits   = false;
+
+    for (; isdigit(*ptr); ptr++, digits = true)
+    {
+        if (mantissa < MAX_EXACT_MANTISSA)
+            mantissa = mantissa * 10 + (uint64_t) (*ptr - '0');
+        else
+        {
+            exact = false;
+            exponent++;
+        }
+    }
+
+    if (*ptr == '.')
+    {
+        for (ptr++; isdigit(*ptr); ptr++, digits = true)
+        {
+            if (mantissa < MAX_EXACT_MANTISSA)
+            {
+                mantissa = mantissa * 10 + (uint64_t) (*ptr - '0');
+                exponent--;
+            }
+            else
+                exact = false;
+        }
+    }
+
+    char* lib_end = nullptr;
+
+    // nan, inf and hex are left to library
+    if (!digits)
+    {
+        double value = strtod(str, &lib_end);
+        *end = lib_end;
+
+        return value;
+    }
+
+    if (*ptr == 'e' || *ptr == 'E')
+    {
+        const char* exp_ptr  = ptr + 1;
+        bool        exp_neg  = (*exp_ptr == '-');
+        int         exp_val  = 0;
+
+        if (*exp_ptr == '-' || *exp_ptr == '+')
+            exp_ptr++;
+
+        if (isdigit(*exp_ptr))
+        {
+            for (; isdigit(*exp_ptr); exp_ptr++)
+            {
+                if (exp_val < 100000)
+                    exp_val = exp_val * 10 + (*exp_ptr - '0');
+            }
+
+            exponent += exp_neg ? -exp_val : exp_val;
+            ptr       = exp_ptr;
+        }
+    }
+
+    // both mantissa and power of 10 are exact doubles, so result is rounded once
+    if (!exact || mantissa > MAX_EXACT_MANTISSA || exponent > MAX_EXACT_POWER_10 || exponent < -MAX_EXACT_POWER_10)
+    {
+        double value = strtod(str, &lib_end);
+        *end = lib_end;
+
+        return value;
+    }
+
+    *end = ptr;
+
+    double value = (double) mantissa;
+    value = (exponent >= 0) ? value * EXACT_POWERS_10[exponent] : value / EXACT_POWERS_10[-exponent];
+
+    return negative ? -value : value;
+}
+
+//------------------------------------------------------------------
+
+static const char* SkipSpaces(const char* str)
+{
+    assert(str);
+
+    while (*str == ' ' || *str == '\t')
+        str++;
+
+    return str;
+}
+
+//------------------------------------------------------------------
+
+static char* StripLine(char* line)
+{
+    assert(line);
+
+    size_t len = strlen(line);
+
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+        line[--len] = '\0';
+
+    return line;
+}
+
+//------------------------------------------------------------------
+
+static void ParseCsvHeader(CsvPipeline* pipe, char* header, const expr_t* expr, error_t* error)
+{
+    assert(pipe);
+    assert(header);
+    assert(expr);
+    assert(error);
+
+    pipe->columns_amt = 1;
+    for (const char* ptr = header; *ptr; ptr++)
+        if (*ptr == CSV_SEPARATOR)
+            pipe->columns_amt++;
+
+    pipe->column_args = (int*) calloc(pipe->columns_amt, sizeof(int));
+    pipe->arg_vars    = (int*) calloc(pipe->columns_amt, sizeof(int));
+    if (pipe->column_args == nullptr || pipe->arg_vars == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "CSV COLUMNS";
+        return;
+    }
+
+    char* name = header;
+
+    for (size_t column = 0; column < pipe->columns_amt; column++)
+    {
+        char* next = strchr(name, CSV_SEPARATOR);
+        if (next)
+            *next = '\0';
+
+        // names are trimmed in place
+        while (*name == ' ' || *name == '\t')
+            name++;
+        for (size_t len = strlen(name); len > 0 && isspace(name[len - 1]); len--)
+            name[len - 1] = '\0';
+
+        int var_id = FindVariableAmongSaved(expr->vars, name);
+
+        if (var_id == NO_VARIABLE)
+            pipe->column_args[column] = NO_CSV_ARG;
+        else
+        {
+            pipe->column_args[column]         = (int) pipe->args_amt;
+            pipe->arg_vars[pipe->args_amt++]  = var_id;
+        }
+
+        if (next)
+            name = next + 1;
+    }
+}
+
+//------------------------------------------------------------------
+
+static bool ParseCsvRow(const CsvPipeline* pipe, const char* line, double* args)
+{
+    assert(pipe);
+    assert(line);
+    assert(args);
+
+    const char* ptr = line;
+
+    for (size_t column = 0; column < pipe->columns_amt; column++)
+    {
+        if (column > 0)
+        {
+            if (*ptr != CSV_SEPARATOR)
+                return false;
+            ptr++;
+        }
+
+        int arg = pipe->column_args[column];
+
+        if (arg == NO_CSV_ARG)
+        {
+            while (*ptr && *ptr != CSV_SEPARATOR)
+                ptr++;
+            continue;
+        }
+
+        const char* end = nullptr;
+        args[arg] = ParseCsvNumber(SkipSpaces(ptr), &end);
+
+        if (end == SkipSpaces(ptr))
+            return false;
+
+        ptr = SkipSpaces(end);
+    }
+
+    return *ptr == '\0';
+}
+
+//------------------------------------------------------------------
+
+static bool WaitBatch(CsvPipeline* pipe, CsvBatch* batch, const CsvBatchState state)
+{
+    assert(pipe);
+    assert(batch);
+
+    pthread_mutex_lock(&pipe->lock);
+
+    while (batch->state != state && !pipe->stop)
+        pthread_cond_wait(&pipe->changed, &pipe->lock);
+
+    bool stop = pipe->stop;
+
+    pthread_mutex_unlock(&pipe->lock);
+
+    return !stop;
+}
+
+//------------------------------------------------------------------
+
+static void PassBatch(CsvPipeline* pipe, CsvBatch* batch, const CsvBatchState state)
+{
+    assert(pipe);
+    assert(batch);
+
+    pthread_mutex_lock(&pipe->lock);
+
+    batch->state = state;
+    pthread_cond_broadcast(&pipe->changed);
+
+    pthread_mutex_unlock(&pipe->lock);
+}
+
+//------------------------------------------------------------------
+
+static void StopPipeline(CsvPipeline* pipe, const error_t* error)
+{
+    assert(pipe);
+    assert(error);
+
+    pthread_mutex_lock(&pipe->lock);
+
+    if (!pipe->stop)
+        pipe->error = *error;
+
+    pipe->stop = true;
+    pthread_cond_broadcast(&pipe->changed);
+
+    pthread_mutex_unlock(&pipe->lock);
+}
+
+//------------------------------------------------------------------
+
+static void* ReadCsvRows(void* pipeline)
+{
+    assert(pipeline);
+
+    CsvPipeline* pipe  = (CsvPipeline*) pipeline;
+
+    char*   line       = nullptr;
+    size_t  line_cap   = 0;
+    bool    input_end  = false;
+    bool    failed     = false;
+
+    for (size_t i = 0; !input_end && !failed; i = (i + 1) % CSV_BATCHES_AMT)
+    {
+        CsvBatch* batch = &pipe->batches[i];
+
+        if (!WaitBatch(pipe, batch, CsvBatchState::FREE))
+            break;
+
+        batch->rows = 0;
+
+        while (batch->rows < CSV_BATCH_ROWS)
+        {
+            if (getline(&line, &line_cap, pipe->in) < 0)
+            {
+                input_end = true;
+                break;
+            }
+
+            StripLine(line);
+            if (*SkipSpaces(line) == '\0')
+                continue;
+
+            if (!ParseCsvRow(pipe, line, batch->args + batch->rows * pipe->args_amt))
+            {
+                error_t error = {(int) ExpressionErrors::INVALID_SYNTAX, "CSV ROW"};
+                StopPipeline(pipe, &error);
+
+                failed = true;
+                break;
+            }
+
+            batch->rows++;
+        }
+
+        batch->last = input_end;
+
+        if (!failed)
+            PassBatch(pipe, batch, CsvBatchState::PARSED);
+    }
+
+    free(line);
+
+    return nullptr;
+}
+
+//------------------------------------------------------------------
+
+static void CalculateCsvRows(CsvPipeline* pipe, ir_kernel_t* kernel, const jit_t* jits, variable_t* vars)
+{
+    assert(pipe);
+    assert(kernel);
+    assert(vars);
+
+    error_t error = {};
+
+    for (size_t i = 0; ; i = (i + 1) % CSV_BATCHES_AMT)
+    {
+        CsvBatch* batch = &pipe->batches[i];
+
+        if (!WaitBatch(pipe, batch, CsvBatchState::PARSED))
+            return;
+
+        for (size_t row = 0; row < batch->rows; row++)
+        {
+            const double* args = batch->args + row * pipe->args_amt;
+
+            for (size_t arg = 0; arg < pipe->args_amt; arg++)
+                vars[pipe->arg_vars[arg]].value = args[arg];
+
+            double* results = batch->results + row * pipe->outputs_amt;
+
+            if (jits != nullptr)
+                for (size_t out = 0; out < pipe->outputs_amt; out++)
+                    results[out] = jits[out].func(vars);
+            else
+                IrKernelCalculate(kernel, vars, results, &error);
+
+            if (error.code != (int) ExpressionErrors::NONE)
+            {
+                StopPipeline(pipe, &error);
+                return;
+            }
+        }
+
+        PassBatch(pipe, batch, CsvBatchState::CALCULATED);
+
+        if (batch->last)
+            return;
+    }
+}
+
+//------------------------------------------------------------------
+
+static void* WriteCsvRows(void* pipeline)
+{
+    assert(pipeline);
+
+    CsvPipeline* pipe = (CsvPipeline*) pipeline;
+
+    size_t buf_size = CSV_BATCH_ROWS * pipe->outputs_amt * CSV_NUMBER_LEN + 1;
+    char*  buf      = (char*) calloc(buf_size, sizeof(char));
+    if (buf == nullptr)
+    {
+        error_t error = {(int) ExpressionErrors::ALLOCATE_MEMORY, "CSV OUTPUT"};
+        StopPipeline(pipe, &error);
+        return nullptr;
+    }
+
+    for (size_t i = 0; ; i = (i + 1) % CSV_BATCHES_AMT)
+    {
+        CsvBatch* batch = &pipe->batches[i];
+
+        if (!WaitBatch(pipe, batch, CsvBatchState::CALCULATED))
+            break;
+
+        size_t len = 0;
+
+        for (size_t row = 0; row < batch->rows; row++)
+        {
+            const double* results = batch->results + row * pipe->outputs_amt;
+
+            for (size_t out = 0; out < pipe->outputs_amt; out++)
+            {
+                char end = (out + 1 == pipe->outputs_amt) ? '\n' : CSV_SEPARATOR;
+                len += (size_t) snprintf(buf + len, buf_size - len, "%.17g%c", results[out], end);
+            }
+        }
+
+        fwrite(buf, sizeof(char), len, pipe->out);
+
+        bool last = batch->last;
+
+        PassBatch(pipe, batch, CsvBatchState::FREE);
+
+        if (last)
+            break;
+    }
+
+    fflush(pipe->out);
+    free(buf);
+
+    return nullptr;
+}
+
+//------------------------------------------------------------------
+
+// native code of every output, or nullptr when rows are calculated by interpreter of kernel:
+// code is 2-3 times faster per node, but output trees repeat subtrees that kernel calculates
+// once, so it wins only while trees are not much bigger than kernel; failed compilation
+// leaves interpreter too
+static jit_t* CompileCsvOutputs(const expr_t** outputs, const size_t outputs_amt, const ir_kernel_t* kernel)
+{
+    assert(outputs);
+    assert(kernel);
+
+    if (!IsJitSupported())
+        return nullptr;
+
+    jit_t* jits = (jit_t*) calloc(outputs_amt, sizeof(jit_t));
+    if (jits == nullptr)
+        return nullptr;
+
+    error_t error     = {};
+    size_t  nodes_amt = 0;
+
+    for (size_t out = 0; out < outputs_amt && error.code == (int) ExpressionErrors::NONE; out++)
+    {
+        JitCompile(&jits[out], outputs[out], &error);
+        nodes_amt += jits[out].nodes_amt;
+    }
+
+    if (error.code != (int) ExpressionErrors::NONE || 2 * nodes_amt > 3 * kernel->ir.size)
+    {
+        DestroyCsvOutputs(jits, outputs_amt);
+        return nullptr;
+    }
+
+    return jits;
+}
+
+//------------------------------------------------------------------
+
+static void DestroyCsvOutputs(jit_t* jits, const size_t outputs_amt)
+{
+    if (jits == nullptr)
+        return;
+
+    for (size_t out = 0; out < outputs_amt; out++)
+        JitDtor(&jits[out]);
+
+    free(jits);
+}
+
+//------------------------------------------------------------------
+
+static void PrintCsvHeader(FILE* out, const char* const* diff_vars, const size_t diff_amt)
+{
+    assert(out);
+
+    fprintf(out, "f");
+
+    for (size_t i = 0; i < diff_amt; i++)
+        fprintf(out, "%cdf/d%s", CSV_SEPARATOR, diff_vars[i]);
+
+    fprintf(out, "\n");
+}
+
+//------------------------------------------------------------------
+
+static ExpressionErrors PipelineCtor(CsvPipeline* pipe, error_t* error)
+{
+    assert(pipe);
+    assert(error);
+
+    pthread_mutex_init(&pipe->lock, nullptr);
+    pthread_cond_init(&pipe->changed, nullptr);
+
+    for (size_t i = 0; i < CSV_BATCHES_AMT; i++)
+    {
+        CsvBatch* batch = &pipe->batches[i];
+
+        batch->state   = CsvBatchState::FREE;
+        batch->args    = (double*) calloc(CSV_BATCH_ROWS * pipe->args_amt + 1,    sizeof(double));
+        batch->results = (double*) calloc(CSV_BATCH_ROWS * pipe->outputs_amt + 1, sizeof(double));
+
+        if (batch->args == nullptr || batch->results == nullptr)
+        {
+            error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+            error->data = "CSV BATCHES";
+            return ExpressionErrors::ALLOCATE_MEMORY;
+        }
+    }
+
+    return ExpressionErrors::NONE;
+}
+
+//------------------------------------------------------------------
+
+static void PipelineDtor(CsvPipeline* pipe)
+{
+    assert(pipe);
+
+    for (size_t i = 0; i < CSV_BATCHES_AMT; i++)
+    {
+        free(pipe->batches[i].args);
+        free(pipe->batches[i].results);
+    }
+
+    free(pipe->column_args);
+    free(pipe->arg_vars);
+
+    pthread_mutex_destroy(&pipe->lock);
+    pthread_cond_destroy(&pipe->changed);
+}
+
+//------------------------------------------------------------------
+
+ExpressionErrors StreamCsv(const expr_t* expr, const char* const* diff_vars, const size_t diff_amt,
+                           FILE* in, FILE* out, error_t* error)
+{
+    assert(expr);
+    assert(in);
+    assert(out);
+    assert(error);
+    assert(diff_vars || diff_amt == 0);
+
+    CsvPipeline pipe = {};
+
+    pipe.in          = in;
+    pipe.out         = out;
+    pipe.outputs_amt = diff_amt + 1;
+
+    char*   header     = nullptr;
+    size_t  header_cap = 0;
+
+    if (getline(&header, &header_cap, in) < 0)
+    {
+        free(header);
+
+        error->code = (int) ExpressionErrors::NO_EXPRESSION;
+        error->data = "CSV HEADER";
+        return ExpressionErrors::NO_EXPRESSION;
+    }
+
+    ParseCsvHeader(&pipe, StripLine(header), expr, error);
+    free(header);
+
+    // expression and its derivatives share subtrees, so they are one program
+    const expr_t** outputs     = (const expr_t**) calloc(pipe.outputs_amt, sizeof(expr_t*));
+    expr_t**       derivatives = (expr_t**)       calloc(diff_amt + 1,     sizeof(expr_t*));
+    if ((outputs == nullptr || derivatives == nullptr) && error->code == (int) ExpressionErrors::NONE)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "CSV OUTPUTS";
+    }
+
+    ir_kernel_t kernel = {};
+    jit_t*      jits   = nullptr;
+    variable_t* vars   = (variable_t*) calloc(expr->max_vars_amt, sizeof(variable_t));
+
+    if (error->code == (int) ExpressionErrors::NONE)
+    {
+        outputs[0] = expr;
+
+        for (size_t i = 0; i < diff_amt && error->code == (int) ExpressionErrors::NONE; i++)
+        {
+            derivatives[i] = DifferentiateExpression(expr, diff_vars[i], error);
+            outputs[i + 1] = derivatives[i];
+        }
+
+        if (error->code == (int) ExpressionErrors::NONE)
+            IrKernelCtor(&kernel, outputs, pipe.outputs_amt, error);
+
+        if (error->code == (int) ExpressionErrors::NONE)
+            jits = CompileCsvOutputs(outputs, pipe.outputs_amt, &kernel);
+    }
+
+    if (error->code == (int) ExpressionErrors::NONE && vars == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "CSV VARIABLES";
+    }
+
+    if (error->code == (int) ExpressionErrors::NONE)
+        PipelineCtor(&pipe, error);
+
+    if (error->code == (int) ExpressionErrors::NONE)
+    {
+        // names are not used by calculation, so shallow copy is enough
+        memcpy(vars, expr->vars, expr->max_vars_amt * sizeof(variable_t));
+
+        PrintCsvHeader(out, diff_vars, diff_amt);
+
+        pthread_t reader = {};
+        pthread_t writer = {};
+
+        bool reader_started = pthread_create(&reader, nullptr, ReadCsvRows, &pipe) == 0;
+        bool writer_started = reader_started && pthread_create(&writer, nullptr, WriteCsvRows, &pipe) == 0;
+
+        // without both threads nobody fills or empties the batches, so started one is stopped
+        if (writer_started)
+            CalculateCsvRows(&pipe, &kernel, jits, vars);
+        else
+        {
+            error_t thread_error = {(int) ExpressionErrors::ALLOCATE_MEMORY, "CSV THREADS"};
+            StopPipeline(&pipe, &thread_error);
+        }
+
+        if (reader_started)
+            pthread_join(reader, nullptr);
+        if (writer_started)
+            pthread_join(writer, nullptr);
+
+        if (pipe.stop)
+            *error = pipe.error;
+    }
+
+    PipelineDtor(&pipe);
+    IrKernelDtor(&kernel);
+    DestroyCsvOutputs(jits, pipe.outputs_amt);
+    free(vars);
+
+    for (size_t i = 0; derivatives != nullptr && derivatives[i] != nullptr; i++)
+    {
+        ExpressionDtor(derivatives[i]);
+        free(derivatives[i]);
+    }
+    free(derivatives);
+    free(outputs);
+
+    return (ExpressionErrors) error->code;
+}
@@ -0,0 +1,31 @@
+#ifndef __CSV_STREAM_H_
+#define __CSV_STREAM_H_
+
+#include <stdio.h>
+
+#include "expression/expression.h"
+
+// ======================================================================
+// CSV STREAMING
+// ======================================================================
+
+// rows go through the pipeline in batches: reader thread parses them, caller thread calculates,
+// writer thread prints; only CSV_BATCHES_AMT batches exist, so memory does not depend on input size.
+// Rows are calculated by native code (jit.h) where it is supported and faster, by IR kernel otherwise
+
+static const size_t CSV_BATCH_ROWS  = 4096;
+static const size_t CSV_BATCHES_AMT = 4;
+
+static const char   CSV_SEPARATOR   = ',';
+
+// header of in names variables, columns with other names are skipped and variables without column
+// keep their value from expr->vars; every row of out is value of expr and its derivatives
+// by diff_vars, in that order
+ExpressionErrors StreamCsv(const expr_t* expr, const char* const* diff_vars, const size_t diff_amt,
+                           FILE* in, FILE* out, error_t* error);
+
+// decimal number without sscanf: short ones are exact with one multiplication or division,
+// others are passed to strtod; end is set after the number, or to str if there is none
+double           ParseCsvNumber(const char* str, const char** end);
+
+#endif
@@ -0,0 +1,579 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "diff_cache.h"
+#include "calculation.h"
+
+struct DiffCacheEntry
+{
+    uint64_t        hash;
+    expr_t*         expr;                   // copy of differentiated expression
+    int             var_id;
+    int             order;
+
+    expr_t*         derivative;
+    size_t          bytes;
+
+    DiffCacheEntry* next_in_bucket;
+    DiffCacheEntry* newer;
+    DiffCacheEntry* older;
+};
+
+struct DiffCacheShard
+{
+    pthread_mutex_t  lock;
+
+    DiffCacheEntry** buckets;               // nullptr if shard could not be allocated
+    DiffCacheEntry*  newest;
+    DiffCacheEntry*  oldest;
+
+    size_t           bytes;
+    size_t           limit;
+
+    size_t           entries;
+    size_t           hits;
+    size_t           misses;
+    size_t           evictions;
+};
+
+static DiffCacheShard   diff_cache_shards[DIFF_CACHE_SHARDS] = {};
+static pthread_once_t   diff_cache_once                      = PTHREAD_ONCE_INIT;
+
+static void             InitDiffCache();
+
+static inline uint64_t  MixHash(uint64_t key);
+static uint64_t         HashString(const char* str);
+static uint64_t         HashNode(const Node* node, const variable_t* vars);
+static bool             AreTreesSame(const Node* a, const variable_t* a_vars, const Node* b, const variable_t* b_vars);
+static size_t           CountNodes(const Node* node);
+
+static Node*            CopyTree(const Node* node, error_t* error);
+static expr_t*          CopyExpression(const Node* root, const expr_t* vars_source, error_t* error);
+static void             DeleteExpression(expr_t* expr);
+static expr_t*          DifferentiateTimes(const expr_t* expr, const char* var, const int order, error_t* error);
+
+static DiffCacheEntry*  MakeEntry(const expr_t* expr, const expr_t* derivative, const uint64_t hash,
+                                  const int var_id, const int order, error_t* error);
+static void             DeleteEntry(DiffCacheEntry* entry);
+static DiffCacheEntry*  FindEntry(DiffCacheShard* shard, const uint64_t hash, const expr_t* expr,
+                                  const int var_id, const int order);
+static void             InsertEntry(DiffCacheShard* shard, DiffCacheEntry* entry);
+static void             RemoveEntry(DiffCacheShard* shard, DiffCacheEntry* entry);
+static void             UnlinkEntry(DiffCacheShard* shard, DiffCacheEntry* entry);
+static void             PushNewest(DiffCacheShard* shard, DiffCacheEntry* entry);
+static void             EvictEntries(DiffCacheShard* shard);
+
+static inline DiffCacheEntry** GetBucket(DiffCacheShard* shard, const uint64_t hash);
+
+//------------------------------------------------------------------
+
+static void InitDiffCache()
+{
+    for (size_t i = 0; i < DIFF_CACHE_SHARDS; i++)
+    {
+        DiffCacheShard* shard = &diff_cache_shards[i];
+
+        pthread_mutex_init(&shard->lock, nullptr);
+
+        shard->buckets = (DiffCacheEntry**) calloc(DIFF_CACHE_BUCKETS, sizeof(DiffCacheEntry*));
+        shard->limit   = DIFF_CACHE_DEFAULT_LIMIT / DIFF_CACHE_SHARDS;
+    }
+}
+
+//------------------------------------------------------------------
+
+expr_t* GetCachedDerivative(const expr_t* expr, const char* var, const int order, error_t* error)
+{
+    assert(expr);
+    assert(var);
+    assert(error);
+
+    pthread_once(&diff_cache_once, InitDiffCache);
+
+    if (order <= 0)
+        return CopyExpression(expr->root, expr, error);
+
+    int      var_id = FindVariableAmongSaved(expr->vars, var);
+    uint64_t hash   = MixHash(HashNode(expr->root, expr->vars) * 31 + (uint64_t) (var_id + 1));
+    hash            = MixHash(hash * 31 + (uint64_t) order);
+
+    DiffCacheShard* shard = &diff_cache_shards[hash % DIFF_CACHE_SHARDS];
+
+    if (shard->buckets == nullptr)
+        return DifferentiateTimes(expr, var, order, error);
+
+    pthread_mutex_lock(&shard->lock);
+
+    DiffCacheEntry* entry = FindEntry(shard, hash, expr, var_id, order);
+    if (entry)
+    {
+        UnlinkEntry(shard, entry);
+        PushNewest(shard, entry);
+        shard->hits++;
+
+        expr_t* result = CopyExpression(entry->derivative->root, expr, error);
+
+        pthread_mutex_unlock(&shard->lock);
+
+        return result;
+    }
+
+    shard->misses++;
+
+    pthread_mutex_unlock(&shard->lock);
+
+    expr_t* derivative = DifferentiateTimes(expr, var, order, error);
+    if (error->code != (int) ExpressionErrors::NONE)
+        return derivative;
+
+    // cache is only an optimization, entry that can not be made is not an error
+    error_t entry_error = {};
+
+    entry = MakeEntry(expr, derivative, hash, var_id, order, &entry_error);
+    if (entry == nullptr)
+        return derivative;
+
+    pthread_mutex_lock(&shard->lock);
+
+    // other thread could insert the same derivative meanwhile
+    if (entry->bytes > shard->limit || FindEntry(shard, hash, expr, var_id, order))
+    {
+        DeleteEntry(entry);
+    }
+    else
+    {
+        InsertEntry(shard, entry);
+        EvictEntries(shard);
+    }
+
+    pthread_mutex_unlock(&shard->lock);
+
+    return derivative;
+}
+
+//------------------------------------------------------------------
+
+void SetDiffCacheLimit(const size_t bytes)
+{
+    pthread_once(&diff_cache_once, InitDiffCache);
+
+    for (size_t i = 0; i < DIFF_CACHE_SHARDS; i++)
+    {
+        DiffCacheShard* shard = &diff_cache_shards[i];
+
+        pthread_mutex_lock(&shard->lock);
+
+        shard->limit = bytes / DIFF_CACHE_SHARDS;
+        EvictEntries(shard);
+
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
+
+//------------------------------------------------------------------
+
+void ClearDiffCache()
+{
+    pthread_once(&diff_cache_once, InitDiffCache);
+
+    for (size_t i = 0; i < DIFF_CACHE_SHARDS; i++)
+    {
+        DiffCacheShard* shard = &diff_cache_shards[i];
+
+        pthread_mutex_lock(&shard->lock);
+
+        while (shard->oldest)
+            RemoveEntry(shard, shard->oldest);
+
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
+
+//------------------------------------------------------------------
+
+diff_cache_stats_t GetDiffCacheStats()
+{
+    pthread_once(&diff_cache_once, InitDiffCache);
+
+    diff_cache_stats_t stats = {};
+
+    for (size_t i = 0; i < DIFF_CACHE_SHARDS; i++)
+    {
+        DiffCacheShard* shard = &diff_cache_shards[i];
+
+        pthread_mutex_lock(&shard->lock);
+
+        stats.hits      += shard->hits;
+        stats.misses    += shard->misses;
+        stats.evictions += shard->evictions;
+        stats.entries   += shard->entries;
+        stats.bytes     += shard->bytes;
+
+        pthread_mutex_unlock(&shard->lock);
+    }
+
+    return stats;
+}
+
+//------------------------------------------------------------------
+
+// splitmix64 finalizer
+static inline uint64_t MixHash(uint64_t key)
+{
+    key ^= key >> 30;
+    key *= 0xBF58476D1CE4E5B9;
+    key ^= key >> 27;
+    key *= 0x94D049BB133111EB;
+    key ^= key >> 31;
+
+    return key;
+}
+
+//------------------------------------------------------------------
+
+// FNV-1a
+static uint64_t HashString(const char* str)
+{
+    assert(str);
+
+    uint64_t hash = 0xCBF29CE484222325;
+
+    for (; *str; str++)
+    {
+        hash ^= (uint64_t) (unsigned char) *str;
+        hash *= 0x100000001B3;
+    }
+
+    return hash;
+}
+
+//------------------------------------------------------------------
+
+static uint64_t HashNode(const Node* node, const variable_t* vars)
+{
+    assert(vars);
+
+    if (!node) return 0;
+
+    uint64_t key = (uint64_t) node->type + 1;
+
+    switch (node->type)
+    {
+        case (NodeType::NUMBER):
+        {
+            uint64_t bits = 0;
+            memcpy(&bits, &node->value.val, sizeof(bits));
+            key = key * 31 + bits;
+            break;
+        }
+        case (NodeType::VARIABLE):
+            key = key * 31 + (uint64_t) node->value.var;
+            key = key * 31 + HashString(vars[node->value.var].variable_name);
+            break;
+        case (NodeType::OPERATOR):
+            key = key * 31 + (uint64_t) node->value.opt;
+            break;
+        case (NodeType::POISON):
+        // fall through
+        default:
+            break;
+    }
+
+    key = MixHash(key * 1000003 + HashNode(node->left,  vars));
+    key = MixHash(key * 1000003 + HashNode(node->right, vars));
+
+    return key;
+}
+
+//------------------------------------------------------------------
+
+// variables must have the same ids and names, so cached tree is valid with variables of both
+static bool AreTreesSame(const Node* a, const variable_t* a_vars, const Node* b, const variable_t* b_vars)
+{
+    if (!a || !b)
+        return a == b;
+
+    if (a->type != b->type)
+        return false;
+
+    switch (a->type)
+    {
+        case (NodeType::NUMBER):
+            if (memcmp(&a->value.val, &b->value.val, sizeof(double)) != 0)
+                return false;
+            break;
+        case (NodeType::VARIABLE):
+            if (a->value.var != b->value.var ||
+                strcmp(a_vars[a->value.var].variable_name, b_vars[b->value.var].variable_name) != 0)
+                return false;
+            break;
+        case (NodeType::OPERATOR):
+            if (a->value.opt != b->value.opt)
+                return false;
+            break;
+        case (NodeType::POISON):
+        // fall through
+        default:
+            return false;
+    }
+
+    return AreTreesSame(a->left,  a_vars, b->left,  b_vars) &&
+           AreTreesSame(a->right, a_vars, b->right, b_vars);
+}
+
+//------------------------------------------------------------------
+
+static size_t CountNodes(const Node* node)
+{
+    if (!node) return 0;
+
+    return 1 + CountNodes(node->left) + CountNodes(node->right);
+}
+
+//------------------------------------------------------------------
+
+static Node* CopyTree(const Node* node, error_t* error)
+{
+    assert(error);
+
+    if (!node) return nullptr;
+
+    Node* left  = CopyTree(node->left,  error);
+    Node* right = CopyTree(node->right, error);
+
+    Node* copy = MakeNode(node->type, node->value, left, right, nullptr);
+    if (copy == nullptr)
+    {
+        DestructNodes(left);
+        DestructNodes(right);
+
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "CACHED DERIVATIVE";
+    }
+
+    return copy;
+}
+
+//------------------------------------------------------------------
+
+static expr_t* CopyExpression(const Node* root, const expr_t* vars_source, error_t* error)
+{
+    assert(vars_source);
+    assert(error);
+
+    expr_t* copy = MakeExpression(error, vars_source->max_vars_amt);
+    if (error->code != (int) ExpressionErrors::NONE)
+        return nullptr;
+
+    CopyVariablesArray(vars_source->vars, copy->vars, error);
+
+    DestructNodes(copy->root);
+    copy->root = CopyTree(root, error);
+
+    if (error->code != (int) ExpressionErrors::NONE)
+    {
+        DeleteExpression(copy);
+        return nullptr;
+    }
+
+    return copy;
+}
+
+//------------------------------------------------------------------
+
+static void DeleteExpression(expr_t* expr)
+{
+    if (!expr) return;
+
+    ExpressionDtor(expr);
+    free(expr);
+}
+
+//------------------------------------------------------------------
+
+static expr_t* DifferentiateTimes(const expr_t* expr, const char* var, const int order, error_t* error)
+{
+    assert(expr);
+    assert(var);
+    assert(error);
+
+    const expr_t* current    = expr;
+    expr_t*       derivative = nullptr;
+
+    for (int i = 0; i < order; i++)
+    {
+        expr_t* next = DifferentiateExpression(current, var, error);
+
+        DeleteExpression(derivative);
+        derivative = next;
+        current    = next;
+
+        if (error->code != (int) ExpressionErrors::NONE)
+        {
+            DeleteExpression(derivative);
+            return nullptr;
+        }
+    }
+
+    return derivative;
+}
+
+//------------------------------------------------------------------
+
+static DiffCacheEntry* MakeEntry(const expr_t* expr, const expr_t* derivative, const uint64_t hash,
+                                 const int var_id, const int order, error_t* error)
+{
+    assert(expr);
+    assert(derivative);
+    assert(error);
+
+    DiffCacheEntry* entry = (DiffCacheEntry*) calloc(1, sizeof(DiffCacheEntry));
+    if (entry == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "CACHE ENTRY";
+        return nullptr;
+    }
+
+    entry->hash       = hash;
+    entry->var_id     = var_id;
+    entry->order      = order;
+    entry->expr       = CopyExpression(expr->root, expr, error);
+    entry->derivative = CopyExpression(derivative->root, derivative, error);
+
+    if (error->code != (int) ExpressionErrors::NONE)
+    {
+        DeleteEntry(entry);
+        return nullptr;
+    }
+
+    entry->bytes = sizeof(DiffCacheEntry) +
+                   (CountNodes(expr->root) + CountNodes(derivative->root)) * sizeof(Node) +
+                   (expr->max_vars_amt + derivative->max_vars_amt) * (sizeof(variable_t) + MAX_VARIABLE_LEN);
+
+    return entry;
+}
+
+//------------------------------------------------------------------
+
+static void DeleteEntry(DiffCacheEntry* entry)
+{
+    assert(entry);
+
+    DeleteExpression(entry->expr);
+    DeleteExpression(entry->derivative);
+    free(entry);
+}
+
+//------------------------------------------------------------------
+
+static inline DiffCacheEntry** GetBucket(DiffCacheShard* shard, const uint64_t hash)
+{
+    return &shard->buckets[(hash / DIFF_CACHE_SHARDS) % DIFF_CACHE_BUCKETS];
+}
+
+//------------------------------------------------------------------
+
+static DiffCacheEntry* FindEntry(DiffCacheShard* shard, const uint64_t hash, const expr_t* expr,
+                                 const int var_id, const int order)
+{
+    assert(shard);
+    assert(expr);
+
+    for (DiffCacheEntry* entry = *GetBucket(shard, hash); entry; entry = entry->next_in_bucket)
+    {
+        if (entry->hash == hash && entry->var_id == var_id && entry->order == order &&
+            AreTreesSame(entry->expr->root, entry->expr->vars, expr->root, expr->vars))
+            return entry;
+    }
+
+    return nullptr;
+}
+
+//------------------------------------------------------------------
+
+static void InsertEntry(DiffCacheShard* shard, DiffCacheEntry* entry)
+{
+    assert(shard);
+    assert(entry);
+
+    DiffCacheEntry** bucket = GetBucket(shard, entry->hash);
+
+    entry->next_in_bucket = *bucket;
+    *bucket               = entry;
+
+    PushNewest(shard, entry);
+
+    shard->bytes += entry->bytes;
+    shard->entries++;
+}
+
+//------------------------------------------------------------------
+
+static void RemoveEntry(DiffCacheShard* shard, DiffCacheEntry* entry)
+{
+    assert(shard);
+    assert(entry);
+
+    DiffCacheEntry** link = GetBucket(shard, entry->hash);
+
+    while (*link != entry)
+        link = &(*link)->next_in_bucket;
+
+    *link = entry->next_in_bucket;
+
+    UnlinkEntry(shard, entry);
+
+    shard->bytes -= entry->bytes;
+    shard->entries--;
+
+    DeleteEntry(entry);
+}
+
+//------------------------------------------------------------------
+
+static void UnlinkEntry(DiffCacheShard* shard, DiffCacheEntry* entry)
+{
+    assert(shard);
+    assert(entry);
+
+    if (entry->newer) entry->newer->older = entry->older;
+    else              shard->newest       = entry->older;
+
+    if (entry->older) entry->older->newer = entry->newer;
+    else              shard->oldest       = entry->newer;
+
+    entry->newer = nullptr;
+    entry->older = nullptr;
+}
+
+//------------------------------------------------------------------
+
+static void PushNewest(DiffCacheShard* shard, DiffCacheEntry* entry)
+{
+    assert(shard);
+    assert(entry);
+
+    entry->older = shard->newest;
+    entry->newer = nullptr;
+
+    if (shard->newest) shard->newest->newer = entry;
+    else               shard->oldest        = entry;
+
+    shard->newest = entry;
+}
+
+//------------------------------------------------------------------
+
+static void EvictEntries(DiffCacheShard* shard)
+{
+    assert(shard);
+
+    while (shard->bytes > shard->limit && shard->oldest)
+    {
+        RemoveEntry(shard, shard->oldest);
+        shard->evictions++;
+    }
+}
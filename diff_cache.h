@@ -0,0 +1,41 @@
+#ifndef __DIFF_CACHE_H_
+#define __DIFF_CACHE_H_
+
+#include "expression/expression.h"
+
+// ======================================================================
+// DERIVATIVE CACHE
+// ======================================================================
+
+// process-wide cache of simplified derivatives keyed by structural hash of tree (with names
+// of its variables), variable and order. Hit is confirmed by full comparison and gives a copy,
+// so cached trees are never shared with callers. Cache is split into shards with their own lock
+// and LRU list, threads with different expressions rarely wait for each other; misses
+// differentiate without any lock held
+
+static const size_t DIFF_CACHE_SHARDS        = 16;
+static const size_t DIFF_CACHE_BUCKETS       = 1024;        // of every shard
+static const size_t DIFF_CACHE_DEFAULT_LIMIT = 64 << 20;    // bytes
+
+struct DiffCacheStats
+{
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+
+    size_t entries;
+    size_t bytes;
+};
+typedef struct DiffCacheStats diff_cache_stats_t;
+
+// same as DifferentiateExpression applied order times, without narration; result belongs to caller
+// and has variables of expr
+expr_t*             GetCachedDerivative(const expr_t* expr, const char* var, const int order, error_t* error);
+
+// least recently used entries are evicted at once if cache does not fit new limit
+void                SetDiffCacheLimit(const size_t bytes);
+void                ClearDiffCache();
+
+diff_cache_stats_t  GetDiffCacheStats();
+
+#endif
@@ -0,0 +1,539 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "equations.h"
+#include "calculation.h"
+
+static const size_t SYSTEM_START_CAPACITY = 16;
+
+static int      FindOrAddVariable(eq_system_t* system, const variable_t* var, error_t* error);
+static Node*    CopyWithSystemVars(eq_system_t* system, const Node* node, const variable_t* vars, error_t* error);
+
+static void     FindPattern(eq_system_t* system, error_t* error);
+static void     CollectVariables(const Node* node, const int row, int* stamps, int* cols, size_t* cols_amt);
+static int      CompareColumns(const void* a, const void* b);
+static void     ColorColumns(eq_system_t* system, error_t* error);
+
+static void     SweepForward(eq_system_t* system, error_t* error);
+
+//------------------------------------------------------------------
+
+ExpressionErrors SystemCtor(eq_system_t* system, error_t* error)
+{
+    assert(system);
+    assert(error);
+
+    *system = {};
+
+    system->roots = (Node**)      calloc(SYSTEM_START_CAPACITY, sizeof(Node*));
+    system->vars  = (variable_t*) calloc(SYSTEM_START_CAPACITY, sizeof(variable_t));
+
+    if (system->roots == nullptr || system->vars == nullptr)
+    {
+        SystemDtor(system);
+
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "EQUATION SYSTEM";
+        return ExpressionErrors::ALLOCATE_MEMORY;
+    }
+
+    system->equations_capacity = SYSTEM_START_CAPACITY;
+    system->vars_capacity      = SYSTEM_START_CAPACITY;
+
+    return ExpressionErrors::NONE;
+}
+
+//------------------------------------------------------------------
+
+void SystemDtor(eq_system_t* system)
+{
+    assert(system);
+
+    for (size_t i = 0; i < system->equations_amt; i++)
+        DestructNodes(system->roots[i]);
+
+    if (system->vars)
+        DestructVariablesArray(system->vars, system->vars_amt);
+
+    TapeDtor(&system->tape);
+
+    free(system->roots);
+    free(system->vars);
+    free(system->row_start);
+    free(system->cols);
+    free(system->colors);
+    free(system->tangents);
+
+    *system = {};
+}
+
+//------------------------------------------------------------------
+
+int SystemAddExpression(eq_system_t* system, const expr_t* expr, error_t* error)
+{
+    assert(system);
+    assert(expr);
+    assert(error);
+    assert(system->row_start == nullptr);
+
+    if (system->equations_amt == system->equations_capacity)
+    {
+        Node** roots = (Node**) realloc(system->roots, system->equations_capacity * 2 * sizeof(Node*));
+        if (roots == nullptr)
+        {
+            error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+            error->data = "SYSTEM EQUATIONS";
+            return -1;
+        }
+
+        system->roots               = roots;
+        system->equations_capacity *= 2;
+    }
+
+    Node* root = CopyWithSystemVars(system, expr->root, expr->vars, error);
+    if (error->code != (int) ExpressionErrors::NONE)
+    {
+        DestructNodes(root);
+        return -1;
+    }
+
+    system->roots[system->equations_amt] = root;
+
+    return (int) system->equations_amt++;
+}
+
+//------------------------------------------------------------------
+
+int SystemFindVariable(const eq_system_t* system, const char* name)
+{
+    assert(system);
+    assert(name);
+
+    for (size_t i = 0; i < system->vars_amt; i++)
+    {
+        if (!strncmp(system->vars[i].variable_name, name, MAX_VARIABLE_LEN))
+            return (int) i;
+    }
+
+    return NO_VARIABLE;
+}
+
+//------------------------------------------------------------------
+
+// new variable gets value of the first equation that has it
+static int FindOrAddVariable(eq_system_t* system, const variable_t* var, error_t* error)
+{
+    assert(system);
+    assert(var);
+    assert(error);
+
+    int id = SystemFindVariable(system, var->variable_name);
+    if (id != NO_VARIABLE)
+        return id;
+
+    if (system->vars_amt == system->vars_capacity)
+    {
+        variable_t* vars = (variable_t*) realloc(system->vars, system->vars_capacity * 2 * sizeof(variable_t));
+        if (vars == nullptr)
+        {
+            error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+            error->data = "SYSTEM VARIABLES";
+            return NO_VARIABLE;
+        }
+
+        system->vars           = vars;
+        system->vars_capacity *= 2;
+    }
+
+    char* name = strndup(var->variable_name, MAX_VARIABLE_LEN);
+    if (name == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "SYSTEM VARIABLES";
+        return NO_VARIABLE;
+    }
+
+    variable_t* new_var = &system->vars[system->vars_amt];
+
+    new_var->variable_name = name;
+    new_var->isfree        = false;
+    new_var->value         = var->value;
+    new_var->array         = nullptr;
+    new_var->array_size    = 0;
+
+    return (int) system->vars_amt++;
+}
+
+//------------------------------------------------------------------
+
+static Node* CopyWithSystemVars(eq_system_t* system, const Node* node, const variable_t* vars, error_t* error)
+{
+    assert(system);
+    assert(vars);
+    assert(error);
+
+    if (!node) return nullptr;
+
+    NodeValue value = node->value;
+
+    if (node->type == NodeType::VARIABLE)
+    {
+        value.var = FindOrAddVariable(system, &vars[node->value.var], error);
+        if (error->code != (int) ExpressionErrors::NONE)
+            return nullptr;
+    }
+
+    Node* left  = CopyWithSystemVars(system, node->left,  vars, error);
+    Node* right = CopyWithSystemVars(system, node->right, vars, error);
+
+    Node* copy = MakeNode(node->type, value, left, right, nullptr);
+    if (copy == nullptr || error->code != (int) ExpressionErrors::NONE)
+    {
+        DestructNodes(left);
+        DestructNodes(right);
+
+        if (copy)
+            NodeDtor(copy);
+
+        if (error->code == (int) ExpressionErrors::NONE)
+        {
+            error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+            error->data = "SYSTEM EQUATIONS";
+        }
+
+        return nullptr;
+    }
+
+    return copy;
+}
+
+//------------------------------------------------------------------
+
+ExpressionErrors SystemCompile(eq_system_t* system, error_t* error)
+{
+    assert(system);
+    assert(error);
+    assert(system->row_start == nullptr);
+
+    expr_t*        exprs = (expr_t*)        calloc(system->equations_amt + 1, sizeof(expr_t));
+    const expr_t** ptrs  = (const expr_t**) calloc(system->equations_amt + 1, sizeof(expr_t*));
+
+    if (exprs == nullptr || ptrs == nullptr)
+    {
+        free(exprs);
+        free(ptrs);
+
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "SYSTEM TAPE";
+        return ExpressionErrors::ALLOCATE_MEMORY;
+    }
+
+    // equations are lowered by tape only, so they are wrapped without copying
+    for (size_t i = 0; i < system->equations_amt; i++)
+    {
+        exprs[i] = {.root = system->roots[i], .vars = system->vars, .max_vars_amt = system->vars_amt};
+        ptrs[i]  = &exprs[i];
+    }
+
+    TapeCtor(&system->tape, ptrs, system->equations_amt, error);
+
+    free(exprs);
+    free(ptrs);
+
+    if (error->code == (int) ExpressionErrors::NONE)
+        FindPattern(system, error);
+
+    if (error->code == (int) ExpressionErrors::NONE)
+        ColorColumns(system, error);
+
+    if (error->code == (int) ExpressionErrors::NONE)
+    {
+        system->tangents = (double*) calloc(system->tape.kernel.ir.size * system->colors_amt + 1, sizeof(double));
+        if (system->tangents == nullptr)
+        {
+            error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+            error->data = "SYSTEM TANGENTS";
+        }
+    }
+
+    return (ExpressionErrors) error->code;
+}
+
+//------------------------------------------------------------------
+
+// variables of every equation, once each and sorted; derivative by any other variable is zero
+static void FindPattern(eq_system_t* system, error_t* error)
+{
+    assert(system);
+    assert(error);
+
+    size_t rows_amt = system->equations_amt;
+
+    int*   stamps   = (int*)    calloc(system->vars_amt + 1, sizeof(int));
+    int*   row_cols = (int*)    calloc(system->vars_amt + 1, sizeof(int));
+    size_t capacity = rows_amt + 1;
+
+    system->row_start = (size_t*) calloc(rows_amt + 1, sizeof(size_t));
+    system->cols      = (int*)    calloc(capacity, sizeof(int));
+
+    if (stamps == nullptr || row_cols == nullptr || system->row_start == nullptr || system->cols == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "JACOBIAN PATTERN";
+    }
+
+    for (size_t i = 0; i < system->vars_amt && stamps; i++)
+        stamps[i] = -1;
+
+    for (size_t row = 0; row < rows_amt && error->code == (int) ExpressionErrors::NONE; row++)
+    {
+        size_t row_amt = 0;
+
+        CollectVariables(system->roots[row], (int) row, stamps, row_cols, &row_amt);
+        qsort(row_cols, row_amt, sizeof(int), CompareColumns);
+
+        if (system->nonzeros_amt + row_amt > capacity)
+        {
+            while (system->nonzeros_amt + row_amt > capacity)
+                capacity *= 2;
+
+            int* cols = (int*) realloc(system->cols, capacity * sizeof(int));
+            if (cols == nullptr)
+            {
+                error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+                error->data = "JACOBIAN PATTERN";
+                break;
+            }
+
+            system->cols = cols;
+        }
+
+        memcpy(system->cols + system->nonzeros_amt, row_cols, row_amt * sizeof(int));
+
+        system->row_start[row]  = system->nonzeros_amt;
+        system->nonzeros_amt   += row_amt;
+    }
+
+    if (system->row_start)
+        system->row_start[rows_amt] = system->nonzeros_amt;
+
+    free(stamps);
+    free(row_cols);
+}
+
+//------------------------------------------------------------------
+
+static void CollectVariables(const Node* node, const int row, int* stamps, int* cols, size_t* cols_amt)
+{
+    assert(stamps);
+    assert(cols);
+    assert(cols_amt);
+
+    if (!node) return;
+
+    if (node->type == NodeType::VARIABLE && stamps[node->value.var] != row)
+    {
+        stamps[node->value.var] = row;
+        cols[(*cols_amt)++]     = node->value.var;
+    }
+
+    CollectVariables(node->left,  row, stamps, cols, cols_amt);
+    CollectVariables(node->right, row, stamps, cols, cols_amt);
+}
+
+//------------------------------------------------------------------
+
+static int CompareColumns(const void* a, const void* b)
+{
+    return *(const int*) a - *(const int*) b;
+}
+
+//------------------------------------------------------------------
+
+// greedy distance-2 coloring, columns with more nonzeros go first: column gets the least color
+// none of the columns sharing a row with it has
+static void ColorColumns(eq_system_t* system, error_t* error)
+{
+    assert(system);
+    assert(error);
+
+    size_t cols_amt = system->vars_amt;
+    size_t nnz      = system->nonzeros_amt;
+
+    system->colors = (int*) calloc(cols_amt + 1, sizeof(int));
+
+    size_t* col_start = (size_t*) calloc(cols_amt + 2, sizeof(size_t));
+    size_t* col_rows  = (size_t*) calloc(nnz + 1,      sizeof(size_t));
+    size_t* col_fill  = (size_t*) calloc(cols_amt + 1, sizeof(size_t));
+    size_t* forbidden = (size_t*) calloc(cols_amt + 1, sizeof(size_t));
+
+    if (system->colors == nullptr || col_start == nullptr || col_rows == nullptr ||
+        col_fill == nullptr || forbidden == nullptr)
+    {
+        free(col_start);
+        free(col_rows);
+        free(col_fill);
+        free(forbidden);
+
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "JACOBIAN COLORING";
+        return;
+    }
+
+    // rows of every column, transposed pattern
+    for (size_t i = 0; i < nnz; i++)
+        col_start[system->cols[i] + 1]++;
+
+    size_t max_degree = 0;
+
+    for (size_t col = 0; col < cols_amt; col++)
+    {
+        if (col_start[col + 1] > max_degree)
+            max_degree = col_start[col + 1];
+
+        col_start[col + 1] += col_start[col];
+    }
+
+    for (size_t row = 0; row < system->equations_amt; row++)
+    {
+        for (size_t i = system->row_start[row]; i < system->row_start[row + 1]; i++)
+        {
+            size_t col = (size_t) system->cols[i];
+            col_rows[col_start[col] + col_fill[col]++] = row;
+        }
+    }
+
+    // forbidden[color] is the last column (plus one) that can not take it
+    for (size_t col = 0; col < cols_amt; col++)
+        system->colors[col] = -1;
+
+    system->colors_amt = 0;
+
+    for (size_t degree = max_degree; degree > 0; degree--)
+    {
+        for (size_t col = 0; col < cols_amt; col++)
+        {
+            if (col_start[col + 1] - col_start[col] != degree)
+                continue;
+
+            for (size_t i = col_start[col]; i < col_start[col + 1]; i++)
+            {
+                size_t row = col_rows[i];
+
+                for (size_t k = system->row_start[row]; k < system->row_start[row + 1]; k++)
+                {
+                    int color = system->colors[system->cols[k]];
+                    if (color >= 0)
+                        forbidden[color] = col + 1;
+                }
+            }
+
+            size_t color = 0;
+            while (color < system->colors_amt && forbidden[color] == col + 1)
+                color++;
+
+            system->colors[col] = (int) color;
+            if (color == system->colors_amt)
+                system->colors_amt++;
+        }
+    }
+
+    free(col_start);
+    free(col_rows);
+    free(col_fill);
+    free(forbidden);
+}
+
+//------------------------------------------------------------------
+
+void CalculateSystemJacobian(eq_system_t* system, double* values, double* jacobian, error_t* error)
+{
+    assert(system);
+    assert(values);
+    assert(jacobian);
+    assert(error);
+    assert(system->row_start);
+
+    IrKernelCalculate(&system->tape.kernel, system->vars, values, error);
+    if (error->code != (int) ExpressionErrors::NONE)
+        return;
+
+    SweepForward(system, error);
+    if (error->code != (int) ExpressionErrors::NONE)
+        return;
+
+    const ir_t* ir         = &system->tape.kernel.ir;
+    size_t      colors_amt = system->colors_amt;
+
+    for (size_t row = 0; row < system->equations_amt; row++)
+    {
+        int output = ir->outputs[row];
+
+        for (size_t i = system->row_start[row]; i < system->row_start[row + 1]; i++)
+        {
+            if (output == NO_IR_VALUE || !system->tape.active[output])
+            {
+                jacobian[i] = 0;
+                continue;
+            }
+
+            jacobian[i] = system->tangents[(size_t) output * colors_amt + (size_t) system->colors[system->cols[i]]];
+        }
+    }
+}
+
+//------------------------------------------------------------------
+
+// every instruction has tangent for every color: variable has 1 in its own color, partials are taken
+// once per instruction and applied to all colors
+static void SweepForward(eq_system_t* system, error_t* error)
+{
+    assert(system);
+    assert(error);
+
+    const ir_t*   ir         = &system->tape.kernel.ir;
+    const double* values     = system->tape.kernel.values;
+    const bool*   active     = system->tape.active;
+    size_t        colors_amt = system->colors_amt;
+
+    for (size_t i = 0; i < ir->size; i++)
+    {
+        const IrInstruction* instr    = &ir->code[i];
+        double*              tangents = system->tangents + i * colors_amt;
+
+        if (!active[i])
+            continue;
+
+        memset(tangents, 0, colors_amt * sizeof(double));
+
+        if (instr->type == NodeType::VARIABLE)
+        {
+            int color = system->colors[instr->value.var];
+            if (color >= 0)
+                tangents[color] = 1;
+            continue;
+        }
+
+        double left  = (instr->left  != NO_IR_VALUE) ? values[instr->left]  : 0;
+        double right = (instr->right != NO_IR_VALUE) ? values[instr->right] : 0;
+
+        int     operands[] = {instr->left,   instr->right};
+        NodeKid kids[]     = {NodeKid::LEFT, NodeKid::RIGHT};
+
+        for (size_t k = 0; k < 2; k++)
+        {
+            int operand = operands[k];
+            if (operand == NO_IR_VALUE || !active[operand])
+                continue;
+
+            double        partial  = CalculatePartial(left, right, values[i], instr->value.opt, kids[k], error);
+            const double* operand_tangents = system->tangents + (size_t) operand * colors_amt;
+
+            // zero tangent keeps its column clean of infinite or NaN partial
+            for (size_t color = 0; color < colors_amt; color++)
+                if (fpclassify(operand_tangents[color]) != FP_ZERO)
+                    tangents[color] += partial * operand_tangents[color];
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef __EQUATIONS_H_
+#define __EQUATIONS_H_
+
+#include "expression/expression.h"
+#include "tape.h"
+
+// ======================================================================
+// SYSTEMS OF EQUATIONS
+// ======================================================================
+
+// equations are copied into one symbol table (variables are matched by name, there is no
+// MAX_VARIABLES_AMT limit) and recorded as one tape. Compilation finds Jacobian pattern from variables
+// of every equation and colors its columns so that columns of one color never share a row;
+// then all colors go through one forward pass as a vector of tangents, and every nonzero is
+// tangent of its row's output in its column's color
+
+struct EquationSystem
+{
+    Node**          roots;              // equations, their variables are ids of vars
+    size_t          equations_amt;
+    size_t          equations_capacity;
+
+    variable_t*     vars;
+    size_t          vars_amt;
+    size_t          vars_capacity;
+
+    // made by SystemCompile
+
+    tape_t          tape;
+
+    size_t*         row_start;          // Jacobian in CSR: equations_amt + 1 row starts,
+    int*            cols;               // sorted column of every nonzero
+    size_t          nonzeros_amt;
+
+    int*            colors;             // of every variable, -1 if no equation uses it
+    size_t          colors_amt;         // tangents in forward pass
+
+    double*         tangents;           // colors_amt for every instruction
+};
+typedef struct EquationSystem eq_system_t;
+
+ExpressionErrors    SystemCtor(eq_system_t* system, error_t* error);
+void                SystemDtor(eq_system_t* system);
+
+// returns index of equation; equations can not be added after compilation
+int                 SystemAddExpression(eq_system_t* system, const expr_t* expr, error_t* error);
+// id of variable in system->vars, NO_VARIABLE if no equation uses it
+int                 SystemFindVariable(const eq_system_t* system, const char* name);
+
+// pattern, coloring and tape are made once and reused by every calculation
+ExpressionErrors    SystemCompile(eq_system_t* system, error_t* error);
+
+// values of variables are taken from system->vars; values gets every equation,
+// jacobian gets nonzeros_amt elements in order of cols
+void                CalculateSystemJacobian(eq_system_t* system, double* values, double* jacobian, error_t* error);
+
+#endif
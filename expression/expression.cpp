@@ -13,6 +13,9 @@
 
 static ExpressionErrors  VerifyNodes(const Node* node, error_t* error);
 
+static thread_local Node*   node_pool      = nullptr;      // linked by left
+static thread_local size_t  node_pool_size = 0;
+
 // ======================================================================
 // EXPRESSION VARIABLES
 // ======================================================================
@@ -78,6 +81,8 @@ static void InitVariablesArray(variable_t* variables, const size_t size)
         variables[i].isfree        = true;
         variables[i].variable_name = "";
         variables[i].value         = 0;
+        variables[i].array         = nullptr;
+        variables[i].array_size    = 0;
     }
 }
 
@@ -93,6 +98,8 @@ void DestructVariablesArray(variable_t* variables, const size_t size)
             free(variables[i].variable_name);
         variables[i].isfree        = true;
         variables[i].value         = 0;
+        variables[i].array         = nullptr;
+        variables[i].array_size    = 0;
     }
 }
 
@@ -122,6 +129,8 @@ void CopyVariablesArray(const variable_t* vars, variable_t* dest, error_t* error
         dest[i].variable_name = name;
         dest[i].isfree        = vars[i].isfree;
         dest[i].value         = vars[i].value;
+        dest[i].array         = vars[i].array;
+        dest[i].array_size    = vars[i].array_size;
     }
 }
 
@@ -191,9 +200,19 @@ int SaveVariable(variable_t* vars, const char* new_var)
 Node* MakeNode(const NodeType type, const NodeValue value,
                Node* left, Node* right, Node* parent)
 {
-    Node* node = (Node*) calloc(1, sizeof(Node));
-    if (node == nullptr)
-        return nullptr;
+    Node* node = node_pool;
+
+    if (node != nullptr)
+    {
+        node_pool = node->left;
+        node_pool_size--;
+    }
+    else
+    {
+        node = (Node*) calloc(1, sizeof(Node));
+        if (node == nullptr)
+            return nullptr;
+    }
 
     node->type   = type;
     node->value  = value;
@@ -216,7 +235,30 @@ void NodeDtor(Node* node)
 {
     assert(node);
 
-    free(node);
+    if (node_pool_size >= NODE_POOL_MAX_SIZE)
+    {
+        free(node);
+        return;
+    }
+
+    node->left = node_pool;
+    node_pool  = node;
+    node_pool_size++;
+}
+
+//-----------------------------------------------------------------------------------------------------
+
+void ReleaseNodePool()
+{
+    while (node_pool)
+    {
+        Node* next = node_pool->left;
+
+        free(node_pool);
+        node_pool = next;
+    }
+
+    node_pool_size = 0;
 }
 
 //-----------------------------------------------------------------------------------------------------
@@ -391,6 +433,21 @@ int PrintExpressionError(FILE* fp, const void* err, const char* func, const char
             LOG_END();
             return (int) error->code;
 
+        case (ExpressionErrors::SIZE_MISMATCH):
+            fprintf(fp, "ARRAY SIZES OF %s CAN NOT BE BROADCAST<br>\n", (const char*) error->data);
+            LOG_END();
+            return (int) error->code;
+
+        case (ExpressionErrors::TOO_MANY_VARIABLES):
+            fprintf(fp, "%s CAN NOT HOLD SO MANY VARIABLES<br>\n", (const char*) error->data);
+            LOG_END();
+            return (int) error->code;
+
+        case (ExpressionErrors::INVALID_ORDER):
+            fprintf(fp, "ORDER OF %s CAN NOT BE NEGATIVE<br>\n", (const char*) error->data);
+            LOG_END();
+            return (int) error->code;
+
         case (ExpressionErrors::UNKNOWN):
         // fall through
         default:
@@ -23,6 +23,9 @@ enum class ExpressionErrors
     INVALID_EXPRESSION_FORMAT,
     UNKNOWN_OPERATION,
     NO_DIFF_VARIABLE,
+    SIZE_MISMATCH,
+    TOO_MANY_VARIABLES,
+    INVALID_ORDER,
 
     UNKNOWN
 };
@@ -87,6 +90,9 @@ struct VariableInfo
     char*  variable_name;
     bool   isfree;
     double value;
+
+    const double* array;            // not owned, nullptr for scalar variable
+    size_t        array_size;
 };
 
 typedef struct VariableInfo variable_t;
@@ -143,6 +149,13 @@ struct Node
 Node* MakeNode(const NodeType type, const NodeValue value,
                Node* left = nullptr, Node* right = nullptr, Node* parent = nullptr);
 void  NodeDtor(Node* node);
+
+// freed nodes are kept by the thread that frees them for its next MakeNode (up to NODE_POOL_MAX_SIZE),
+// so threads building trees at once reuse their own memory. Every thread owns its pool: worker releases
+// it with ReleaseNodePool before exit, main thread registers ReleaseNodePool with atexit
+static const size_t NODE_POOL_MAX_SIZE = 1 << 14;
+
+void  ReleaseNodePool();
 void  DestructNodes(Node* root);
 void  FillNode(Node* node, Node* left, Node* right, Node* parent, const NodeType type, const NodeValue value);
 Node* ConnectNodes(Node* node, Node* left, Node* right);
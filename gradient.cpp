@@ -0,0 +1,547 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "gradient.h"
+
+// value of IR program that is being built, arithmetic on it appends (folded) instructions,
+// so DEF_OP partials written for doubles build their symbolic versions
+struct IrSymbol
+{
+    ir_t*       ir;
+    int         value;
+    error_t*    error;
+};
+
+static IrSymbol     MakeSymbol(const IrSymbol context, const double val);
+static IrSymbol     MakeSymbol(const IrSymbol context, const IrSymbol symbol);
+static IrSymbol     MakeOperation(const IrSymbol context, const Operators operation, const int left, const int right);
+
+static IrSymbol     operator+(const IrSymbol left, const IrSymbol right);
+static IrSymbol     operator-(const IrSymbol left, const IrSymbol right);
+static IrSymbol     operator*(const IrSymbol left, const IrSymbol right);
+static IrSymbol     operator/(const IrSymbol left, const IrSymbol right);
+static IrSymbol     operator+(const double left, const IrSymbol right);
+static IrSymbol     operator-(const double left, const IrSymbol right);
+static IrSymbol     operator/(const double left, const IrSymbol right);
+static IrSymbol     operator-(const IrSymbol left, const double right);
+static IrSymbol     operator-(const IrSymbol symbol);
+
+static IrSymbol     pow(const IrSymbol base, const IrSymbol power);
+static IrSymbol     log(const IrSymbol symbol);
+static IrSymbol     sin(const IrSymbol symbol);
+static IrSymbol     cos(const IrSymbol symbol);
+static IrSymbol     sqrt(const IrSymbol symbol);
+
+static IrSymbol     MakeSymbolicPartial(const IrSymbol left, const IrSymbol right, const IrSymbol result,
+                                        const Operators operation, const NodeKid kid);
+
+static int*         FindVariablesIds(const expr_t* expr, const char* const* vars, const size_t vars_amt,
+                                     error_t* error);
+static void         MarkActive(const ir_t* ir, const int* ids, const size_t vars_amt, bool* active);
+static void         SweepBackward(ir_t* ir, const size_t size, const bool* active, int* adjoints,
+                                  error_t* error);
+
+static int          DifferentiateValue(ir_t* ir, const int value, const int var_id, int** memo, size_t* memo_size,
+                                       error_t* error);
+static void         ReserveMemo(int** memo, size_t* memo_size, const size_t size, error_t* error);
+static int          DifferentiateInstruction(ir_t* ir, const int value, const int var_id, const int* memo,
+                                             const int zero, const int one, error_t* error);
+
+//------------------------------------------------------------------
+
+static IrSymbol MakeSymbol(const IrSymbol context, const double val)
+{
+    int value = IrAddValue(context.ir, NodeType::NUMBER, {.val = val}, NO_IR_VALUE, NO_IR_VALUE, context.error);
+
+    return {context.ir, value, context.error};
+}
+
+//------------------------------------------------------------------
+
+static IrSymbol MakeSymbol(const IrSymbol context, const IrSymbol symbol)
+{
+    (void) context;
+
+    return symbol;
+}
+
+//------------------------------------------------------------------
+
+static IrSymbol MakeOperation(const IrSymbol context, const Operators operation, const int left, const int right)
+{
+    int value = IrAddOperation(context.ir, operation, left, right, context.error);
+
+    return {context.ir, value, context.error};
+}
+
+//------------------------------------------------------------------
+
+static IrSymbol operator+(const IrSymbol left, const IrSymbol right)
+{
+    return MakeOperation(left, Operators::ADD, left.value, right.value);
+}
+
+static IrSymbol operator-(const IrSymbol left, const IrSymbol right)
+{
+    return MakeOperation(left, Operators::SUB, left.value, right.value);
+}
+
+static IrSymbol operator*(const IrSymbol left, const IrSymbol right)
+{
+    return MakeOperation(left, Operators::MUL, left.value, right.value);
+}
+
+static IrSymbol operator/(const IrSymbol left, const IrSymbol right)
+{
+    return MakeOperation(left, Operators::DIV, left.value, right.value);
+}
+
+static IrSymbol operator+(const double left, const IrSymbol right)
+{
+    return MakeSymbol(right, left) + right;
+}
+
+static IrSymbol operator-(const double left, const IrSymbol right)
+{
+    return MakeSymbol(right, left) - right;
+}
+
+static IrSymbol operator/(const double left, const IrSymbol right)
+{
+    return MakeSymbol(right, left) / right;
+}
+
+static IrSymbol operator-(const IrSymbol left, const double right)
+{
+    return left - MakeSymbol(left, right);
+}
+
+static IrSymbol operator-(const IrSymbol symbol)
+{
+    return MakeSymbol(symbol, -1) * symbol;
+}
+
+//------------------------------------------------------------------
+
+static IrSymbol pow(const IrSymbol base, const IrSymbol power)
+{
+    return MakeOperation(base, Operators::DEG, base.value, power.value);
+}
+
+static IrSymbol log(const IrSymbol symbol)
+{
+    return MakeOperation(symbol, Operators::LN, NO_IR_VALUE, symbol.value);
+}
+
+static IrSymbol sin(const IrSymbol symbol)
+{
+    return MakeOperation(symbol, Operators::SIN, NO_IR_VALUE, symbol.value);
+}
+
+static IrSymbol cos(const IrSymbol symbol)
+{
+    return MakeOperation(symbol, Operators::COS, NO_IR_VALUE, symbol.value);
+}
+
+static IrSymbol sqrt(const IrSymbol symbol)
+{
+    return pow(symbol, MakeSymbol(symbol, 0.5));
+}
+
+//------------------------------------------------------------------
+
+#define DEF_OP(name, symb, priority, arg_amt, action, gnu_symb, type, tex_symb,                       \
+               need_left_brackets, left_is_figure, need_right_brackets, right_is_figure, diff,        \
+               partial_1, partial_2, ...)                                                             \
+            case (Operators::name):                                                                 \
+                if (kid == NodeKid::LEFT)                                                           \
+                    return MakeSymbol(RESULT, partial_1);                                           \
+                return MakeSymbol(RESULT, partial_2);                                               \
+
+static IrSymbol MakeSymbolicPartial(const IrSymbol NUMBER_1, const IrSymbol NUMBER_2, const IrSymbol RESULT,
+                                    const Operators operation, const NodeKid kid)
+{
+    (void) NUMBER_1;
+
+    switch (operation)
+    {
+        #include "operations.h"
+        default:
+            RESULT.error->code = (int) ExpressionErrors::UNKNOWN_OPERATION;
+            return {RESULT.ir, NO_IR_VALUE, RESULT.error};
+    }
+}
+
+#undef DEF_OP
+
+//------------------------------------------------------------------
+
+ExpressionErrors GradientExpression(ir_t* gradient, const expr_t* expr, const char* const* vars,
+                                    const size_t vars_amt, error_t* error)
+{
+    assert(gradient);
+    assert(expr);
+    assert(vars);
+    assert(error);
+
+    int* ids = FindVariablesIds(expr, vars, vars_amt, error);
+    if (ids == nullptr)
+        return (ExpressionErrors) error->code;
+
+    if (IrCtor(gradient, error) != ExpressionErrors::NONE)
+    {
+        free(ids);
+        return (ExpressionErrors) error->code;
+    }
+
+    int output = IrLowerNode(gradient, expr->root, error);
+    size_t size = gradient->size;
+
+    bool* active   = (bool*) calloc(size + 1, sizeof(bool));
+    int*  adjoints = (int*)  calloc(size + 1, sizeof(int));
+
+    if (error->code == (int) ExpressionErrors::NONE && (active == nullptr || adjoints == nullptr))
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "GRADIENT";
+    }
+
+    if (error->code == (int) ExpressionErrors::NONE)
+    {
+        for (size_t i = 0; i < size; i++)
+            adjoints[i] = NO_IR_VALUE;
+
+        MarkActive(gradient, ids, vars_amt, active);
+
+        if (output != NO_IR_VALUE && active[output])
+        {
+            adjoints[output] = IrAddValue(gradient, NodeType::NUMBER, {.val = 1}, NO_IR_VALUE, NO_IR_VALUE, error);
+            SweepBackward(gradient, (size_t) output + 1, active, adjoints, error);
+        }
+    }
+
+    int zero = IrAddValue(gradient, NodeType::NUMBER, {.val = 0}, NO_IR_VALUE, NO_IR_VALUE, error);
+
+    for (size_t i = 0; i < vars_amt && error->code == (int) ExpressionErrors::NONE; i++)
+    {
+        int derivative = zero;
+
+        for (size_t j = 0; j < size; j++)
+        {
+            const IrInstruction* instr = &gradient->code[j];
+
+            if (instr->type == NodeType::VARIABLE && instr->value.var == ids[i] && adjoints[j] != NO_IR_VALUE)
+                derivative = adjoints[j];
+        }
+
+        IrAddOutput(gradient, derivative, error);
+    }
+
+    free(ids);
+    free(active);
+    free(adjoints);
+
+    if (error->code == (int) ExpressionErrors::NONE)
+        IrOptimize(gradient, error);
+
+    if (error->code != (int) ExpressionErrors::NONE)
+        IrDtor(gradient);
+
+    return (ExpressionErrors) error->code;
+}
+
+//------------------------------------------------------------------
+
+static int* FindVariablesIds(const expr_t* expr, const char* const* vars, const size_t vars_amt, error_t* error)
+{
+    assert(expr);
+    assert(vars);
+    assert(error);
+
+    int* ids = (int*) calloc(vars_amt + 1, sizeof(int));
+    if (ids == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "GRADIENT VARIABLES";
+        return nullptr;
+    }
+
+    for (size_t i = 0; i < vars_amt; i++)
+    {
+        ids[i] = FindVariableAmongSaved(expr->vars, vars[i]);
+        if (ids[i] == NO_VARIABLE)
+        {
+            free(ids);
+
+            error->code = (int) ExpressionErrors::NO_DIFF_VARIABLE;
+            error->data = vars[i];
+            return nullptr;
+        }
+    }
+
+    return ids;
+}
+
+//------------------------------------------------------------------
+
+static void MarkActive(const ir_t* ir, const int* ids, const size_t vars_amt, bool* active)
+{
+    assert(ir);
+    assert(ids);
+    assert(active);
+
+    for (size_t i = 0; i < ir->size; i++)
+    {
+        const IrInstruction* instr = &ir->code[i];
+
+        active[i] = false;
+
+        if (instr->type == NodeType::VARIABLE)
+        {
+            for (size_t j = 0; j < vars_amt; j++)
+                active[i] = active[i] || instr->value.var == ids[j];
+        }
+        else if (instr->type == NodeType::OPERATOR)
+        {
+            active[i] = (instr->left  != NO_IR_VALUE && active[instr->left]) ||
+                        (instr->right != NO_IR_VALUE && active[instr->right]);
+        }
+    }
+}
+
+//------------------------------------------------------------------
+
+// adjoint of instruction is complete once all later instructions are swept; operand gets first
+// contribution as is and the rest as sums, partials are taken only by active operands
+static void SweepBackward(ir_t* ir, const size_t size, const bool* active, int* adjoints, error_t* error)
+{
+    assert(ir);
+    assert(active);
+    assert(adjoints);
+    assert(error);
+
+    for (size_t i = size; i-- > 0; )
+    {
+        if (!active[i] || adjoints[i] == NO_IR_VALUE || ir->code[i].type != NodeType::OPERATOR)
+            continue;
+
+        // code may be reallocated by additions, so instruction is copied
+        IrInstruction instr = ir->code[i];
+
+        IrSymbol left    = {ir, instr.left,  error};
+        IrSymbol right   = {ir, instr.right, error};
+        IrSymbol result  = {ir, (int) i,     error};
+        IrSymbol adjoint = {ir, adjoints[i], error};
+
+        int operands[] = {instr.left, instr.right};
+        NodeKid kids[] = {NodeKid::LEFT, NodeKid::RIGHT};
+
+        for (size_t k = 0; k < 2; k++)
+        {
+            int operand = operands[k];
+            if (operand == NO_IR_VALUE || !active[operand])
+                continue;
+
+            IrSymbol term = adjoint * MakeSymbolicPartial(left, right, result, instr.value.opt, kids[k]);
+            if (error->code != (int) ExpressionErrors::NONE)
+                return;
+
+            if (adjoints[operand] == NO_IR_VALUE)
+                adjoints[operand] = term.value;
+            else
+                adjoints[operand] = (IrSymbol{ir, adjoints[operand], error} + term).value;
+        }
+    }
+}
+
+//------------------------------------------------------------------
+
+int IrDifferentiate(ir_t* ir, const int value, const int var_id, error_t* error)
+{
+    assert(ir);
+    assert(error);
+
+    int*   memo      = nullptr;
+    size_t memo_size = 0;
+
+    int derivative = DifferentiateValue(ir, value, var_id, &memo, &memo_size, error);
+
+    free(memo);
+
+    return derivative;
+}
+
+//------------------------------------------------------------------
+
+ExpressionErrors DerivativesExpression(ir_t* derivatives, const expr_t* expr, const char* var, const size_t order,
+                                       error_t* error)
+{
+    assert(derivatives);
+    assert(expr);
+    assert(var);
+    assert(error);
+
+    int var_id = FindVariableAmongSaved(expr->vars, var);
+    if (var_id == NO_VARIABLE)
+    {
+        error->code = (int) ExpressionErrors::NO_DIFF_VARIABLE;
+        error->data = var;
+        return ExpressionErrors::NO_DIFF_VARIABLE;
+    }
+
+    if (IrCtor(derivatives, error) != ExpressionErrors::NONE)
+        return (ExpressionErrors) error->code;
+
+    int*   memo      = nullptr;
+    size_t memo_size = 0;
+
+    int value = IrLowerNode(derivatives, expr->root, error);
+    if (error->code == (int) ExpressionErrors::NONE)
+        IrAddOutput(derivatives, value, error);
+
+    // memo is kept between orders: values met again in higher derivatives are not differentiated twice
+    for (size_t i = 1; i <= order && error->code == (int) ExpressionErrors::NONE; i++)
+    {
+        value = DifferentiateValue(derivatives, value, var_id, &memo, &memo_size, error);
+        if (error->code == (int) ExpressionErrors::NONE)
+            IrAddOutput(derivatives, value, error);
+    }
+
+    free(memo);
+
+    if (error->code == (int) ExpressionErrors::NONE)
+        IrOptimize(derivatives, error);
+
+    if (error->code != (int) ExpressionErrors::NONE)
+        IrDtor(derivatives);
+
+    return (ExpressionErrors) error->code;
+}
+
+//------------------------------------------------------------------
+
+// only values the given one depends on are differentiated, in program order, so operands are ready first
+static int DifferentiateValue(ir_t* ir, const int value, const int var_id, int** memo, size_t* memo_size,
+                              error_t* error)
+{
+    assert(ir);
+    assert(memo);
+    assert(memo_size);
+    assert(error);
+
+    if (value == NO_IR_VALUE)
+        return NO_IR_VALUE;
+
+    ReserveMemo(memo, memo_size, ir->size, error);
+    if (error->code != (int) ExpressionErrors::NONE)
+        return NO_IR_VALUE;
+
+    bool* needed = (bool*) calloc((size_t) value + 1, sizeof(bool));
+    if (needed == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "IR DERIVATIVE";
+        return NO_IR_VALUE;
+    }
+
+    int* derivatives = *memo;
+
+    needed[value] = true;
+
+    for (int i = value; i >= 0; i--)
+    {
+        const IrInstruction* instr = &ir->code[i];
+
+        if (!needed[i] || derivatives[i] != NO_IR_VALUE || instr->type != NodeType::OPERATOR)
+            continue;
+
+        if (instr->left  != NO_IR_VALUE) needed[instr->left]  = true;
+        if (instr->right != NO_IR_VALUE) needed[instr->right] = true;
+    }
+
+    int zero = IrAddValue(ir, NodeType::NUMBER, {.val = 0}, NO_IR_VALUE, NO_IR_VALUE, error);
+    int one  = IrAddValue(ir, NodeType::NUMBER, {.val = 1}, NO_IR_VALUE, NO_IR_VALUE, error);
+
+    for (int i = 0; i <= value && error->code == (int) ExpressionErrors::NONE; i++)
+    {
+        if (needed[i] && derivatives[i] == NO_IR_VALUE)
+            derivatives[i] = DifferentiateInstruction(ir, i, var_id, derivatives, zero, one, error);
+    }
+
+    free(needed);
+
+    if (error->code != (int) ExpressionErrors::NONE)
+        return NO_IR_VALUE;
+
+    return derivatives[value];
+}
+
+//------------------------------------------------------------------
+
+static void ReserveMemo(int** memo, size_t* memo_size, const size_t size, error_t* error)
+{
+    assert(memo);
+    assert(memo_size);
+    assert(error);
+
+    if (size <= *memo_size)
+        return;
+
+    int* new_memo = (int*) realloc(*memo, size * sizeof(int));
+    if (new_memo == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "IR DERIVATIVE MEMO";
+        return;
+    }
+
+    for (size_t i = *memo_size; i < size; i++)
+        new_memo[i] = NO_IR_VALUE;
+
+    *memo      = new_memo;
+    *memo_size = size;
+}
+
+//------------------------------------------------------------------
+
+// operand with zero derivative gives no term, so constant exponent does not need log of base
+static int DifferentiateInstruction(ir_t* ir, const int value, const int var_id, const int* memo,
+                                    const int zero, const int one, error_t* error)
+{
+    assert(ir);
+    assert(memo);
+    assert(error);
+
+    // code may be reallocated by additions, so instruction is copied
+    IrInstruction instr = ir->code[value];
+
+    if (instr.type == NodeType::VARIABLE)
+        return (instr.value.var == var_id) ? one : zero;
+
+    if (instr.type != NodeType::OPERATOR)
+        return zero;
+
+    IrSymbol left       = {ir, instr.left,  error};
+    IrSymbol right      = {ir, instr.right, error};
+    IrSymbol result     = {ir, value,       error};
+    IrSymbol derivative = {ir, zero,        error};
+
+    int operands[] = {instr.left, instr.right};
+    NodeKid kids[] = {NodeKid::LEFT, NodeKid::RIGHT};
+
+    for (size_t k = 0; k < 2; k++)
+    {
+        int operand = operands[k];
+        if (operand == NO_IR_VALUE || memo[operand] == zero)
+            continue;
+
+        IrSymbol term = IrSymbol{ir, memo[operand], error} *
+                        MakeSymbolicPartial(left, right, result, instr.value.opt, kids[k]);
+        if (error->code != (int) ExpressionErrors::NONE)
+            return NO_IR_VALUE;
+
+        derivative = derivative + term;
+    }
+
+    return derivative.value;
+}
@@ -0,0 +1,36 @@
+#ifndef __GRADIENT_H_
+#define __GRADIENT_H_
+
+#include "expression/expression.h"
+#include "ir.h"
+
+// ======================================================================
+// SYMBOLIC GRADIENT
+// ======================================================================
+
+// reverse mode over symbols instead of numbers: expression is lowered to IR, then backward sweep
+// appends adjoint of every instruction as new instructions built from DEF_OP partials.
+// Value numbering shares everything that repeats - the original, its subexpressions and common
+// adjoints, so gradient by n variables is a few times bigger than expression, not n derivative trees
+
+// gradient gets optimized program with one output per variable (derivative by vars[i] is outputs[i]),
+// variable that expression does not depend on gets 0; free gradient with IrDtor
+ExpressionErrors GradientExpression(ir_t* gradient, const expr_t* expr, const char* const* vars,
+                                    const size_t vars_amt, error_t* error);
+
+// ======================================================================
+// DAG DERIVATIVES
+// ======================================================================
+
+// forward mode over symbols: derivative of every value is made once per call and shared by all
+// values that use it, so repeated differentiation grows program polynomially, while trees of
+// DifferentiateExpression copy every subtree and grow exponentially with order
+
+// derivative of value by variable is appended to ir, its value is returned
+int              IrDifferentiate(ir_t* ir, const int value, const int var_id, error_t* error);
+
+// derivatives gets optimized program with outputs f, f', ..., f^(order) by var
+ExpressionErrors DerivativesExpression(ir_t* derivatives, const expr_t* expr, const char* var,
+                                       const size_t order, error_t* error);
+
+#endif
@@ -0,0 +1,216 @@
+#include <stdlib.h>
+
+#include "grid.h"
+#include "ir.h"
+#include "calculation.h"
+
+// instructions of level k depend on first k axes only, so they are calculated inside k loops
+
+struct GridProgram
+{
+    const ir_t*         ir;
+    const variable_t*   vars;
+
+    const grid_axis_t*  axes;
+    size_t              axes_amt;
+
+    int*                order;              // instructions sorted by level, program order inside level
+    size_t*             level_start;        // level k is order[level_start[k]..level_start[k + 1]]
+
+    double*             values;
+    double*             coords;             // current coordinate on every axis
+
+    double*             result;
+};
+
+static void     SortByLevel(GridProgram* prog, error_t* error);
+static void     FillGridLevel(GridProgram* prog, const size_t level, const size_t offset, error_t* error);
+static void     CalculateInstruction(GridProgram* prog, const int id, const size_t level, error_t* error);
+
+//------------------------------------------------------------------
+
+static void SortByLevel(GridProgram* prog, error_t* error)
+{
+    assert(prog);
+    assert(error);
+
+    const ir_t* ir    = prog->ir;
+    size_t* levels    = (size_t*) calloc(ir->size + 1, sizeof(size_t));
+    if (levels == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "GRID LEVELS";
+        return;
+    }
+
+    // operands go before instruction, so one pass is enough
+    for (size_t i = 0; i < ir->size; i++)
+    {
+        const IrInstruction* instr = &ir->code[i];
+
+        if (instr->type == NodeType::VARIABLE)
+        {
+            for (size_t axis = 0; axis < prog->axes_amt; axis++)
+                if (prog->axes[axis].var_id == instr->value.var)
+                    levels[i] = axis + 1;
+        }
+        else if (instr->type == NodeType::OPERATOR)
+        {
+            size_t left  = (instr->left  != NO_IR_VALUE) ? levels[instr->left]  : 0;
+            size_t right = (instr->right != NO_IR_VALUE) ? levels[instr->right] : 0;
+
+            levels[i] = (left > right) ? left : right;
+        }
+    }
+
+    for (size_t i = 0; i < ir->size; i++)
+        prog->level_start[levels[i] + 1]++;
+
+    for (size_t level = 0; level <= prog->axes_amt; level++)
+        prog->level_start[level + 1] += prog->level_start[level];
+
+    // placing shifts every start to the next one, so they are moved back after it
+    for (size_t i = 0; i < ir->size; i++)
+        prog->order[prog->level_start[levels[i]]++] = (int) i;
+
+    for (size_t level = prog->axes_amt + 1; level > 0; level--)
+        prog->level_start[level] = prog->level_start[level - 1];
+    prog->level_start[0] = 0;
+
+    free(levels);
+}
+
+//------------------------------------------------------------------
+
+static void CalculateInstruction(GridProgram* prog, const int id, const size_t level, error_t* error)
+{
+    assert(prog);
+    assert(error);
+
+    const IrInstruction* instr = &prog->ir->code[id];
+
+    switch (instr->type)
+    {
+        case (NodeType::NUMBER):
+            prog->values[id] = instr->value.val;
+            break;
+
+        case (NodeType::VARIABLE):
+            // variable of level k > 0 is variable of axis k - 1
+            prog->values[id] = (level > 0) ? prog->coords[level - 1] : prog->vars[instr->value.var].value;
+            break;
+
+        case (NodeType::OPERATOR):
+        {
+            double left  = (instr->left  != NO_IR_VALUE) ? prog->values[instr->left]  : 0;
+            double right = (instr->right != NO_IR_VALUE) ? prog->values[instr->right] : 0;
+
+            prog->values[id] = CalculateOperation(left, right, instr->value.opt, error);
+            break;
+        }
+
+        case (NodeType::POISON):
+        default:
+            error->code = (int) ExpressionErrors::INVALID_EXPRESSION_FORMAT;
+            break;
+    }
+}
+
+//------------------------------------------------------------------
+
+static void FillGridLevel(GridProgram* prog, const size_t level, const size_t offset, error_t* error)
+{
+    assert(prog);
+    assert(error);
+
+    for (size_t i = prog->level_start[level]; i < prog->level_start[level + 1]; i++)
+    {
+        CalculateInstruction(prog, prog->order[i], level, error);
+        if (error->code != (int) ExpressionErrors::NONE)
+            return;
+    }
+
+    if (level == prog->axes_amt)
+    {
+        int output = prog->ir->outputs[0];
+
+        prog->result[offset] = (output != NO_IR_VALUE) ? prog->values[output] : 0;
+        return;
+    }
+
+    const grid_axis_t* axis = &prog->axes[level];
+
+    for (size_t i = 0; i < axis->size; i++)
+    {
+        prog->coords[level] = axis->coords[i];
+
+        FillGridLevel(prog, level + 1, offset * axis->size + i, error);
+        if (error->code != (int) ExpressionErrors::NONE)
+            return;
+    }
+}
+
+//------------------------------------------------------------------
+
+ExpressionErrors CalculateExpressionGrid(const expr_t* expr, const grid_axis_t* axes, const size_t axes_amt,
+                                         double* result, error_t* error)
+{
+    assert(expr);
+    assert(axes);
+    assert(result);
+    assert(error);
+
+    for (size_t axis = 0; axis < axes_amt; axis++)
+    {
+        if (axes[axis].var_id < 0 || (size_t) axes[axis].var_id >= expr->max_vars_amt)
+        {
+            error->code = (int) ExpressionErrors::NO_DIFF_VARIABLE;
+            return ExpressionErrors::NO_DIFF_VARIABLE;
+        }
+    }
+
+    ir_t ir = {};
+    IrCtor(&ir, error);
+    RETURN_IF_EXPRESSION_ERROR((ExpressionErrors) error->code);
+
+    IrLowerExpression(&ir, expr, error);
+    if (error->code == (int) ExpressionErrors::NONE)
+        IrOptimize(&ir, error);
+
+    if (error->code != (int) ExpressionErrors::NONE)
+    {
+        IrDtor(&ir);
+        return (ExpressionErrors) error->code;
+    }
+
+    GridProgram prog = {};
+
+    prog.ir          = &ir;
+    prog.vars        = expr->vars;
+    prog.axes        = axes;
+    prog.axes_amt    = axes_amt;
+    prog.result      = result;
+    prog.order       = (int*)    calloc(ir.size + 1,   sizeof(int));
+    prog.values      = (double*) calloc(ir.size + 1,   sizeof(double));
+    prog.level_start = (size_t*) calloc(axes_amt + 2,  sizeof(size_t));
+    prog.coords      = (double*) calloc(axes_amt + 1,  sizeof(double));
+
+    if (prog.order == nullptr || prog.values == nullptr || prog.level_start == nullptr || prog.coords == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "GRID PROGRAM";
+    }
+    else
+        SortByLevel(&prog, error);
+
+    if (error->code == (int) ExpressionErrors::NONE)
+        FillGridLevel(&prog, 0, 0, error);
+
+    free(prog.order);
+    free(prog.values);
+    free(prog.level_start);
+    free(prog.coords);
+    IrDtor(&ir);
+
+    return (ExpressionErrors) error->code;
+}
@@ -0,0 +1,24 @@
+#ifndef __GRID_H_
+#define __GRID_H_
+
+#include "expression/expression.h"
+
+// ======================================================================
+// GRID EVALUATION
+// ======================================================================
+
+struct GridAxis
+{
+    int             var_id;
+    const double*   coords;
+    size_t          size;
+};
+typedef struct GridAxis grid_axis_t;
+
+// fills result[i_0][i_1]...[i_n] (row-major, first axis is outermost) with expression value at
+// var(axis k) = axes[k].coords[i_k], other variables are taken from expr->vars;
+// every subexpression is calculated in the outermost loop where all its variables are fixed
+ExpressionErrors CalculateExpressionGrid(const expr_t* expr, const grid_axis_t* axes, const size_t axes_amt,
+                                         double* result, error_t* error);
+
+#endif
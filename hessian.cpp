@@ -0,0 +1,623 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hessian.h"
+#include "calculation.h"
+
+static dual_t           MakeDual(const double val);
+static dual_t           MakeDual(const dual_t dual);
+
+static dual_t           operator+(const dual_t left, const dual_t right);
+static dual_t           operator-(const dual_t left, const dual_t right);
+static dual_t           operator*(const dual_t left, const dual_t right);
+static dual_t           operator/(const dual_t left, const dual_t right);
+static dual_t           operator+(const double left, const dual_t right);
+static dual_t           operator-(const double left, const dual_t right);
+static dual_t           operator/(const double left, const dual_t right);
+static dual_t           operator-(const dual_t left, const double right);
+static dual_t           operator-(const dual_t dual);
+
+static dual_t           pow(const dual_t base, const dual_t power);
+static dual_t           log(const dual_t dual);
+static dual_t           sin(const dual_t dual);
+static dual_t           cos(const dual_t dual);
+static dual_t           sqrt(const dual_t dual);
+
+static dual_t           CalculateDualPartial(const dual_t left, const dual_t right, const dual_t result,
+                                             const Operators operation, const NodeKid kid);
+
+static ExpressionErrors PatternCtor(hessian_t* hessian, const HessianKind kind, error_t* error);
+static void             FindPattern(hessian_t* hessian, const HessianKind kind, error_t* error);
+static void             ColorPattern(hessian_t* hessian);
+static bool             IsColoringValid(const hessian_t* hessian);
+static inline bool      IsOnlyInGroup(const hessian_t* hessian, const size_t row, const size_t col);
+
+static void             SweepForward(hessian_t* hessian, const double* direction, error_t* error);
+static void             SweepBackward(hessian_t* hessian, double* product, double* gradient);
+
+//------------------------------------------------------------------
+
+static dual_t MakeDual(const double val)
+{
+    return {val, 0};
+}
+
+static dual_t MakeDual(const dual_t dual)
+{
+    return dual;
+}
+
+//------------------------------------------------------------------
+
+static dual_t operator+(const dual_t left, const dual_t right)
+{
+    return {left.val + right.val, left.der + right.der};
+}
+
+static dual_t operator-(const dual_t left, const dual_t right)
+{
+    return {left.val - right.val, left.der - right.der};
+}
+
+static dual_t operator*(const dual_t left, const dual_t right)
+{
+    return {left.val * right.val, left.der * right.val + left.val * right.der};
+}
+
+static dual_t operator/(const dual_t left, const dual_t right)
+{
+    double val = left.val / right.val;
+
+    return {val, (left.der - val * right.der) / right.val};
+}
+
+static dual_t operator+(const double left, const dual_t right)
+{
+    return MakeDual(left) + right;
+}
+
+static dual_t operator-(const double left, const dual_t right)
+{
+    return MakeDual(left) - right;
+}
+
+static dual_t operator/(const double left, const dual_t right)
+{
+    return MakeDual(left) / right;
+}
+
+static dual_t operator-(const dual_t left, const double right)
+{
+    return left - MakeDual(right);
+}
+
+static dual_t operator-(const dual_t dual)
+{
+    return {-dual.val, -dual.der};
+}
+
+//------------------------------------------------------------------
+
+// term of operand with zero derivative is skipped, so constant exponent does not need log of base
+static dual_t pow(const dual_t base, const dual_t power)
+{
+    double val = pow(base.val, power.val);
+    double der = 0;
+
+    if (fpclassify(base.der) != FP_ZERO)
+        der += base.der * power.val * pow(base.val, power.val - 1);
+    if (fpclassify(power.der) != FP_ZERO)
+        der += power.der * val * log(base.val);
+
+    return {val, der};
+}
+
+static dual_t log(const dual_t dual)
+{
+    return {log(dual.val), dual.der / dual.val};
+}
+
+static dual_t sin(const dual_t dual)
+{
+    return {sin(dual.val), dual.der * cos(dual.val)};
+}
+
+static dual_t cos(const dual_t dual)
+{
+    return {cos(dual.val), -dual.der * sin(dual.val)};
+}
+
+static dual_t sqrt(const dual_t dual)
+{
+    double val = sqrt(dual.val);
+
+    return {val, dual.der / (2 * val)};
+}
+
+//------------------------------------------------------------------
+
+#define DEF_OP(name, symb, priority, arg_amt, action, gnu_symb, type, tex_symb,                       \
+               need_left_brackets, left_is_figure, need_right_brackets, right_is_figure, diff,        \
+               partial_1, partial_2, ...)                                                             \
+            case (Operators::name):                                                                 \
+                if (kid == NodeKid::LEFT)                                                           \
+                    return MakeDual(partial_1);                                                     \
+                return MakeDual(partial_2);                                                         \
+
+static dual_t CalculateDualPartial(const dual_t NUMBER_1, const dual_t NUMBER_2, const dual_t RESULT,
+                                   const Operators operation, const NodeKid kid)
+{
+    switch (operation)
+    {
+        #include "operations.h"
+        default:
+            return {POISON, POISON};
+    }
+}
+
+#undef DEF_OP
+
+//------------------------------------------------------------------
+
+ExpressionErrors HessianCtor(hessian_t* hessian, const expr_t* expr, const HessianKind kind, error_t* error)
+{
+    assert(hessian);
+    assert(expr);
+    assert(error);
+
+    *hessian = {};
+
+    if (TapeCtor(&hessian->tape, expr, error) != ExpressionErrors::NONE)
+        return (ExpressionErrors) error->code;
+
+    size_t size     = hessian->tape.kernel.ir.size;
+    size_t vars_amt = hessian->tape.vars_amt;
+
+    hessian->tangents         = (double*) calloc(size + 1, sizeof(double));
+    hessian->tangent_adjoints = (double*) calloc(size + 1, sizeof(double));
+    hessian->direction        = (double*) calloc(vars_amt + 1, sizeof(double));
+
+    if (hessian->tangents == nullptr || hessian->tangent_adjoints == nullptr || hessian->direction == nullptr)
+    {
+        HessianDtor(hessian);
+
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "HESSIAN";
+        return ExpressionErrors::ALLOCATE_MEMORY;
+    }
+
+    if (PatternCtor(hessian, kind, error) != ExpressionErrors::NONE)
+    {
+        HessianDtor(hessian);
+        return (ExpressionErrors) error->code;
+    }
+
+    return ExpressionErrors::NONE;
+}
+
+//------------------------------------------------------------------
+
+// every used variable gets a mask bit in order of the tape; expression with more of them
+// is left without pattern and only gives Hessian-vector products
+static ExpressionErrors PatternCtor(hessian_t* hessian, const HessianKind kind, error_t* error)
+{
+    assert(hessian);
+    assert(error);
+
+    const ir_t* ir       = &hessian->tape.kernel.ir;
+    size_t      vars_amt = hessian->tape.vars_amt;
+    size_t      used_amt = 0;
+
+    for (size_t i = 0; i < ir->size; i++)
+        if (ir->code[i].type == NodeType::VARIABLE)
+            used_amt++;
+
+    if (used_amt > HESSIAN_MAX_VARIABLES_AMT)
+        return ExpressionErrors::NONE;
+
+    hessian->pattern_vars = (int*)            calloc(used_amt + 1, sizeof(int));
+    hessian->pattern      = (hessian_mask_t*) calloc(used_amt + 1, sizeof(hessian_mask_t));
+    hessian->colors       = (int*)            calloc(used_amt + 1, sizeof(int));
+    hessian->groups       = (hessian_mask_t*) calloc(used_amt + 1, sizeof(hessian_mask_t));
+    hessian->products     = (double*)         calloc(used_amt * vars_amt + 1, sizeof(double));
+
+    if (hessian->pattern_vars == nullptr || hessian->pattern == nullptr || hessian->colors == nullptr ||
+        hessian->groups == nullptr || hessian->products == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "HESSIAN PATTERN";
+        return ExpressionErrors::ALLOCATE_MEMORY;
+    }
+
+    for (size_t i = 0; i < ir->size; i++)
+        if (ir->code[i].type == NodeType::VARIABLE)
+            hessian->pattern_vars[hessian->pattern_amt++] = ir->code[i].value.var;
+
+    FindPattern(hessian, kind, error);
+    if (error->code != (int) ExpressionErrors::NONE)
+        return (ExpressionErrors) error->code;
+
+    ColorPattern(hessian);
+
+    return ExpressionErrors::NONE;
+}
+
+//------------------------------------------------------------------
+
+void HessianDtor(hessian_t* hessian)
+{
+    assert(hessian);
+
+    TapeDtor(&hessian->tape);
+    free(hessian->tangents);
+    free(hessian->tangent_adjoints);
+    free(hessian->pattern_vars);
+    free(hessian->pattern);
+    free(hessian->colors);
+    free(hessian->groups);
+    free(hessian->direction);
+    free(hessian->products);
+
+    *hessian = {};
+}
+
+//------------------------------------------------------------------
+
+// every instruction gets variables it depends on; second derivative by a pair of variables is
+// nonzero only where both reach the same nonlinear operation
+static void FindPattern(hessian_t* hessian, const HessianKind kind, error_t* error)
+{
+    assert(hessian);
+    assert(error);
+
+    const ir_t* ir = &hessian->tape.kernel.ir;
+
+    hessian_mask_t* deps = (hessian_mask_t*) calloc(ir->size + 1, sizeof(hessian_mask_t));
+    if (deps == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "HESSIAN PATTERN";
+        return;
+    }
+
+    hessian_mask_t* pattern     = hessian->pattern;
+    size_t          pattern_amt = hessian->pattern_amt;
+    size_t          used_bits   = 0;
+
+    for (size_t i = 0; i < ir->size; i++)
+    {
+        const IrInstruction* instr = &ir->code[i];
+
+        if (instr->type == NodeType::VARIABLE)
+        {
+            deps[i] = (hessian_mask_t) 1 << used_bits++;
+            continue;
+        }
+
+        if (instr->type != NodeType::OPERATOR)
+            continue;
+
+        hessian_mask_t left  = (instr->left  != NO_IR_VALUE) ? deps[instr->left]  : 0;
+        hessian_mask_t right = (instr->right != NO_IR_VALUE) ? deps[instr->right] : 0;
+        hessian_mask_t rows  = 0;
+        hessian_mask_t cols  = 0;
+
+        deps[i] = left | right;
+
+        switch (instr->value.opt)
+        {
+            case (Operators::ADD):
+            case (Operators::SUB):
+                break;
+
+            case (Operators::MUL):
+                rows = left;
+                cols = right;
+                break;
+
+            case (Operators::DIV):
+                rows = left | right;
+                cols = right;
+                break;
+
+            case (Operators::DEG):
+                rows = (right == 0) ? left : left | right;
+                cols = rows;
+                break;
+
+            default:
+                rows = right;
+                cols = right;
+                break;
+        }
+
+        for (size_t var = 0; var < pattern_amt; var++)
+        {
+            hessian_mask_t bit = (hessian_mask_t) 1 << var;
+
+            if (rows & bit) pattern[var] |= cols;
+            if (cols & bit) pattern[var] |= rows;
+        }
+    }
+
+    if (kind == HessianKind::DENSE && ir->outputs[0] != NO_IR_VALUE)
+    {
+        hessian_mask_t all = deps[ir->outputs[0]];
+
+        for (size_t var = 0; var < pattern_amt; var++)
+            pattern[var] = (all & ((hessian_mask_t) 1 << var)) ? all : 0;
+    }
+
+    free(deps);
+}
+
+//------------------------------------------------------------------
+
+// greedy: every variable gets the first group that keeps every element recoverable, variables with
+// more nonzeros go first; groups are never worse than plain column groups and usually need fewer products
+static void ColorPattern(hessian_t* hessian)
+{
+    assert(hessian);
+
+    size_t vars_amt = hessian->pattern_amt;
+
+    hessian->colors_amt = 0;
+
+    for (size_t var = 0; var < vars_amt; var++)
+        hessian->colors[var] = -1;
+
+    for (int degree = (int) vars_amt; degree > 0; degree--)
+    {
+        for (size_t var = 0; var < vars_amt; var++)
+        {
+            if (__builtin_popcountll(hessian->pattern[var]) != degree)
+                continue;
+
+            hessian_mask_t bit = (hessian_mask_t) 1 << var;
+
+            for (size_t color = 0; color <= hessian->colors_amt; color++)
+            {
+                hessian->colors[var]     = (int) color;
+                hessian->groups[color]  |= bit;
+
+                if (color == hessian->colors_amt || IsColoringValid(hessian))
+                    break;
+
+                hessian->groups[color]  &= ~bit;
+            }
+
+            if ((size_t) hessian->colors[var] == hessian->colors_amt)
+                hessian->colors_amt++;
+        }
+    }
+}
+
+//------------------------------------------------------------------
+
+static bool IsColoringValid(const hessian_t* hessian)
+{
+    assert(hessian);
+
+    for (size_t row = 0; row < hessian->pattern_amt; row++)
+    {
+        if (hessian->colors[row] < 0)
+            continue;
+
+        for (size_t col = 0; col <= row; col++)
+        {
+            if (hessian->colors[col] < 0 || !(hessian->pattern[row] & ((hessian_mask_t) 1 << col)))
+                continue;
+
+            if (!IsOnlyInGroup(hessian, row, col) && !IsOnlyInGroup(hessian, col, row))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------
+
+// element (row, col) is the product of col's group in this row
+static inline bool IsOnlyInGroup(const hessian_t* hessian, const size_t row, const size_t col)
+{
+    hessian_mask_t others = hessian->pattern[row] & hessian->groups[hessian->colors[col]];
+
+    return others == ((hessian_mask_t) 1 << col);
+}
+
+//------------------------------------------------------------------
+
+double CalculateHessianVectorProduct(hessian_t* hessian, const variable_t* vars, const double* direction,
+                                     double* product, double* gradient, error_t* error)
+{
+    assert(hessian);
+    assert(vars);
+    assert(direction);
+    assert(product);
+    assert(error);
+
+    double result = 0;
+
+    IrKernelCalculate(&hessian->tape.kernel, vars, &result, error);
+    if (error->code != (int) ExpressionErrors::NONE)
+        return POISON;
+
+    SweepForward(hessian, direction, error);
+    if (error->code != (int) ExpressionErrors::NONE)
+        return POISON;
+
+    SweepBackward(hessian, product, gradient);
+
+    return result;
+}
+
+//------------------------------------------------------------------
+
+double CalculateHessian(hessian_t* hessian, const variable_t* vars, double* matrix, error_t* error)
+{
+    assert(hessian);
+    assert(vars);
+    assert(matrix);
+    assert(error);
+
+    if (hessian->pattern == nullptr)
+    {
+        error->code = (int) ExpressionErrors::TOO_MANY_VARIABLES;
+        error->data = "HESSIAN";
+        return POISON;
+    }
+
+    const int* pattern_vars = hessian->pattern_vars;
+    size_t     pattern_amt  = hessian->pattern_amt;
+    size_t     vars_amt     = hessian->tape.vars_amt;
+    double     result       = 0;
+
+    for (size_t color = 0; color < hessian->colors_amt; color++)
+    {
+        memset(hessian->direction, 0, vars_amt * sizeof(double));
+
+        for (size_t bit = 0; bit < pattern_amt; bit++)
+            if (hessian->colors[bit] == (int) color)
+                hessian->direction[pattern_vars[bit]] = 1;
+
+        result = CalculateHessianVectorProduct(hessian, vars, hessian->direction,
+                                               hessian->products + color * vars_amt, nullptr, error);
+        if (error->code != (int) ExpressionErrors::NONE)
+            return POISON;
+    }
+
+    memset(matrix, 0, vars_amt * vars_amt * sizeof(double));
+
+    for (size_t row = 0; row < pattern_amt; row++)
+    {
+        for (size_t col = 0; col <= row; col++)
+        {
+            if (!(hessian->pattern[row] & ((hessian_mask_t) 1 << col)))
+                continue;
+
+            size_t row_var = (size_t) pattern_vars[row];
+            size_t col_var = (size_t) pattern_vars[col];
+
+            double val = IsOnlyInGroup(hessian, row, col) ?
+                         hessian->products[(size_t) hessian->colors[col] * vars_amt + row_var] :
+                         hessian->products[(size_t) hessian->colors[row] * vars_amt + col_var];
+
+            matrix[row_var * vars_amt + col_var] = val;
+            matrix[col_var * vars_amt + row_var] = val;
+        }
+    }
+
+    if (hessian->colors_amt == 0)
+        IrKernelCalculate(&hessian->tape.kernel, vars, &result, error);
+
+    return result;
+}
+
+//------------------------------------------------------------------
+
+static void SweepForward(hessian_t* hessian, const double* direction, error_t* error)
+{
+    assert(hessian);
+    assert(direction);
+    assert(error);
+
+    const ir_t*   ir       = &hessian->tape.kernel.ir;
+    const double* values   = hessian->tape.kernel.values;
+    const bool*   active   = hessian->tape.active;
+    double*       tangents = hessian->tangents;
+
+    for (size_t i = 0; i < ir->size; i++)
+    {
+        const IrInstruction* instr = &ir->code[i];
+
+        tangents[i] = 0;
+
+        if (instr->type == NodeType::VARIABLE)
+        {
+            tangents[i] = direction[instr->value.var];
+            continue;
+        }
+
+        if (!active[i] || instr->type != NodeType::OPERATOR)
+            continue;
+
+        double left  = (instr->left  != NO_IR_VALUE) ? values[instr->left]  : 0;
+        double right = (instr->right != NO_IR_VALUE) ? values[instr->right] : 0;
+
+        if (instr->left != NO_IR_VALUE && fpclassify(tangents[instr->left]) != FP_ZERO)
+            tangents[i] += tangents[instr->left]  * CalculatePartial(left, right, values[i], instr->value.opt,
+                                                                     NodeKid::LEFT, error);
+        if (instr->right != NO_IR_VALUE && fpclassify(tangents[instr->right]) != FP_ZERO)
+            tangents[i] += tangents[instr->right] * CalculatePartial(left, right, values[i], instr->value.opt,
+                                                                     NodeKid::RIGHT, error);
+    }
+}
+
+//------------------------------------------------------------------
+
+// adjoints are the same as in first order sweep, their tangents get derivative of every partial
+// in the direction; partials are taken only by active operands
+static void SweepBackward(hessian_t* hessian, double* product, double* gradient)
+{
+    assert(hessian);
+    assert(product);
+
+    const ir_t*   ir               = &hessian->tape.kernel.ir;
+    const double* values           = hessian->tape.kernel.values;
+    const double* tangents         = hessian->tangents;
+    const bool*   active           = hessian->tape.active;
+    double*       adjoints         = hessian->tape.adjoints;
+    double*       tangent_adjoints = hessian->tangent_adjoints;
+    size_t        vars_amt         = hessian->tape.vars_amt;
+
+    memset(adjoints,         0, ir->size * sizeof(double));
+    memset(tangent_adjoints, 0, ir->size * sizeof(double));
+    memset(product,          0, vars_amt * sizeof(double));
+    if (gradient)
+        memset(gradient,     0, vars_amt * sizeof(double));
+
+    int output = ir->outputs[0];
+    if (output == NO_IR_VALUE)
+        return;
+
+    adjoints[output] = 1;
+
+    for (size_t i = (size_t) output + 1; i-- > 0; )
+    {
+        const IrInstruction* instr = &ir->code[i];
+
+        if (!active[i] || (fpclassify(adjoints[i]) == FP_ZERO && fpclassify(tangent_adjoints[i]) == FP_ZERO))
+            continue;
+
+        if (instr->type == NodeType::VARIABLE)
+        {
+            product[instr->value.var] += tangent_adjoints[i];
+            if (gradient)
+                gradient[instr->value.var] += adjoints[i];
+            continue;
+        }
+
+        dual_t left   = (instr->left  != NO_IR_VALUE) ? dual_t{values[instr->left],  tangents[instr->left]}  :
+                                                        dual_t{0, 0};
+        dual_t right  = (instr->right != NO_IR_VALUE) ? dual_t{values[instr->right], tangents[instr->right]} :
+                                                        dual_t{0, 0};
+        dual_t result = {values[i], tangents[i]};
+
+        int     operands[] = {instr->left,   instr->right};
+        NodeKid kids[]     = {NodeKid::LEFT, NodeKid::RIGHT};
+
+        for (size_t k = 0; k < 2; k++)
+        {
+            int operand = operands[k];
+            if (operand == NO_IR_VALUE || !active[operand])
+                continue;
+
+            dual_t partial = CalculateDualPartial(left, right, result, instr->value.opt, kids[k]);
+
+            adjoints[operand]         += adjoints[i] * partial.val;
+            tangent_adjoints[operand] += tangent_adjoints[i] * partial.val + adjoints[i] * partial.der;
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef __HESSIAN_H_
+#define __HESSIAN_H_
+
+#include <stdint.h>
+
+#include "expression/expression.h"
+#include "tape.h"
+
+// ======================================================================
+// SECOND ORDER
+// ======================================================================
+
+// forward over reverse: forward pass carries values and tangents in one direction, backward pass
+// carries adjoints and their tangents, with DEF_OP partials taken in dual numbers.
+// One sweep gives Hessian-vector product for a few evaluations; whole Hessian is made of such
+// products for groups of columns. Groups are chosen by symmetric coloring of Hessian pattern:
+// element is taken from column of its group or, by symmetry, from row - the only one of its group
+// in row or column that is nonzero
+
+enum class HessianKind
+{
+    DENSE,          // every pair of variables expression depends on
+    SPARSE,         // pairs that meet in some nonlinear operation
+};
+
+typedef uint64_t hessian_mask_t;    // bit of every used variable
+
+// whole Hessian of expression using more variables is TOO_MANY_VARIABLES,
+// Hessian-vector products have no limit
+static const size_t HESSIAN_MAX_VARIABLES_AMT = 8 * sizeof(hessian_mask_t);
+
+struct Hessian
+{
+    tape_t          tape;
+
+    double*         tangents;
+    double*         tangent_adjoints;
+
+    int*            pattern_vars;   // variable of every mask bit, nullptr if they do not fit masks
+    size_t          pattern_amt;    // variables expression uses
+    hessian_mask_t* pattern;        // nonzero columns of every row, pattern_amt of them
+    int*            colors;         // group of every bit, -1 for zero row
+    hessian_mask_t* groups;         // bits of every group
+    size_t          colors_amt;     // products for one Hessian
+
+    double*         direction;
+    double*         products;       // colors_amt * vars_amt
+};
+typedef struct Hessian hessian_t;
+
+ExpressionErrors    HessianCtor(hessian_t* hessian, const expr_t* expr, const HessianKind kind, error_t* error);
+void                HessianDtor(hessian_t* hessian);
+
+// returns value of expression, product gets H * direction; gradient (if not nullptr) is found
+// on the way. Vectors have tape.vars_amt elements indexed like vars
+double              CalculateHessianVectorProduct(hessian_t* hessian, const variable_t* vars,
+                                                  const double* direction, double* product, double* gradient,
+                                                  error_t* error);
+
+// matrix gets vars_amt * vars_amt elements by rows, it is exactly symmetric;
+// TOO_MANY_VARIABLES if expression uses more than HESSIAN_MAX_VARIABLES_AMT of them
+double              CalculateHessian(hessian_t* hessian, const variable_t* vars, double* matrix, error_t* error);
+
+#endif
@@ -0,0 +1,245 @@
+#include <stdlib.h>
+
+#include "incremental.h"
+#include "calculation.h"
+
+static size_t   CountNodes(const Node* node);
+static int      FillCachedNodes(eval_ctx_t* ctx, const Node* node, size_t* pos);
+
+static void     MarkDirty(eval_ctx_t* ctx, int node_id);
+static void     RecalculateNode(eval_ctx_t* ctx, CachedNode* cached, error_t* error);
+
+static int      CompareNodeIds(const void* a, const void* b);
+
+//------------------------------------------------------------------
+
+static size_t CountNodes(const Node* node)
+{
+    if (!node) return 0;
+
+    return CountNodes(node->left) + CountNodes(node->right) + 1;
+}
+
+//------------------------------------------------------------------
+
+static int FillCachedNodes(eval_ctx_t* ctx, const Node* node, size_t* pos)
+{
+    assert(ctx);
+    assert(pos);
+
+    if (!node) return NO_CACHED_NODE;
+
+    // parent gets its id only after kids, so they are linked to it here
+    int left  = FillCachedNodes(ctx, node->left,  pos);
+    int right = FillCachedNodes(ctx, node->right, pos);
+
+    int id = (int) (*pos)++;
+
+    CachedNode* cached = &ctx->nodes[id];
+
+    cached->node   = node;
+    cached->parent = NO_CACHED_NODE;
+    cached->left   = left;
+    cached->right  = right;
+    cached->value  = 0;
+    cached->dirty  = true;
+
+    if (left  != NO_CACHED_NODE) ctx->nodes[left].parent  = id;
+    if (right != NO_CACHED_NODE) ctx->nodes[right].parent = id;
+
+    ctx->dirty[ctx->dirty_amt++] = id;
+
+    return id;
+}
+
+//------------------------------------------------------------------
+
+ExpressionErrors EvalContextCtor(eval_ctx_t* ctx, const expr_t* expr, error_t* error)
+{
+    assert(ctx);
+    assert(expr);
+    assert(error);
+
+    size_t nodes_amt = CountNodes(expr->root);
+
+    ctx->expr           = expr;
+    ctx->nodes_amt      = nodes_amt;
+    ctx->nodes          = (CachedNode*) calloc(nodes_amt + 1, sizeof(CachedNode));
+    ctx->dirty          = (int*)        calloc(nodes_amt + 1, sizeof(int));
+    ctx->var_uses       = (int*)        calloc(nodes_amt + 1, sizeof(int));
+    ctx->var_uses_start = (int*)        calloc(expr->max_vars_amt + 1, sizeof(int));
+    ctx->var_values     = (double*)     calloc(expr->max_vars_amt + 1, sizeof(double));
+
+    if (ctx->nodes == nullptr || ctx->dirty == nullptr || ctx->var_uses == nullptr ||
+        ctx->var_uses_start == nullptr || ctx->var_values == nullptr)
+    {
+        EvalContextDtor(ctx);
+
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "EVALUATION CONTEXT";
+        return ExpressionErrors::ALLOCATE_MEMORY;
+    }
+
+    ctx->dirty_amt        = 0;
+    ctx->recalculated_amt = 0;
+
+    size_t pos = 0;
+    FillCachedNodes(ctx, expr->root, &pos);
+
+    for (size_t i = 0; i < expr->max_vars_amt; i++)
+        ctx->var_values[i] = expr->vars[i].value;
+
+    // leaves grouped by variable: count, prefix sums, then place
+    for (size_t i = 0; i < nodes_amt; i++)
+    {
+        const Node* node = ctx->nodes[i].node;
+
+        if (node->type == NodeType::VARIABLE)
+            ctx->var_uses_start[node->value.var + 1]++;
+    }
+
+    for (size_t i = 0; i < expr->max_vars_amt; i++)
+        ctx->var_uses_start[i + 1] += ctx->var_uses_start[i];
+
+    for (size_t i = 0; i < nodes_amt; i++)
+    {
+        const Node* node = ctx->nodes[i].node;
+
+        if (node->type == NodeType::VARIABLE)
+            ctx->var_uses[ctx->var_uses_start[node->value.var]++] = (int) i;
+    }
+
+    // placing shifted every start to the next one
+    for (size_t i = expr->max_vars_amt; i > 0; i--)
+        ctx->var_uses_start[i] = ctx->var_uses_start[i - 1];
+    ctx->var_uses_start[0] = 0;
+
+    return ExpressionErrors::NONE;
+}
+
+//------------------------------------------------------------------
+
+void EvalContextDtor(eval_ctx_t* ctx)
+{
+    assert(ctx);
+
+    free(ctx->nodes);
+    free(ctx->dirty);
+    free(ctx->var_uses);
+    free(ctx->var_uses_start);
+    free(ctx->var_values);
+
+    ctx->nodes          = nullptr;
+    ctx->dirty          = nullptr;
+    ctx->var_uses       = nullptr;
+    ctx->var_uses_start = nullptr;
+    ctx->var_values     = nullptr;
+    ctx->nodes_amt      = 0;
+    ctx->dirty_amt      = 0;
+}
+
+//------------------------------------------------------------------
+
+static void MarkDirty(eval_ctx_t* ctx, int node_id)
+{
+    assert(ctx);
+
+    // path above the first dirty node is already dirty
+    while (node_id != NO_CACHED_NODE && !ctx->nodes[node_id].dirty)
+    {
+        ctx->nodes[node_id].dirty    = true;
+        ctx->dirty[ctx->dirty_amt++] = node_id;
+
+        node_id = ctx->nodes[node_id].parent;
+    }
+}
+
+//------------------------------------------------------------------
+
+void EvalContextSetVariable(eval_ctx_t* ctx, const int var_id, const double value)
+{
+    assert(ctx);
+    assert(var_id >= 0 && (size_t) var_id < ctx->expr->max_vars_amt);
+
+    ctx->var_values[var_id] = value;
+
+    for (int i = ctx->var_uses_start[var_id]; i < ctx->var_uses_start[var_id + 1]; i++)
+        MarkDirty(ctx, ctx->var_uses[i]);
+}
+
+//------------------------------------------------------------------
+
+static void RecalculateNode(eval_ctx_t* ctx, CachedNode* cached, error_t* error)
+{
+    assert(ctx);
+    assert(cached);
+    assert(error);
+
+    const Node* node = cached->node;
+
+    switch (node->type)
+    {
+        case (NodeType::NUMBER):
+            cached->value = node->value.val;
+            break;
+
+        case (NodeType::VARIABLE):
+            cached->value = ctx->var_values[node->value.var];
+            break;
+
+        case (NodeType::OPERATOR):
+        {
+            double left  = (cached->left  != NO_CACHED_NODE) ? ctx->nodes[cached->left].value  : 0;
+            double right = (cached->right != NO_CACHED_NODE) ? ctx->nodes[cached->right].value : 0;
+
+            cached->value = CalculateOperation(left, right, node->value.opt, error);
+            break;
+        }
+
+        case (NodeType::POISON):
+        default:
+            error->code = (int) ExpressionErrors::INVALID_EXPRESSION_FORMAT;
+            break;
+    }
+}
+
+//------------------------------------------------------------------
+
+static int CompareNodeIds(const void* a, const void* b)
+{
+    return *(const int*) a - *(const int*) b;
+}
+
+//------------------------------------------------------------------
+
+double EvalContextCalculate(eval_ctx_t* ctx, error_t* error)
+{
+    assert(ctx);
+    assert(error);
+
+    if (ctx->nodes_amt == 0)
+        return 0;
+
+    // postorder ids: sorting puts every kid before its parent
+    qsort(ctx->dirty, ctx->dirty_amt, sizeof(int), CompareNodeIds);
+
+    for (size_t i = 0; i < ctx->dirty_amt; i++)
+    {
+        RecalculateNode(ctx, &ctx->nodes[ctx->dirty[i]], error);
+        if (error->code != (int) ExpressionErrors::NONE)
+            break;
+    }
+
+    ctx->recalculated_amt = ctx->dirty_amt;
+
+    // after error nodes stay dirty and will be recomputed next time
+    if (error->code != (int) ExpressionErrors::NONE)
+        return POISON;
+
+    for (size_t i = 0; i < ctx->dirty_amt; i++)
+        ctx->nodes[ctx->dirty[i]].dirty = false;
+
+    ctx->dirty_amt = 0;
+
+    return ctx->nodes[ctx->nodes_amt - 1].value;
+}
@@ -0,0 +1,52 @@
+#ifndef __INCREMENTAL_H_
+#define __INCREMENTAL_H_
+
+#include "expression/expression.h"
+
+// ======================================================================
+// EVALUATION CONTEXT
+// ======================================================================
+
+// value of every node is cached; changing variable marks only nodes on paths from its leaves to root,
+// next calculation recomputes only them
+
+static const int NO_CACHED_NODE = -1;
+
+struct CachedNode
+{
+    const Node* node;
+
+    int         parent;
+    int         left;
+    int         right;
+
+    double      value;
+    bool        dirty;
+};
+
+struct EvalContext
+{
+    const expr_t* expr;
+
+    CachedNode*   nodes;                // in postorder, so kids always go before parent
+    size_t        nodes_amt;
+
+    double*       var_values;
+    int*          var_uses_start;       // leaves of variable i are var_uses[var_uses_start[i]..var_uses_start[i + 1]]
+    int*          var_uses;
+
+    int*          dirty;
+    size_t        dirty_amt;
+
+    size_t        recalculated_amt;     // nodes recomputed by last calculation
+};
+typedef struct EvalContext eval_ctx_t;
+
+// tree of expr must not change while context lives, variable values are copied from expr->vars
+ExpressionErrors    EvalContextCtor(eval_ctx_t* ctx, const expr_t* expr, error_t* error);
+void                EvalContextDtor(eval_ctx_t* ctx);
+
+void                EvalContextSetVariable(eval_ctx_t* ctx, const int var_id, const double value);
+double              EvalContextCalculate(eval_ctx_t* ctx, error_t* error);
+
+#endif
@@ -0,0 +1,635 @@
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "interval.h"
+
+// glibc does not round transcendental functions correctly, so their results are widened by its
+// documented error bound (with some reserve) instead of one ulp
+static const int    LIBM_ERROR_ULPS = 4;
+
+// trigonometric arguments beyond this are too coarse to locate period on
+static const double MAX_PERIODIC_ARGUMENT = 1e12;
+static const double PERIOD_EPSILON        = 1e-12;
+// libm reduces argument by pi that is not exact, its error grows with argument
+static const double PERIOD_REDUCTION_ERROR = 0x1p-51;        // ulp(pi)
+
+static const interval_t EMPTY_INTERVAL  = {.lo = NAN,       .hi = NAN};
+static const interval_t ENTIRE_INTERVAL = {.lo = -INFINITY, .hi = INFINITY};
+
+// ======================================================================
+// ROUNDING
+// ======================================================================
+
+static inline double     RoundDown(double x, const int ulps);
+static inline double     RoundUp(double x, const int ulps);
+static inline interval_t MakeInterval(const double lo, const double hi, const int ulps);
+static inline interval_t ClampInterval(const interval_t interval, const double lo, const double hi);
+
+static inline double     Min4(const double a, const double b, const double c, const double d);
+static inline double     Max4(const double a, const double b, const double c, const double d);
+
+// ======================================================================
+// OPERATIONS
+// ======================================================================
+
+static interval_t   CalculateIntervalSubtree(const Node* node, const interval_t* vars, error_t* error);
+static interval_t   IntervalAction(const interval_t left, const interval_t right, const Operators operation,
+                                   error_t* error);
+
+static interval_t   IntervalMul(const interval_t a, const interval_t b);
+static interval_t   IntervalDiv(const interval_t a, const interval_t b);
+static interval_t   IntervalDeg(const interval_t base, const interval_t power);
+static interval_t   IntervalIntegerDeg(const interval_t base, const int power);
+static interval_t   IntervalLn(const interval_t a);
+static interval_t   IntervalSinCos(const interval_t a, const Operators operation);
+static interval_t   IntervalTan(const interval_t a);
+static interval_t   IntervalCot(const interval_t a);
+static double       Arccot(const double x);
+
+#ifdef INTERVAL_SELF_CHECK
+static long double  ReferenceOperation(const long double left, const long double right, const Operators operation);
+static void         CheckEnclosure(const interval_t left, const interval_t right, const Operators operation,
+                                   const interval_t result);
+#endif
+
+static bool         MayContainPeriodicPoint(const double lo, const double hi, const double phase,
+                                            const double period);
+
+static void         SearchRange(const expr_t* expr, interval_t* vars, const int var_id, const interval_t box,
+                                const double lo, const double hi, const double min_width,
+                                interval_t* found, size_t* found_amt, const size_t max_found, error_t* error);
+
+//------------------------------------------------------------------
+
+bool IsIntervalEmpty(const interval_t interval)
+{
+    return isnan(interval.lo) || isnan(interval.hi);
+}
+
+//------------------------------------------------------------------
+
+static inline double RoundDown(double x, const int ulps)
+{
+    for (int i = 0; i < ulps && isfinite(x); i++)
+        x = nextafter(x, -INFINITY);
+
+    return x;
+}
+
+//------------------------------------------------------------------
+
+static inline double RoundUp(double x, const int ulps)
+{
+    for (int i = 0; i < ulps && isfinite(x); i++)
+        x = nextafter(x, INFINITY);
+
+    return x;
+}
+
+//------------------------------------------------------------------
+
+static inline interval_t MakeInterval(const double lo, const double hi, const int ulps)
+{
+    if (isnan(lo) || isnan(hi))
+        return ENTIRE_INTERVAL;
+
+    return {.lo = RoundDown(lo, ulps), .hi = RoundUp(hi, ulps)};
+}
+
+//------------------------------------------------------------------
+
+static inline interval_t ClampInterval(const interval_t interval, const double lo, const double hi)
+{
+    return {.lo = fmax(interval.lo, lo), .hi = fmin(interval.hi, hi)};
+}
+
+//------------------------------------------------------------------
+
+static inline double Min4(const double a, const double b, const double c, const double d)
+{
+    return fmin(fmin(a, b), fmin(c, d));
+}
+
+//------------------------------------------------------------------
+
+static inline double Max4(const double a, const double b, const double c, const double d)
+{
+    return fmax(fmax(a, b), fmax(c, d));
+}
+
+//------------------------------------------------------------------
+
+static interval_t IntervalMul(const interval_t a, const interval_t b)
+{
+    double p1 = a.lo * b.lo;
+    double p2 = a.lo * b.hi;
+    double p3 = a.hi * b.lo;
+    double p4 = a.hi * b.hi;
+
+    // 0 * inf
+    if (isnan(p1) || isnan(p2) || isnan(p3) || isnan(p4))
+        return ENTIRE_INTERVAL;
+
+    return MakeInterval(Min4(p1, p2, p3, p4), Max4(p1, p2, p3, p4), 1);
+}
+
+//------------------------------------------------------------------
+
+static interval_t IntervalDiv(const interval_t a, const interval_t b)
+{
+    if (b.lo <= 0 && 0 <= b.hi)
+        return ENTIRE_INTERVAL;
+
+    double q1 = a.lo / b.lo;
+    double q2 = a.lo / b.hi;
+    double q3 = a.hi / b.lo;
+    double q4 = a.hi / b.hi;
+
+    // inf / inf
+    if (isnan(q1) || isnan(q2) || isnan(q3) || isnan(q4))
+        return ENTIRE_INTERVAL;
+
+    return MakeInterval(Min4(q1, q2, q3, q4), Max4(q1, q2, q3, q4), 1);
+}
+
+//------------------------------------------------------------------
+
+static interval_t IntervalIntegerDeg(const interval_t base, const int power)
+{
+    if (power == 0)
+        return {.lo = 1, .hi = 1};
+
+    if (power < 0)
+        return IntervalDiv({.lo = 1, .hi = 1}, IntervalIntegerDeg(base, -power));
+
+    double lo = pow(base.lo, power);
+    double hi = pow(base.hi, power);
+
+    if (power % 2 == 1)
+        return MakeInterval(lo, hi, LIBM_ERROR_ULPS);
+
+    if (base.lo >= 0)
+        return MakeInterval(lo, hi, LIBM_ERROR_ULPS);
+    if (base.hi <= 0)
+        return MakeInterval(hi, lo, LIBM_ERROR_ULPS);
+
+    return ClampInterval(MakeInterval(0, fmax(lo, hi), LIBM_ERROR_ULPS), 0, INFINITY);
+}
+
+//------------------------------------------------------------------
+
+static interval_t IntervalDeg(const interval_t base, const interval_t power)
+{
+#pragma GCC diagnostic ignored "-Wfloat-equal"
+    if (power.lo == power.hi && fabs(power.lo) <= INT_MAX && trunc(power.lo) == power.lo)
+        return IntervalIntegerDeg(base, (int) power.lo);
+#pragma GCC diagnostic warning "-Wfloat-equal"
+
+    interval_t result = EMPTY_INTERVAL;
+
+    // for non-negative base pow is monotonic in each argument, so extremes are in corners
+    if (base.hi >= 0)
+    {
+        double base_lo = fmax(base.lo, 0);
+
+        double p1 = pow(base_lo,  power.lo);
+        double p2 = pow(base_lo,  power.hi);
+        double p3 = pow(base.hi,  power.lo);
+        double p4 = pow(base.hi,  power.hi);
+
+        result = ClampInterval(MakeInterval(Min4(p1, p2, p3, p4), Max4(p1, p2, p3, p4), LIBM_ERROR_ULPS),
+                               0, INFINITY);
+    }
+
+    // negative base is defined only for integer powers inside of power interval, result can have any sign
+    if (base.lo < 0 && floor(power.hi) >= ceil(power.lo))
+    {
+        double abs_lo = (base.hi < 0) ? -base.hi : 0;
+        double abs_hi = -base.lo;
+
+        double p1 = pow(abs_lo, power.lo);
+        double p2 = pow(abs_lo, power.hi);
+        double p3 = pow(abs_hi, power.lo);
+        double p4 = pow(abs_hi, power.hi);
+
+        double bound = RoundUp(Max4(p1, p2, p3, p4), LIBM_ERROR_ULPS);
+        if (isnan(bound))
+            bound = INFINITY;
+
+        if (IsIntervalEmpty(result))
+            result = {.lo = -bound, .hi = bound};
+        else
+            result = {.lo = fmin(result.lo, -bound), .hi = fmax(result.hi, bound)};
+    }
+
+    return result;
+}
+
+//------------------------------------------------------------------
+
+static interval_t IntervalLn(const interval_t a)
+{
+    if (a.hi < 0)
+        return EMPTY_INTERVAL;
+
+    double lo = (a.lo > 0) ? log(a.lo) : -INFINITY;
+    double hi = log(a.hi);
+
+    return MakeInterval(lo, hi, LIBM_ERROR_ULPS);
+}
+
+//------------------------------------------------------------------
+
+static bool MayContainPeriodicPoint(const double lo, const double hi, const double phase, const double period)
+{
+    double k_lo = (lo - phase) / period;
+    double k_hi = (hi - phase) / period;
+
+    // rounding of k is covered by epsilon, that can only make answer more conservative
+    double eps  = PERIOD_EPSILON * (1 + fabs(k_lo) + fabs(k_hi));
+
+    return ceil(k_lo - eps) <= floor(k_hi + eps);
+}
+
+//------------------------------------------------------------------
+
+// sin and cos are taken from libm each, not one from another shifted by rounded pi/2
+static interval_t IntervalSinCos(const interval_t a, const Operators operation)
+{
+    assert(operation == Operators::SIN || operation == Operators::COS);
+
+    if (!isfinite(a.lo) || !isfinite(a.hi) || a.hi - a.lo >= 2 * M_PI ||
+        fabs(a.lo) > MAX_PERIODIC_ARGUMENT || fabs(a.hi) > MAX_PERIODIC_ARGUMENT)
+        return {.lo = -1, .hi = 1};
+
+    bool   is_sin  = (operation == Operators::SIN);
+    double val_lo  = is_sin ? sin(a.lo) : cos(a.lo);
+    double val_hi  = is_sin ? sin(a.hi) : cos(a.hi);
+    double reserve = PERIOD_REDUCTION_ERROR * fmax(fabs(a.lo), fabs(a.hi));
+
+    interval_t result = MakeInterval(fmin(val_lo, val_hi) - reserve, fmax(val_lo, val_hi) + reserve,
+                                     LIBM_ERROR_ULPS);
+
+    // maximums are in max_phase + 2pi k, minimums are pi away
+    double max_phase = is_sin ? M_PI / 2 : 0;
+
+    if (MayContainPeriodicPoint(a.lo, a.hi, max_phase, 2 * M_PI))
+        result.hi = 1;
+    if (MayContainPeriodicPoint(a.lo, a.hi, max_phase - M_PI, 2 * M_PI))
+        result.lo = -1;
+
+    return ClampInterval(result, -1, 1);
+}
+
+//------------------------------------------------------------------
+
+static interval_t IntervalTan(const interval_t a)
+{
+    if (!isfinite(a.lo) || !isfinite(a.hi) || a.hi - a.lo >= M_PI ||
+        fabs(a.lo) > MAX_PERIODIC_ARGUMENT || fabs(a.hi) > MAX_PERIODIC_ARGUMENT)
+        return ENTIRE_INTERVAL;
+
+    if (MayContainPeriodicPoint(a.lo, a.hi, M_PI / 2, M_PI))
+        return ENTIRE_INTERVAL;
+
+    return MakeInterval(tan(a.lo), tan(a.hi), LIBM_ERROR_ULPS);
+}
+
+//------------------------------------------------------------------
+
+static interval_t IntervalCot(const interval_t a)
+{
+    if (!isfinite(a.lo) || !isfinite(a.hi) || a.hi - a.lo >= M_PI ||
+        fabs(a.lo) > MAX_PERIODIC_ARGUMENT || fabs(a.hi) > MAX_PERIODIC_ARGUMENT)
+        return ENTIRE_INTERVAL;
+
+    if (MayContainPeriodicPoint(a.lo, a.hi, 0, M_PI))
+        return ENTIRE_INTERVAL;
+
+    // 1 / tan(x) is rounded twice
+    return MakeInterval(1 / tan(a.hi), 1 / tan(a.lo), LIBM_ERROR_ULPS + 1);
+}
+
+//------------------------------------------------------------------
+
+// pi/2 - atan(x) loses all digits for large x, so arccot is arctan of 1/x there
+static double Arccot(const double x)
+{
+    if (x > 1)
+        return atan(1 / x);
+    if (x < -1)
+        return M_PI + atan(1 / x);
+
+    return M_PI / 2 - atan(x);
+}
+
+//------------------------------------------------------------------
+
+static interval_t IntervalAction(const interval_t left, const interval_t right, const Operators operation,
+                                 error_t* error)
+{
+    assert(error);
+
+    // pow(NaN, 0) and pow(1, NaN) are 1, so undefined operand does not always make power undefined
+    if (operation == Operators::DEG && IsIntervalEmpty(left) != IsIntervalEmpty(right))
+    {
+        if (IsIntervalEmpty(left) && right.lo <= 0 && 0 <= right.hi)
+            return {.lo = 1, .hi = 1};
+        if (IsIntervalEmpty(right) && left.lo <= 1 && 1 <= left.hi)
+            return {.lo = 1, .hi = 1};
+    }
+
+    if (IsIntervalEmpty(left) || IsIntervalEmpty(right))
+        return EMPTY_INTERVAL;
+
+    switch (operation)
+    {
+        case (Operators::ADD):
+            return MakeInterval(left.lo + right.lo, left.hi + right.hi, 1);
+
+        case (Operators::SUB):
+            return MakeInterval(left.lo - right.hi, left.hi - right.lo, 1);
+
+        case (Operators::MUL):
+            return IntervalMul(left, right);
+
+        case (Operators::DIV):
+            return IntervalDiv(left, right);
+
+        case (Operators::DEG):
+            return IntervalDeg(left, right);
+
+        case (Operators::LN):
+            return IntervalLn(right);
+
+        case (Operators::EXP):
+            return ClampInterval(MakeInterval(exp(right.lo), exp(right.hi), LIBM_ERROR_ULPS), 0, INFINITY);
+
+        case (Operators::SIN):
+        case (Operators::COS):
+            return IntervalSinCos(right, operation);
+
+        case (Operators::TAN):
+            return IntervalTan(right);
+
+        case (Operators::COT):
+            return IntervalCot(right);
+
+        case (Operators::ARCSIN):
+        {
+            if (right.lo > 1 || right.hi < -1)
+                return EMPTY_INTERVAL;
+
+            interval_t arg = ClampInterval(right, -1, 1);
+            return ClampInterval(MakeInterval(asin(arg.lo), asin(arg.hi), LIBM_ERROR_ULPS),
+                                 RoundDown(-M_PI / 2, 1), RoundUp(M_PI / 2, 1));
+        }
+
+        case (Operators::ARCCOS):
+        {
+            if (right.lo > 1 || right.hi < -1)
+                return EMPTY_INTERVAL;
+
+            interval_t arg = ClampInterval(right, -1, 1);
+            return ClampInterval(MakeInterval(acos(arg.hi), acos(arg.lo), LIBM_ERROR_ULPS),
+                                 0, RoundUp(M_PI, 1));
+        }
+
+        case (Operators::ARCTAN):
+            return ClampInterval(MakeInterval(atan(right.lo), atan(right.hi), LIBM_ERROR_ULPS),
+                                 RoundDown(-M_PI / 2, 1), RoundUp(M_PI / 2, 1));
+
+        case (Operators::ARCCOT):
+            // 1 / x, atan and pi are rounded
+            return ClampInterval(MakeInterval(Arccot(right.hi), Arccot(right.lo), LIBM_ERROR_ULPS + 2),
+                                 0, RoundUp(M_PI, 1));
+
+        default:
+            error->code = (int) ExpressionErrors::UNKNOWN_OPERATION;
+            return EMPTY_INTERVAL;
+    }
+}
+
+//------------------------------------------------------------------
+
+#ifdef INTERVAL_SELF_CHECK
+
+// more precise than any interval bound, with no cancellation in arccot
+static long double ReferenceOperation(const long double left, const long double right, const Operators operation)
+{
+    switch (operation)
+    {
+        case (Operators::ADD):      return left + right;
+        case (Operators::SUB):      return left - right;
+        case (Operators::MUL):      return left * right;
+        case (Operators::DIV):      return left / right;
+        case (Operators::DEG):      return powl(left, right);
+        case (Operators::LN):       return logl(right);
+        case (Operators::EXP):      return expl(right);
+        case (Operators::SIN):      return sinl(right);
+        case (Operators::COS):      return cosl(right);
+        case (Operators::TAN):      return tanl(right);
+        case (Operators::COT):      return 1 / tanl(right);
+        case (Operators::ARCSIN):   return asinl(right);
+        case (Operators::ARCCOS):   return acosl(right);
+        case (Operators::ARCTAN):   return atanl(right);
+        case (Operators::ARCCOT):
+            if (fabsl(right) > 1)
+                return atanl(1 / right) + ((right < 0) ? acosl(-1.0L) : 0);
+            return acosl(-1.0L) / 2 - atanl(right);
+
+        default:
+            return NAN;
+    }
+}
+
+//------------------------------------------------------------------
+
+// operation on ends and middles of operands must be inside of result
+static void CheckEnclosure(const interval_t left, const interval_t right, const Operators operation,
+                           const interval_t result)
+{
+    if (IsIntervalEmpty(left) || IsIntervalEmpty(right))
+        return;
+
+    double left_samples[]  = {left.lo,  left.lo  + (left.hi  - left.lo)  / 2, left.hi};
+    double right_samples[] = {right.lo, right.lo + (right.hi - right.lo) / 2, right.hi};
+
+    for (size_t i = 0; i < sizeof(left_samples) / sizeof(double); i++)
+    {
+        for (size_t j = 0; j < sizeof(right_samples) / sizeof(double); j++)
+        {
+            if (!isfinite(left_samples[i]) || !isfinite(right_samples[j]))
+                continue;
+
+            // values out of double range are not checked, double bounds can not hold them anyway
+            long double value = ReferenceOperation(left_samples[i], right_samples[j], operation);
+            if (!isfinite((double) value))
+                continue;
+
+            assert(!IsIntervalEmpty(result));
+            assert(result.lo <= value && value <= result.hi);
+        }
+    }
+}
+
+#endif
+
+//------------------------------------------------------------------
+
+static interval_t CalculateIntervalSubtree(const Node* node, const interval_t* vars, error_t* error)
+{
+    assert(vars);
+    assert(error);
+
+    if (!node) return {.lo = 0, .hi = 0};
+
+    if (node->left == nullptr && node->right == nullptr)
+    {
+        if (node->type == NodeType::NUMBER)
+            return {.lo = node->value.val, .hi = node->value.val};
+        else if (node->type == NodeType::VARIABLE)
+            return vars[node->value.var];
+
+        error->code = (int) ExpressionErrors::INVALID_EXPRESSION_FORMAT;
+        return EMPTY_INTERVAL;
+    }
+
+    if (node->type != NodeType::OPERATOR)
+    {
+        error->code = (int) ExpressionErrors::INVALID_EXPRESSION_FORMAT;
+        return EMPTY_INTERVAL;
+    }
+
+    interval_t left = CalculateIntervalSubtree(node->left, vars, error);
+    if (error->code != (int) ExpressionErrors::NONE)
+        return EMPTY_INTERVAL;
+
+    interval_t right = CalculateIntervalSubtree(node->right, vars, error);
+    if (error->code != (int) ExpressionErrors::NONE)
+        return EMPTY_INTERVAL;
+
+    interval_t result = IntervalAction(left, right, node->value.opt, error);
+
+#ifdef INTERVAL_SELF_CHECK
+    if (error->code == (int) ExpressionErrors::NONE)
+        CheckEnclosure(left, right, node->value.opt, result);
+#endif
+
+    return result;
+}
+
+//------------------------------------------------------------------
+
+interval_t CalculateExpressionInterval(const expr_t* expr, const interval_t* vars, error_t* error)
+{
+    assert(expr);
+    assert(vars);
+    assert(error);
+
+    return CalculateIntervalSubtree(expr->root, vars, error);
+}
+
+//------------------------------------------------------------------
+
+bool MayReachRange(const expr_t* expr, const interval_t* vars, const double lo, const double hi,
+                   error_t* error)
+{
+    assert(expr);
+    assert(vars);
+    assert(error);
+
+    interval_t result = CalculateExpressionInterval(expr, vars, error);
+
+    if (IsIntervalEmpty(result))
+        return false;
+
+    return result.lo <= hi && lo <= result.hi;
+}
+
+//------------------------------------------------------------------
+
+bool MayHaveZero(const expr_t* expr, const interval_t* vars, error_t* error)
+{
+    return MayReachRange(expr, vars, 0, 0, error);
+}
+
+//------------------------------------------------------------------
+
+static void SearchRange(const expr_t* expr, interval_t* vars, const int var_id, const interval_t box,
+                        const double lo, const double hi, const double min_width,
+                        interval_t* found, size_t* found_amt, const size_t max_found, error_t* error)
+{
+    vars[var_id] = box;
+
+    bool may_reach = MayReachRange(expr, vars, lo, hi, error);
+    if (!may_reach || error->code != (int) ExpressionErrors::NONE)
+        return;
+
+    double mid = box.lo + (box.hi - box.lo) / 2;
+
+    if (box.hi - box.lo > min_width && box.lo < mid && mid < box.hi)
+    {
+        SearchRange(expr, vars, var_id, {.lo = box.lo, .hi = mid}, lo, hi, min_width,
+                    found, found_amt, max_found, error);
+        SearchRange(expr, vars, var_id, {.lo = mid,    .hi = box.hi}, lo, hi, min_width,
+                    found, found_amt, max_found, error);
+        return;
+    }
+
+    // touching boxes are merged; when there is no space left last box swallows the rest
+    if (*found_amt > 0 && (found[*found_amt - 1].hi >= box.lo || *found_amt == max_found))
+    {
+        found[*found_amt - 1].hi = box.hi;
+        return;
+    }
+
+    if (*found_amt < max_found)
+        found[(*found_amt)++] = box;
+}
+
+//------------------------------------------------------------------
+
+size_t FindRangeSubintervals(const expr_t* expr, const int var_id, const interval_t domain,
+                             const double lo, const double hi, const double min_width,
+                             interval_t* found, const size_t max_found, error_t* error)
+{
+    assert(expr);
+    assert(found);
+    assert(error);
+
+    if (var_id == NO_VARIABLE)
+    {
+        error->code = (int) ExpressionErrors::NO_DIFF_VARIABLE;
+        return 0;
+    }
+
+    interval_t* vars = (interval_t*) calloc(expr->max_vars_amt, sizeof(interval_t));
+    if (vars == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "INTERVAL VARIABLES";
+        return 0;
+    }
+
+    for (size_t i = 0; i < expr->max_vars_amt; i++)
+        vars[i] = {.lo = expr->vars[i].value, .hi = expr->vars[i].value};
+
+    size_t found_amt = 0;
+
+    SearchRange(expr, vars, var_id, domain, lo, hi, min_width, found, &found_amt, max_found, error);
+
+    free(vars);
+
+    return found_amt;
+}
+
+//------------------------------------------------------------------
+
+size_t FindZeroSubintervals(const expr_t* expr, const int var_id, const interval_t domain,
+                            const double min_width, interval_t* found, const size_t max_found,
+                            error_t* error)
+{
+    return FindRangeSubintervals(expr, var_id, domain, 0, 0, min_width, found, max_found, error);
+}
@@ -0,0 +1,45 @@
+#ifndef __INTERVAL_H_
+#define __INTERVAL_H_
+
+#include "expression/expression.h"
+
+// ======================================================================
+// INTERVALS
+// ======================================================================
+
+// closed interval [lo, hi]; NaN bounds mean empty interval (expression is undefined on whole box)
+struct Interval
+{
+    double lo;
+    double hi;
+};
+typedef struct Interval interval_t;
+
+bool        IsIntervalEmpty(const interval_t interval);
+
+// vars are indexed by variable id, like expr->vars; result contains every value that expression
+// takes on the box (rounding is outward, so enclosure is guaranteed); built with INTERVAL_SELF_CHECK
+// every operation is checked to contain its more precise values on ends and middles of operands
+interval_t  CalculateExpressionInterval(const expr_t* expr, const interval_t* vars, error_t* error);
+
+// ======================================================================
+// PRUNING
+// ======================================================================
+
+// false means expression provably does not reach [lo, hi] on the box
+bool        MayReachRange(const expr_t* expr, const interval_t* vars, const double lo, const double hi,
+                          error_t* error);
+bool        MayHaveZero(const expr_t* expr, const interval_t* vars, error_t* error);
+
+// bisects domain of var (other variables are fixed to their values) down to pieces not wider than
+// min_width, skipping parts where expression stays out of [lo, hi]; found gets sorted subintervals
+// that may reach range, touching pieces are merged (so they may be wider) and the last one swallows
+// the rest when found is full
+size_t      FindRangeSubintervals(const expr_t* expr, const int var_id, const interval_t domain,
+                                  const double lo, const double hi, const double min_width,
+                                  interval_t* found, const size_t max_found, error_t* error);
+size_t      FindZeroSubintervals(const expr_t* expr, const int var_id, const interval_t domain,
+                                 const double min_width, interval_t* found, const size_t max_found,
+                                 error_t* error);
+
+#endif
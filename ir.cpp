@@ -0,0 +1,1060 @@
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "ir.h"
+#include "calculation.h"
+
+static const size_t IR_INIT_CAPACITY   = 32;
+static const size_t IR_INIT_TABLE_SIZE = 64;
+
+static const unsigned IR_REWRITE_NONE     = 0;
+static const unsigned IR_REWRITE_FOLD     = 1 << 0;
+static const unsigned IR_REWRITE_STRENGTH = 1 << 1;
+
+// ======================================================================
+// VALUE NUMBERING
+// ======================================================================
+
+static uint64_t     HashInstruction(const IrInstruction* instr);
+static bool         AreInstructionsSame(const IrInstruction* a, const IrInstruction* b);
+static bool         IsCommutative(const Operators operation);
+
+static void         RehashTable(ir_t* ir, const size_t new_size, error_t* error);
+static void         ReserveCode(ir_t* ir, error_t* error);
+
+// ======================================================================
+// REWRITING
+// ======================================================================
+
+static void         RebuildProgram(ir_t* ir, const int* order, const size_t order_size,
+                                   const unsigned rewrites, error_t* error);
+static int          RewriteInstruction(ir_t* dest, const IrInstruction* instr, const int left, const int right,
+                                       const unsigned rewrites, error_t* error);
+
+static int          FoldOperation(ir_t* ir, const Operators operation, const int left, const int right,
+                                  error_t* error);
+static int          ReduceOperation(ir_t* ir, const Operators operation, const int left, const int right,
+                                    error_t* error);
+#ifdef __FAST_MATH__
+static int          MakePowerChain(ir_t* ir, const int base, int power, error_t* error);
+#endif
+
+static inline int   AddNumber(ir_t* ir, const double val, error_t* error);
+static inline int   AddOperation(ir_t* ir, const Operators operation, const int left, const int right,
+                                 error_t* error);
+
+static bool         IsNumber(const ir_t* ir, const int value, double* val);
+static bool         IsConstant(const ir_t* ir, const int value, const double expected);
+static bool         IsPowerOfTwo(const double val);
+
+static int*         MakeIdentityOrder(const size_t size, error_t* error);
+
+static int          GetRegisterNeed(const int* labels, const int left, const int right);
+static void         ScheduleValue(const ir_t* ir, const int value, const int* labels, bool* visited,
+                                  int* order, size_t* order_size);
+
+static const char*  GetOperatorSymbol(const Operators operation);
+
+//------------------------------------------------------------------
+
+ExpressionErrors IrCtor(ir_t* ir, error_t* error)
+{
+    assert(ir);
+    assert(error);
+
+    ir->code             = (IrInstruction*) calloc(IR_INIT_CAPACITY, sizeof(IrInstruction));
+    ir->outputs          = (int*) calloc(IR_INIT_CAPACITY, sizeof(int));
+    ir->table            = (int*) calloc(IR_INIT_TABLE_SIZE, sizeof(int));
+
+    if (ir->code == nullptr || ir->outputs == nullptr || ir->table == nullptr)
+    {
+        free(ir->code);
+        free(ir->outputs);
+        free(ir->table);
+
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "IR PROGRAM";
+        return ExpressionErrors::ALLOCATE_MEMORY;
+    }
+
+    for (size_t i = 0; i < IR_INIT_TABLE_SIZE; i++)
+        ir->table[i] = NO_IR_VALUE;
+
+    ir->size             = 0;
+    ir->capacity         = IR_INIT_CAPACITY;
+    ir->outputs_amt      = 0;
+    ir->outputs_capacity = IR_INIT_CAPACITY;
+    ir->table_size       = IR_INIT_TABLE_SIZE;
+
+    return ExpressionErrors::NONE;
+}
+
+//------------------------------------------------------------------
+
+void IrDtor(ir_t* ir)
+{
+    assert(ir);
+
+    free(ir->code);
+    free(ir->outputs);
+    free(ir->table);
+
+    ir->code             = nullptr;
+    ir->outputs          = nullptr;
+    ir->table            = nullptr;
+    ir->size             = 0;
+    ir->capacity         = 0;
+    ir->outputs_amt      = 0;
+    ir->outputs_capacity = 0;
+    ir->table_size       = 0;
+}
+
+//------------------------------------------------------------------
+
+static uint64_t HashInstruction(const IrInstruction* instr)
+{
+    assert(instr);
+
+    uint64_t key = (uint64_t) instr->type;
+
+    switch (instr->type)
+    {
+        case (NodeType::NUMBER):
+        {
+            uint64_t bits = 0;
+            memcpy(&bits, &instr->value.val, sizeof(bits));
+            key = key * 31 + bits;
+            break;
+        }
+        case (NodeType::VARIABLE):
+            key = key * 31 + (uint64_t) instr->value.var;
+            break;
+        case (NodeType::OPERATOR):
+            key = key * 31 + (uint64_t) instr->value.opt;
+            break;
+        case (NodeType::POISON):
+        // fall through
+        default:
+            break;
+    }
+
+    key = key * 1000003 + (uint64_t) (instr->left  + 1);
+    key = key * 1000003 + (uint64_t) (instr->right + 1);
+
+    // splitmix64 finalizer
+    key ^= key >> 30;
+    key *= 0xBF58476D1CE4E5B9;
+    key ^= key >> 27;
+    key *= 0x94D049BB133111EB;
+    key ^= key >> 31;
+
+    return key;
+}
+
+//------------------------------------------------------------------
+
+static bool AreInstructionsSame(const IrInstruction* a, const IrInstruction* b)
+{
+    assert(a);
+    assert(b);
+
+    if (a->type != b->type || a->left != b->left || a->right != b->right)
+        return false;
+
+    switch (a->type)
+    {
+        case (NodeType::NUMBER):
+            return memcmp(&a->value.val, &b->value.val, sizeof(double)) == 0;
+        case (NodeType::VARIABLE):
+            return a->value.var == b->value.var;
+        case (NodeType::OPERATOR):
+            return a->value.opt == b->value.opt;
+        case (NodeType::POISON):
+        // fall through
+        default:
+            return false;
+    }
+}
+
+//------------------------------------------------------------------
+
+static bool IsCommutative(const Operators operation)
+{
+    return operation == Operators::ADD || operation == Operators::MUL;
+}
+
+//------------------------------------------------------------------
+
+static void RehashTable(ir_t* ir, const size_t new_size, error_t* error)
+{
+    assert(ir);
+    assert(error);
+
+    int* table = (int*) calloc(new_size, sizeof(int));
+    if (table == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "IR VALUES TABLE";
+        return;
+    }
+
+    for (size_t i = 0; i < new_size; i++)
+        table[i] = NO_IR_VALUE;
+
+    for (size_t id = 0; id < ir->size; id++)
+    {
+        size_t pos = HashInstruction(&ir->code[id]) & (new_size - 1);
+
+        while (table[pos] != NO_IR_VALUE)
+            pos = (pos + 1) & (new_size - 1);
+
+        table[pos] = (int) id;
+    }
+
+    free(ir->table);
+    ir->table      = table;
+    ir->table_size = new_size;
+}
+
+//------------------------------------------------------------------
+
+static void ReserveCode(ir_t* ir, error_t* error)
+{
+    assert(ir);
+    assert(error);
+
+    if (ir->size < ir->capacity)
+        return;
+
+    IrInstruction* code = (IrInstruction*) realloc(ir->code, ir->capacity * 2 * sizeof(IrInstruction));
+    if (code == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "IR PROGRAM";
+        return;
+    }
+
+    ir->code      = code;
+    ir->capacity *= 2;
+}
+
+//------------------------------------------------------------------
+
+int IrAddValue(ir_t* ir, const NodeType type, const NodeValue value,
+               const int left, const int right, error_t* error)
+{
+    assert(ir);
+    assert(error);
+
+    IrInstruction instr = {.type = type, .value = value, .left = NO_IR_VALUE, .right = NO_IR_VALUE};
+
+    if (type == NodeType::OPERATOR)
+    {
+        instr.left  = left;
+        instr.right = right;
+
+        if (IsCommutative(value.opt) && left > right)
+        {
+            instr.left  = right;
+            instr.right = left;
+        }
+    }
+
+    if ((ir->size + 1) * 2 > ir->table_size)
+    {
+        RehashTable(ir, ir->table_size * 2, error);
+        if (error->code != (int) ExpressionErrors::NONE)
+            return NO_IR_VALUE;
+    }
+
+    size_t pos = HashInstruction(&instr) & (ir->table_size - 1);
+
+    while (ir->table[pos] != NO_IR_VALUE)
+    {
+        if (AreInstructionsSame(&ir->code[ir->table[pos]], &instr))
+            return ir->table[pos];
+
+        pos = (pos + 1) & (ir->table_size - 1);
+    }
+
+    ReserveCode(ir, error);
+    if (error->code != (int) ExpressionErrors::NONE)
+        return NO_IR_VALUE;
+
+    int id = (int) ir->size++;
+
+    ir->code[id]    = instr;
+    ir->table[pos]  = id;
+
+    return id;
+}
+
+//------------------------------------------------------------------
+
+int IrAddOutput(ir_t* ir, const int value, error_t* error)
+{
+    assert(ir);
+    assert(error);
+
+    if (ir->outputs_amt == ir->outputs_capacity)
+    {
+        int* outputs = (int*) realloc(ir->outputs, ir->outputs_capacity * 2 * sizeof(int));
+        if (outputs == nullptr)
+        {
+            error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+            error->data = "IR OUTPUTS";
+            return NO_IR_VALUE;
+        }
+
+        ir->outputs           = outputs;
+        ir->outputs_capacity *= 2;
+    }
+
+    ir->outputs[ir->outputs_amt] = value;
+
+    return (int) ir->outputs_amt++;
+}
+
+//------------------------------------------------------------------
+
+int IrAddOperation(ir_t* ir, const Operators operation, const int left, const int right, error_t* error)
+{
+    assert(ir);
+    assert(error);
+
+    IrInstruction instr = {.type = NodeType::OPERATOR, .value = {.opt = operation}, .left = left, .right = right};
+
+    return RewriteInstruction(ir, &instr, left, right, IR_REWRITE_FOLD | IR_REWRITE_STRENGTH, error);
+}
+
+//------------------------------------------------------------------
+
+int IrLowerNode(ir_t* ir, const Node* node, error_t* error)
+{
+    assert(ir);
+    assert(error);
+
+    if (!node) return NO_IR_VALUE;
+
+    if (node->left == nullptr && node->right == nullptr)
+    {
+        if (node->type == NodeType::NUMBER || node->type == NodeType::VARIABLE)
+            return IrAddValue(ir, node->type, node->value, NO_IR_VALUE, NO_IR_VALUE, error);
+
+        error->code = (int) ExpressionErrors::INVALID_EXPRESSION_FORMAT;
+        return NO_IR_VALUE;
+    }
+
+    if (node->type != NodeType::OPERATOR)
+    {
+        error->code = (int) ExpressionErrors::INVALID_EXPRESSION_FORMAT;
+        return NO_IR_VALUE;
+    }
+
+    int left = IrLowerNode(ir, node->left, error);
+    if (error->code != (int) ExpressionErrors::NONE)
+        return NO_IR_VALUE;
+
+    int right = IrLowerNode(ir, node->right, error);
+    if (error->code != (int) ExpressionErrors::NONE)
+        return NO_IR_VALUE;
+
+    return IrAddValue(ir, NodeType::OPERATOR, node->value, left, right, error);
+}
+
+//------------------------------------------------------------------
+
+int IrLowerExpression(ir_t* ir, const expr_t* expr, error_t* error)
+{
+    assert(ir);
+    assert(expr);
+    assert(error);
+
+    int value = IrLowerNode(ir, expr->root, error);
+    if (error->code != (int) ExpressionErrors::NONE)
+        return NO_IR_VALUE;
+
+    return IrAddOutput(ir, value, error);
+}
+
+//------------------------------------------------------------------
+
+Node* IrMakeTree(const ir_t* ir, const int value)
+{
+    assert(ir);
+
+    if (value == NO_IR_VALUE) return nullptr;
+
+    const IrInstruction* instr = &ir->code[value];
+
+    return MakeNode(instr->type, instr->value, IrMakeTree(ir, instr->left), IrMakeTree(ir, instr->right), nullptr);
+}
+
+//------------------------------------------------------------------
+
+static void RebuildProgram(ir_t* ir, const int* order, const size_t order_size,
+                           const unsigned rewrites, error_t* error)
+{
+    assert(ir);
+    assert(order);
+    assert(error);
+
+    int* map = (int*) calloc(ir->size + 1, sizeof(int));
+    if (map == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "IR VALUES MAP";
+        return;
+    }
+
+    ir_t new_ir = {};
+    IrCtor(&new_ir, error);
+    if (error->code != (int) ExpressionErrors::NONE)
+    {
+        free(map);
+        return;
+    }
+
+    for (size_t i = 0; i < ir->size; i++)
+        map[i] = NO_IR_VALUE;
+
+    for (size_t i = 0; i < order_size; i++)
+    {
+        const IrInstruction* instr = &ir->code[order[i]];
+
+        int left  = (instr->left  != NO_IR_VALUE) ? map[instr->left]  : NO_IR_VALUE;
+        int right = (instr->right != NO_IR_VALUE) ? map[instr->right] : NO_IR_VALUE;
+
+        map[order[i]] = RewriteInstruction(&new_ir, instr, left, right, rewrites, error);
+        if (error->code != (int) ExpressionErrors::NONE)
+            break;
+    }
+
+    for (size_t i = 0; i < ir->outputs_amt && error->code == (int) ExpressionErrors::NONE; i++)
+        IrAddOutput(&new_ir, map[ir->outputs[i]], error);
+
+    free(map);
+
+    if (error->code != (int) ExpressionErrors::NONE)
+    {
+        IrDtor(&new_ir);
+        return;
+    }
+
+    IrDtor(ir);
+    *ir = new_ir;
+}
+
+//------------------------------------------------------------------
+
+static int RewriteInstruction(ir_t* dest, const IrInstruction* instr, const int left, const int right,
+                              const unsigned rewrites, error_t* error)
+{
+    assert(dest);
+    assert(instr);
+    assert(error);
+
+    if (instr->type != NodeType::OPERATOR)
+        return IrAddValue(dest, instr->type, instr->value, NO_IR_VALUE, NO_IR_VALUE, error);
+
+    int result = NO_IR_VALUE;
+
+    if (rewrites & IR_REWRITE_FOLD)
+    {
+        result = FoldOperation(dest, instr->value.opt, left, right, error);
+        if (result != NO_IR_VALUE)
+            return result;
+    }
+
+    if (rewrites & IR_REWRITE_STRENGTH)
+    {
+        result = ReduceOperation(dest, instr->value.opt, left, right, error);
+        if (result != NO_IR_VALUE)
+            return result;
+    }
+
+    return AddOperation(dest, instr->value.opt, left, right, error);
+}
+
+//------------------------------------------------------------------
+
+static int FoldOperation(ir_t* ir, const Operators operation, const int left, const int right, error_t* error)
+{
+    assert(ir);
+    assert(error);
+
+    double left_val  = 0;
+    double right_val = 0;
+
+    if (left != NO_IR_VALUE && !IsNumber(ir, left, &left_val))
+        return NO_IR_VALUE;
+
+    if (right != NO_IR_VALUE && !IsNumber(ir, right, &right_val))
+        return NO_IR_VALUE;
+
+    double result = CalculateOperation(left_val, right_val, operation, error);
+    if (error->code != (int) ExpressionErrors::NONE)
+        return NO_IR_VALUE;
+
+    return AddNumber(ir, result, error);
+}
+
+//------------------------------------------------------------------
+
+static int ReduceOperation(ir_t* ir, const Operators operation, const int left, const int right, error_t* error)
+{
+    assert(ir);
+    assert(error);
+
+    double val = 0;
+
+    switch (operation)
+    {
+        case (Operators::ADD):
+            if (IsConstant(ir, left, -0.0)) return right;
+            if (IsConstant(ir, right, -0.0)) return left;
+#ifdef __FAST_MATH__
+            if (IsConstant(ir, left, 0))    return right;
+            if (IsConstant(ir, right, 0))   return left;
+#endif
+            break;
+
+        case (Operators::SUB):
+            if (IsConstant(ir, right, 0))   return left;
+#if __FINITE_MATH_ONLY__
+            if (left == right && left != NO_IR_VALUE)
+                return AddNumber(ir, 0, error);
+#endif
+            break;
+
+        case (Operators::MUL):
+            if (IsConstant(ir, left, 1))    return right;
+            if (IsConstant(ir, right, 1))   return left;
+#ifdef __FAST_MATH__
+            if (IsConstant(ir, left, 0) || IsConstant(ir, right, 0))
+                return AddNumber(ir, 0, error);
+#endif
+            if (IsConstant(ir, left, 2))    return AddOperation(ir, Operators::ADD, right, right, error);
+            if (IsConstant(ir, right, 2))   return AddOperation(ir, Operators::ADD, left, left, error);
+            break;
+
+        case (Operators::DIV):
+            if (IsConstant(ir, right, 1))   return left;
+
+            // division by power of two is exactly multiplication by its inverse
+            if (IsNumber(ir, right, &val) && IsPowerOfTwo(val))
+                return AddOperation(ir, Operators::MUL, left, AddNumber(ir, 1 / val, error), error);
+            break;
+
+        case (Operators::DEG):
+            if (IsConstant(ir, right, 1))   return left;
+            if (IsConstant(ir, right, 0) || IsConstant(ir, right, -0.0) || IsConstant(ir, left, 1))
+                return AddNumber(ir, 1, error);
+
+#ifdef __FAST_MATH__
+            if (IsNumber(ir, right, &val) && fabs(val) <= IR_MAX_UNROLLED_POWER && IsConstant(ir, right, trunc(val)))
+            {
+                int power = (int) fabs(val);
+                int chain = MakePowerChain(ir, left, power, error);
+
+                if (val > 0)
+                    return chain;
+
+                return AddOperation(ir, Operators::DIV, AddNumber(ir, 1, error), chain, error);
+            }
+#endif
+            break;
+
+        default:
+            break;
+    }
+
+    return NO_IR_VALUE;
+}
+
+//------------------------------------------------------------------
+
+#ifdef __FAST_MATH__
+
+static int MakePowerChain(ir_t* ir, const int base, int power, error_t* error)
+{
+    assert(ir);
+    assert(power > 0);
+
+    int result = NO_IR_VALUE;
+    int square = base;
+
+    while (power != 0)
+    {
+        if (power & 1)
+            result = (result == NO_IR_VALUE) ? square : AddOperation(ir, Operators::MUL, result, square, error);
+
+        power >>= 1;
+
+        if (power != 0)
+            square = AddOperation(ir, Operators::MUL, square, square, error);
+    }
+
+    return result;
+}
+
+#endif
+
+//------------------------------------------------------------------
+
+static inline int AddNumber(ir_t* ir, const double val, error_t* error)
+{
+    return IrAddValue(ir, NodeType::NUMBER, {.val = val}, NO_IR_VALUE, NO_IR_VALUE, error);
+}
+
+//------------------------------------------------------------------
+
+static inline int AddOperation(ir_t* ir, const Operators operation, const int left, const int right,
+                               error_t* error)
+{
+    return IrAddValue(ir, NodeType::OPERATOR, {.opt = operation}, left, right, error);
+}
+
+//------------------------------------------------------------------
+
+static bool IsNumber(const ir_t* ir, const int value, double* val)
+{
+    assert(ir);
+    assert(val);
+
+    if (value == NO_IR_VALUE || ir->code[value].type != NodeType::NUMBER)
+        return false;
+
+    *val = ir->code[value].value.val;
+
+    return true;
+}
+
+//------------------------------------------------------------------
+
+#pragma GCC diagnostic ignored "-Wfloat-equal"
+
+// rewrites must not change results, so constants are compared exactly, sign of zero included.
+// x - x is 0 only for finite x, so it is folded with -ffinite-math-only alone; x + 0 and x * 0 also
+// lose sign of zero, and multiplication chains for x^n round differently from pow (about one ulp
+// per multiplication, glibc pow differs from x * x in ~0.1% of cases), so they need -ffast-math
+static bool IsConstant(const ir_t* ir, const int value, const double expected)
+{
+    double val = 0;
+
+    return IsNumber(ir, value, &val) && val == expected && signbit(val) == signbit(expected);
+}
+
+//------------------------------------------------------------------
+
+static bool IsPowerOfTwo(const double val)
+{
+    int exponent = 0;
+
+    return isfinite(val) && isfinite(1 / val) && fabs(frexp(val, &exponent)) == 0.5;
+}
+
+#pragma GCC diagnostic warning "-Wfloat-equal"
+
+//------------------------------------------------------------------
+
+static int* MakeIdentityOrder(const size_t size, error_t* error)
+{
+    assert(error);
+
+    int* order = (int*) calloc(size + 1, sizeof(int));
+    if (order == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "IR ORDER";
+        return nullptr;
+    }
+
+    for (size_t i = 0; i < size; i++)
+        order[i] = (int) i;
+
+    return order;
+}
+
+//------------------------------------------------------------------
+
+void IrFoldConstants(ir_t* ir, error_t* error)
+{
+    assert(ir);
+    assert(error);
+
+    int* order = MakeIdentityOrder(ir->size, error);
+    if (order == nullptr)
+        return;
+
+    RebuildProgram(ir, order, ir->size, IR_REWRITE_FOLD, error);
+
+    free(order);
+}
+
+//------------------------------------------------------------------
+
+void IrNumberValues(ir_t* ir, error_t* error)
+{
+    assert(ir);
+    assert(error);
+
+    int* order = MakeIdentityOrder(ir->size, error);
+    if (order == nullptr)
+        return;
+
+    RebuildProgram(ir, order, ir->size, IR_REWRITE_NONE, error);
+
+    free(order);
+}
+
+//------------------------------------------------------------------
+
+void IrReduceStrength(ir_t* ir, error_t* error)
+{
+    assert(ir);
+    assert(error);
+
+    int* order = MakeIdentityOrder(ir->size, error);
+    if (order == nullptr)
+        return;
+
+    RebuildProgram(ir, order, ir->size, IR_REWRITE_STRENGTH, error);
+
+    free(order);
+}
+
+//------------------------------------------------------------------
+
+void IrEliminateDeadCode(ir_t* ir, error_t* error)
+{
+    assert(ir);
+    assert(error);
+
+    bool* live  = (bool*) calloc(ir->size + 1, sizeof(bool));
+    int*  order = (int*)  calloc(ir->size + 1, sizeof(int));
+    if (live == nullptr || order == nullptr)
+    {
+        free(live);
+        free(order);
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "IR LIVENESS";
+        return;
+    }
+
+    for (size_t i = 0; i < ir->outputs_amt; i++)
+        if (ir->outputs[i] != NO_IR_VALUE)
+            live[ir->outputs[i]] = true;
+
+    // operands are always defined earlier, so one backward sweep is enough
+    for (size_t i = ir->size; i-- > 0; )
+    {
+        if (!live[i])
+            continue;
+
+        if (ir->code[i].left  != NO_IR_VALUE)   live[ir->code[i].left]  = true;
+        if (ir->code[i].right != NO_IR_VALUE)   live[ir->code[i].right] = true;
+    }
+
+    size_t order_size = 0;
+    for (size_t i = 0; i < ir->size; i++)
+        if (live[i])
+            order[order_size++] = (int) i;
+
+    RebuildProgram(ir, order, order_size, IR_REWRITE_NONE, error);
+
+    free(live);
+    free(order);
+}
+
+//------------------------------------------------------------------
+
+static int GetRegisterNeed(const int* labels, const int left, const int right)
+{
+    assert(labels);
+
+    if (left == NO_IR_VALUE && right == NO_IR_VALUE)
+        return 1;
+    if (left == NO_IR_VALUE)
+        return labels[right];
+    if (right == NO_IR_VALUE || left == right)
+        return labels[left];
+
+    int left_need  = labels[left];
+    int right_need = labels[right];
+
+    return (left_need == right_need) ? left_need + 1 :
+           (left_need > right_need)  ? left_need : right_need;
+}
+
+//------------------------------------------------------------------
+
+static void ScheduleValue(const ir_t* ir, const int value, const int* labels, bool* visited,
+                          int* order, size_t* order_size)
+{
+    if (value == NO_IR_VALUE || visited[value])
+        return;
+
+    visited[value] = true;
+
+    int left  = ir->code[value].left;
+    int right = ir->code[value].right;
+
+    // operand that needs more registers is calculated first, like in Sethi-Ullman numbering
+    if (right != NO_IR_VALUE && (left == NO_IR_VALUE || labels[right] > labels[left]))
+    {
+        ScheduleValue(ir, right, labels, visited, order, order_size);
+        ScheduleValue(ir, left,  labels, visited, order, order_size);
+    }
+    else
+    {
+        ScheduleValue(ir, left,  labels, visited, order, order_size);
+        ScheduleValue(ir, right, labels, visited, order, order_size);
+    }
+
+    order[(*order_size)++] = value;
+}
+
+//------------------------------------------------------------------
+
+void IrSchedule(ir_t* ir, error_t* error)
+{
+    assert(ir);
+    assert(error);
+
+    int*  labels  = (int*)  calloc(ir->size + 1, sizeof(int));
+    bool* visited = (bool*) calloc(ir->size + 1, sizeof(bool));
+    int*  order   = (int*)  calloc(ir->size + 1, sizeof(int));
+    if (labels == nullptr || visited == nullptr || order == nullptr)
+    {
+        free(labels);
+        free(visited);
+        free(order);
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "IR SCHEDULE";
+        return;
+    }
+
+    for (size_t i = 0; i < ir->size; i++)
+        labels[i] = GetRegisterNeed(labels, ir->code[i].left, ir->code[i].right);
+
+    size_t order_size = 0;
+    for (size_t i = 0; i < ir->outputs_amt; i++)
+        ScheduleValue(ir, ir->outputs[i], labels, visited, order, &order_size);
+
+    RebuildProgram(ir, order, order_size, IR_REWRITE_NONE, error);
+
+    free(labels);
+    free(visited);
+    free(order);
+}
+
+//------------------------------------------------------------------
+
+void IrOptimize(ir_t* ir, error_t* error)
+{
+    assert(ir);
+    assert(error);
+
+    int* order = MakeIdentityOrder(ir->size, error);
+    if (order == nullptr)
+        return;
+
+    RebuildProgram(ir, order, ir->size, IR_REWRITE_FOLD | IR_REWRITE_STRENGTH, error);
+    free(order);
+    if (error->code != (int) ExpressionErrors::NONE)
+        return;
+
+    IrEliminateDeadCode(ir, error);
+    if (error->code != (int) ExpressionErrors::NONE)
+        return;
+
+    IrSchedule(ir, error);
+}
+
+//------------------------------------------------------------------
+
+void IrCalculate(const ir_t* ir, const variable_t* vars, double* values, double* results, error_t* error)
+{
+    assert(ir);
+    assert(vars);
+    assert(values);
+    assert(error);
+
+    for (size_t i = 0; i < ir->size; i++)
+    {
+        const IrInstruction* instr = &ir->code[i];
+
+        switch (instr->type)
+        {
+            case (NodeType::NUMBER):
+                values[i] = instr->value.val;
+                break;
+
+            case (NodeType::VARIABLE):
+                values[i] = vars[instr->value.var].value;
+                break;
+
+            case (NodeType::OPERATOR):
+            {
+                double left  = (instr->left  != NO_IR_VALUE) ? values[instr->left]  : 0;
+                double right = (instr->right != NO_IR_VALUE) ? values[instr->right] : 0;
+
+                values[i] = CalculateOperation(left, right, instr->value.opt, error);
+                if (error->code != (int) ExpressionErrors::NONE)
+                    return;
+
+                break;
+            }
+
+            case (NodeType::POISON):
+            // fall through
+            default:
+                error->code = (int) ExpressionErrors::INVALID_EXPRESSION_FORMAT;
+                return;
+        }
+    }
+
+    if (results == nullptr)
+        return;
+
+    for (size_t i = 0; i < ir->outputs_amt; i++)
+        results[i] = (ir->outputs[i] != NO_IR_VALUE) ? values[ir->outputs[i]] : 0;
+}
+
+//------------------------------------------------------------------
+
+#define DEF_OP(name, symb, ...)         \
+        case (Operators::name):         \
+            return symb;
+
+static const char* GetOperatorSymbol(const Operators operation)
+{
+    switch (operation)
+    {
+        #include "operations.h"
+
+        default:
+            return "undefined_operator";
+    }
+}
+
+#undef DEF_OP
+
+//------------------------------------------------------------------
+
+void IrPrint(FILE* fp, const ir_t* ir, const variable_t* vars)
+{
+    assert(fp);
+    assert(ir);
+
+    for (size_t i = 0; i < ir->size; i++)
+    {
+        const IrInstruction* instr = &ir->code[i];
+
+        fprintf(fp, "%%%zu = ", i);
+
+        switch (instr->type)
+        {
+            case (NodeType::NUMBER):
+                fprintf(fp, "%g\n", instr->value.val);
+                break;
+
+            case (NodeType::VARIABLE):
+                if (vars != nullptr)
+                    fprintf(fp, "%s\n", vars[instr->value.var].variable_name);
+                else
+                    fprintf(fp, "var[%d]\n", instr->value.var);
+                break;
+
+            case (NodeType::OPERATOR):
+                fprintf(fp, "%s", GetOperatorSymbol(instr->value.opt));
+
+                if (instr->left != NO_IR_VALUE)
+                    fprintf(fp, " %%%d", instr->left);
+                if (instr->right != NO_IR_VALUE)
+                    fprintf(fp, " %%%d", instr->right);
+
+                fprintf(fp, "\n");
+                break;
+
+            case (NodeType::POISON):
+            // fall through
+            default:
+                fprintf(fp, "undefined\n");
+        }
+    }
+
+    for (size_t i = 0; i < ir->outputs_amt; i++)
+        fprintf(fp, "out[%zu] = %%%d\n", i, ir->outputs[i]);
+}
+
+//------------------------------------------------------------------
+
+ExpressionErrors IrKernelCtor(ir_kernel_t* kernel, const expr_t* const* exprs, const size_t exprs_amt,
+                              error_t* error)
+{
+    assert(kernel);
+    assert(exprs);
+    assert(error);
+
+    kernel->values = nullptr;
+
+    IrCtor(&kernel->ir, error);
+    RETURN_IF_EXPRESSION_ERROR((ExpressionErrors) error->code);
+
+    for (size_t i = 0; i < exprs_amt; i++)
+    {
+        IrLowerExpression(&kernel->ir, exprs[i], error);
+        if (error->code != (int) ExpressionErrors::NONE)
+        {
+            IrDtor(&kernel->ir);
+            return (ExpressionErrors) error->code;
+        }
+    }
+
+    IrOptimize(&kernel->ir, error);
+    if (error->code != (int) ExpressionErrors::NONE)
+    {
+        IrDtor(&kernel->ir);
+        return (ExpressionErrors) error->code;
+    }
+
+    kernel->values = (double*) calloc(kernel->ir.size + 1, sizeof(double));
+    if (kernel->values == nullptr)
+    {
+        IrDtor(&kernel->ir);
+
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "IR KERNEL VALUES";
+        return ExpressionErrors::ALLOCATE_MEMORY;
+    }
+
+    return ExpressionErrors::NONE;
+}
+
+//------------------------------------------------------------------
+
+void IrKernelDtor(ir_kernel_t* kernel)
+{
+    assert(kernel);
+
+    IrDtor(&kernel->ir);
+    free(kernel->values);
+
+    kernel->values = nullptr;
+}
+
+//------------------------------------------------------------------
+
+void IrKernelCalculate(ir_kernel_t* kernel, const variable_t* vars, double* results, error_t* error)
+{
+    assert(kernel);
+    assert(vars);
+    assert(results);
+    assert(error);
+
+    IrCalculate(&kernel->ir, vars, kernel->values, results, error);
+}
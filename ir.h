@@ -0,0 +1,107 @@
+#ifndef __IR_H_
+#define __IR_H_
+
+#include "expression/expression.h"
+
+// ======================================================================
+// SSA INSTRUCTIONS
+// ======================================================================
+
+// every instruction defines one value, its id is its position in program;
+// operands always refer to earlier instructions, so program order is a valid evaluation order
+
+static const int NO_IR_VALUE = -1;
+
+struct IrInstruction
+{
+    NodeType  type;
+    NodeValue value;
+
+    int       left;
+    int       right;
+};
+
+// ======================================================================
+// PROGRAM
+// ======================================================================
+
+struct IrProgram
+{
+    IrInstruction* code;
+    size_t         size;
+    size_t         capacity;
+
+    int*           outputs;
+    size_t         outputs_amt;
+    size_t         outputs_capacity;
+
+    int*           table;               // value numbering hash table, NO_IR_VALUE in free cells
+    size_t         table_size;
+};
+typedef struct IrProgram ir_t;
+
+ExpressionErrors    IrCtor(ir_t* ir, error_t* error);
+void                IrDtor(ir_t* ir);
+
+// equal instructions are never added twice, id of existing one is returned instead
+int                 IrAddValue(ir_t* ir, const NodeType type, const NodeValue value,
+                               const int left, const int right, error_t* error);
+int                 IrAddOutput(ir_t* ir, const int value, error_t* error);
+
+// operator with constant folding and strength reduction, result may be an existing value
+int                 IrAddOperation(ir_t* ir, const Operators operation, const int left, const int right,
+                                   error_t* error);
+
+int                 IrLowerNode(ir_t* ir, const Node* node, error_t* error);
+int                 IrLowerExpression(ir_t* ir, const expr_t* expr, error_t* error);
+
+Node*               IrMakeTree(const ir_t* ir, const int value);
+
+// ======================================================================
+// PASSES
+// ======================================================================
+
+void                IrFoldConstants(ir_t* ir, error_t* error);
+void                IrNumberValues(ir_t* ir, error_t* error);
+void                IrEliminateDeadCode(ir_t* ir, error_t* error);
+void                IrReduceStrength(ir_t* ir, error_t* error);
+void                IrSchedule(ir_t* ir, error_t* error);
+
+void                IrOptimize(ir_t* ir, error_t* error);
+
+static const int    IR_MAX_UNROLLED_POWER = 16;
+
+// ======================================================================
+// EVALUATION
+// ======================================================================
+
+// values is scratch with ir->size elements, results (if not nullptr) gets ir->outputs_amt elements
+void                IrCalculate(const ir_t* ir, const variable_t* vars, double* values, double* results,
+                                error_t* error);
+
+void                IrPrint(FILE* fp, const ir_t* ir, const variable_t* vars);
+
+// ======================================================================
+// KERNELS
+// ======================================================================
+
+// several expressions over the same variables in one optimized program with one output per
+// expression: subtrees they share are computed once per calculation
+
+struct IrKernel
+{
+    ir_t    ir;
+    double* values;
+};
+typedef struct IrKernel ir_kernel_t;
+
+ExpressionErrors    IrKernelCtor(ir_kernel_t* kernel, const expr_t* const* exprs, const size_t exprs_amt,
+                                 error_t* error);
+void                IrKernelDtor(ir_kernel_t* kernel);
+
+// results gets value of every expression, in order they were given to constructor; values of kernel
+// are its scratch, so one kernel is not calculated by several threads at once
+void                IrKernelCalculate(ir_kernel_t* kernel, const variable_t* vars, double* results,
+                                      error_t* error);
+
+#endif
@@ -0,0 +1,664 @@
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "jit.h"
+#include "calculation.h"
+#include "dsl.h"
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define JIT_X86_64 1
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#define JIT_X86_64 0
+#endif
+
+// ======================================================================
+// CALLEES
+// ======================================================================
+
+// every operator that is not emitted inline is called through the wrapper with its DEF_OP action
+
+typedef double (*jit_callee_f)(const double NUMBER_1, const double NUMBER_2);
+
+#define DEF_OP(name, symb, priority, arg_amt, action, ...)                                              \
+        static double JitCallee##name([[maybe_unused]] const double NUMBER_1,                           \
+                                      [[maybe_unused]] const double NUMBER_2)                           \
+        {                                                                                               \
+            return action;                                                                              \
+        }
+
+#include "operations.h"
+
+#undef DEF_OP
+
+//------------------------------------------------------------------
+
+#define DEF_OP(name, ...)                           \
+        case (Operators::name):                     \
+            return JitCallee##name;
+
+static jit_callee_f GetCallee(const Operators operation)
+{
+    switch (operation)
+    {
+        #include "operations.h"
+
+        default:
+            return nullptr;
+    }
+}
+
+#undef DEF_OP
+
+#if JIT_X86_64
+
+// ======================================================================
+// CODE BUFFER
+// ======================================================================
+
+struct CodeBuffer
+{
+    unsigned char* buf;
+    size_t         size;
+    size_t         capacity;
+
+    int            spill_depth;
+    int            max_spill_depth;
+};
+
+struct JitLabel
+{
+    int    need;        // registers needed to calculate subtree without spilling
+    size_t size;        // nodes in subtree
+};
+
+static const size_t CODE_BUFFER_INIT_CAPACITY = 256;
+
+static const int    SCRATCH_A = 14;
+static const int    SCRATCH_B = 15;
+
+static const int    RSP = 4;
+static const int    RBX = 3;
+
+static const unsigned char PREFIX_F2 = 0xF2;
+static const unsigned char PREFIX_66 = 0x66;
+
+static const unsigned char MOVSD_LOAD  = 0x10;
+static const unsigned char MOVSD_STORE = 0x11;
+static const unsigned char ADDSD       = 0x58;
+static const unsigned char MULSD       = 0x59;
+static const unsigned char SUBSD       = 0x5C;
+static const unsigned char DIVSD       = 0x5E;
+static const unsigned char XORPD       = 0x57;
+
+static void   EmitByte(CodeBuffer* code, const unsigned char byte, error_t* error);
+static void   EmitDword(CodeBuffer* code, const uint32_t dword, error_t* error);
+static void   EmitQword(CodeBuffer* code, const uint64_t qword, error_t* error);
+
+static void   EmitSseRegReg(CodeBuffer* code, const unsigned char prefix, const unsigned char opcode,
+                            const int reg, const int rm, error_t* error);
+static void   EmitSseMem(CodeBuffer* code, const unsigned char prefix, const unsigned char opcode,
+                         const int reg, const int base, const int32_t disp, error_t* error);
+
+static void   EmitMove(CodeBuffer* code, const int dest, const int src, error_t* error);
+static void   EmitLoadConst(CodeBuffer* code, const int reg, const double val, error_t* error);
+static void   EmitCall(CodeBuffer* code, const jit_callee_f func, error_t* error);
+
+static size_t EmitPrologue(CodeBuffer* code, error_t* error);
+static void   EmitEpilogue(CodeBuffer* code, const uint32_t frame_size, error_t* error);
+
+static inline int32_t SaveSlot(const int reg);
+static inline int32_t SpillSlot(const int depth);
+
+// ======================================================================
+// CODE GENERATION
+// ======================================================================
+
+static size_t CountNodes(const Node* node);
+static size_t LabelNodes(const Node* node, JitLabel* labels, const size_t id);
+
+static void   GenerateNode(CodeBuffer* code, const Node* node, const JitLabel* labels, const size_t id,
+                           const int reg, error_t* error);
+static void   GenerateOperands(CodeBuffer* code, const Node* node, const JitLabel* labels, const size_t id,
+                               const int reg, int* left_reg, int* right_reg, error_t* error);
+static void   GenerateOperation(CodeBuffer* code, const Operators operation, const int reg,
+                                const int left_reg, const int right_reg, error_t* error);
+
+static unsigned char GetInlineOpcode(const Operators operation);
+
+static void   MapCode(jit_t* jit, const CodeBuffer* code, error_t* error);
+
+//------------------------------------------------------------------
+
+static void EmitByte(CodeBuffer* code, const unsigned char byte, error_t* error)
+{
+    assert(code);
+    assert(error);
+
+    if (code->size == code->capacity)
+    {
+        size_t new_capacity = (code->capacity == 0) ? CODE_BUFFER_INIT_CAPACITY : code->capacity * 2;
+
+        unsigned char* new_buf = (unsigned char*) realloc(code->buf, new_capacity);
+        if (new_buf == nullptr)
+        {
+            error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+            error->data = "JIT CODE BUFFER";
+            return;
+        }
+
+        code->buf      = new_buf;
+        code->capacity = new_capacity;
+    }
+
+    code->buf[code->size++] = byte;
+}
+
+//------------------------------------------------------------------
+
+static void EmitDword(CodeBuffer* code, const uint32_t dword, error_t* error)
+{
+    for (int i = 0; i < 4; i++)
+        EmitByte(code, (unsigned char) (dword >> (8 * i)), error);
+}
+
+//------------------------------------------------------------------
+
+static void EmitQword(CodeBuffer* code, const uint64_t qword, error_t* error)
+{
+    for (int i = 0; i < 8; i++)
+        EmitByte(code, (unsigned char) (qword >> (8 * i)), error);
+}
+
+//------------------------------------------------------------------
+
+static void EmitSseRegReg(CodeBuffer* code, const unsigned char prefix, const unsigned char opcode,
+                          const int reg, const int rm, error_t* error)
+{
+    EmitByte(code, prefix, error);
+
+    unsigned char rex = (unsigned char) (0x40 | ((reg & 8) ? 0x04 : 0) | ((rm & 8) ? 0x01 : 0));
+    if (rex != 0x40)
+        EmitByte(code, rex, error);
+
+    EmitByte(code, 0x0F, error);
+    EmitByte(code, opcode, error);
+    EmitByte(code, (unsigned char) (0xC0 | ((reg & 7) << 3) | (rm & 7)), error);
+}
+
+//------------------------------------------------------------------
+
+static void EmitSseMem(CodeBuffer* code, const unsigned char prefix, const unsigned char opcode,
+                       const int reg, const int base, const int32_t disp, error_t* error)
+{
+    EmitByte(code, prefix, error);
+
+    if (reg & 8)
+        EmitByte(code, 0x44, error);
+
+    EmitByte(code, 0x0F, error);
+    EmitByte(code, opcode, error);
+    EmitByte(code, (unsigned char) (0x80 | ((reg & 7) << 3) | base), error);
+
+    if (base == RSP)
+        EmitByte(code, 0x24, error);
+
+    EmitDword(code, (uint32_t) disp, error);
+}
+
+//------------------------------------------------------------------
+
+static void EmitMove(CodeBuffer* code, const int dest, const int src, error_t* error)
+{
+    if (dest == src)
+        return;
+
+    EmitSseRegReg(code, PREFIX_F2, MOVSD_LOAD, dest, src, error);
+}
+
+//------------------------------------------------------------------
+
+static void EmitLoadConst(CodeBuffer* code, const int reg, const double val, error_t* error)
+{
+    uint64_t bits = 0;
+    memcpy(&bits, &val, sizeof(bits));
+
+    if (bits == 0)
+    {
+        EmitSseRegReg(code, PREFIX_66, XORPD, reg, reg, error);
+        return;
+    }
+
+    // mov rax, imm64
+    EmitByte(code, 0x48, error);
+    EmitByte(code, 0xB8, error);
+    EmitQword(code, bits, error);
+
+    // movq xmm, rax
+    EmitByte(code, PREFIX_66, error);
+    EmitByte(code, (unsigned char) (0x48 | ((reg & 8) ? 0x04 : 0)), error);
+    EmitByte(code, 0x0F, error);
+    EmitByte(code, 0x6E, error);
+    EmitByte(code, (unsigned char) (0xC0 | ((reg & 7) << 3)), error);
+}
+
+//------------------------------------------------------------------
+
+static void EmitCall(CodeBuffer* code, const jit_callee_f func, error_t* error)
+{
+    // mov rax, imm64
+    EmitByte(code, 0x48, error);
+    EmitByte(code, 0xB8, error);
+    EmitQword(code, (uint64_t) func, error);
+
+    // call rax
+    EmitByte(code, 0xFF, error);
+    EmitByte(code, 0xD0, error);
+}
+
+//------------------------------------------------------------------
+
+static size_t EmitPrologue(CodeBuffer* code, error_t* error)
+{
+    // push rbx
+    EmitByte(code, 0x53, error);
+
+    // mov rbx, rdi
+    EmitByte(code, 0x48, error);
+    EmitByte(code, 0x89, error);
+    EmitByte(code, 0xFB, error);
+
+    // sub rsp, imm32 (frame size is patched when code is generated)
+    EmitByte(code, 0x48, error);
+    EmitByte(code, 0x81, error);
+    EmitByte(code, 0xEC, error);
+
+    size_t frame_size_pos = code->size;
+    EmitDword(code, 0, error);
+
+    return frame_size_pos;
+}
+
+//------------------------------------------------------------------
+
+static void EmitEpilogue(CodeBuffer* code, const uint32_t frame_size, error_t* error)
+{
+    // add rsp, imm32
+    EmitByte(code, 0x48, error);
+    EmitByte(code, 0x81, error);
+    EmitByte(code, 0xC4, error);
+    EmitDword(code, frame_size, error);
+
+    // pop rbx
+    EmitByte(code, 0x5B, error);
+
+    // ret
+    EmitByte(code, 0xC3, error);
+}
+
+//------------------------------------------------------------------
+
+static inline int32_t SaveSlot(const int reg)
+{
+    return (int32_t) ((size_t) reg * sizeof(double));
+}
+
+//------------------------------------------------------------------
+
+static inline int32_t SpillSlot(const int depth)
+{
+    return (int32_t) ((size_t) (JIT_REGISTERS_AMT + depth) * sizeof(double));
+}
+
+//------------------------------------------------------------------
+
+static size_t CountNodes(const Node* node)
+{
+    if (!node) return 0;
+
+    return CountNodes(node->left) + CountNodes(node->right) + 1;
+}
+
+//------------------------------------------------------------------
+
+static size_t LabelNodes(const Node* node, JitLabel* labels, const size_t id)
+{
+    assert(labels);
+
+    if (!node) return 0;
+
+    size_t left_size  = LabelNodes(node->left, labels, id + 1);
+    size_t right_size = LabelNodes(node->right, labels, id + 1 + left_size);
+
+    int need = 1;
+
+    if (node->left != nullptr && node->right != nullptr)
+    {
+        int left_need  = labels[id + 1].need;
+        int right_need = labels[id + 1 + left_size].need;
+
+        need = (left_need == right_need) ? left_need + 1 :
+               (left_need > right_need)  ? left_need : right_need;
+    }
+    else if (node->left != nullptr)
+        need = labels[id + 1].need;
+    else if (node->right != nullptr)
+        need = labels[id + 1].need;
+
+    labels[id].need = need;
+    labels[id].size = left_size + right_size + 1;
+
+    return labels[id].size;
+}
+
+//------------------------------------------------------------------
+
+static void GenerateNode(CodeBuffer* code, const Node* node, const JitLabel* labels, const size_t id,
+                         const int reg, error_t* error)
+{
+    assert(code);
+    assert(labels);
+    assert(error);
+
+    if (error->code != (int) ExpressionErrors::NONE)
+        return;
+
+    if (!node)
+    {
+        EmitLoadConst(code, reg, 0, error);
+        return;
+    }
+
+    if (node->left == nullptr && node->right == nullptr)
+    {
+        if (TYPE(node) == NodeType::NUMBER)
+            EmitLoadConst(code, reg, VAL(node), error);
+        else if (TYPE(node) == NodeType::VARIABLE)
+            EmitSseMem(code, PREFIX_F2, MOVSD_LOAD, reg, RBX,
+                       (int32_t) ((size_t) VAR(node) * sizeof(variable_t) + offsetof(variable_t, value)), error);
+        else
+            error->code = (int) ExpressionErrors::INVALID_EXPRESSION_FORMAT;
+
+        return;
+    }
+
+    if (TYPE(node) != NodeType::OPERATOR)
+    {
+        error->code = (int) ExpressionErrors::INVALID_EXPRESSION_FORMAT;
+        return;
+    }
+
+    int left_reg  = reg;
+    int right_reg = reg;
+
+    GenerateOperands(code, node, labels, id, reg, &left_reg, &right_reg, error);
+
+    GenerateOperation(code, OPT(node), reg, left_reg, right_reg, error);
+}
+
+//------------------------------------------------------------------
+
+static void GenerateOperands(CodeBuffer* code, const Node* node, const JitLabel* labels, const size_t id,
+                             const int reg, int* left_reg, int* right_reg, error_t* error)
+{
+    assert(node);
+    assert(left_reg);
+    assert(right_reg);
+
+    size_t left_id  = id + 1;
+    size_t right_id = id + 1 + ((node->left != nullptr) ? labels[left_id].size : 0);
+
+    // missing operand is zero, like in interpreter
+
+    if (node->left == nullptr)
+    {
+        GenerateNode(code, node->right, labels, right_id, reg, error);
+        EmitLoadConst(code, SCRATCH_B, 0, error);
+
+        *left_reg  = SCRATCH_B;
+        *right_reg = reg;
+        return;
+    }
+
+    if (node->right == nullptr)
+    {
+        GenerateNode(code, node->left, labels, left_id, reg, error);
+        EmitLoadConst(code, SCRATCH_B, 0, error);
+
+        *left_reg  = reg;
+        *right_reg = SCRATCH_B;
+        return;
+    }
+
+    if (reg + 1 < JIT_REGISTERS_AMT)
+    {
+        // Sethi-Ullman order: subtree which needs more registers goes first
+
+        if (labels[right_id].need > labels[left_id].need)
+        {
+            GenerateNode(code, node->right, labels, right_id, reg, error);
+            GenerateNode(code, node->left,  labels, left_id,  reg + 1, error);
+
+            *left_reg  = reg + 1;
+            *right_reg = reg;
+        }
+        else
+        {
+            GenerateNode(code, node->left,  labels, left_id,  reg, error);
+            GenerateNode(code, node->right, labels, right_id, reg + 1, error);
+
+            *left_reg  = reg;
+            *right_reg = reg + 1;
+        }
+
+        return;
+    }
+
+    // out of registers: keep left operand on stack while right one is calculated
+
+    GenerateNode(code, node->left, labels, left_id, reg, error);
+
+    int depth = code->spill_depth++;
+    if (code->spill_depth > code->max_spill_depth)
+        code->max_spill_depth = code->spill_depth;
+
+    EmitSseMem(code, PREFIX_F2, MOVSD_STORE, reg, RSP, SpillSlot(depth), error);
+
+    GenerateNode(code, node->right, labels, right_id, reg, error);
+
+    EmitSseMem(code, PREFIX_F2, MOVSD_LOAD, SCRATCH_B, RSP, SpillSlot(depth), error);
+    code->spill_depth--;
+
+    *left_reg  = SCRATCH_B;
+    *right_reg = reg;
+}
+
+//------------------------------------------------------------------
+
+static unsigned char GetInlineOpcode(const Operators operation)
+{
+    switch (operation)
+    {
+        case (Operators::ADD):
+            return ADDSD;
+        case (Operators::SUB):
+            return SUBSD;
+        case (Operators::MUL):
+            return MULSD;
+        case (Operators::DIV):
+            return DIVSD;
+        default:
+            return 0;
+    }
+}
+
+//------------------------------------------------------------------
+
+static void GenerateOperation(CodeBuffer* code, const Operators operation, const int reg,
+                              const int left_reg, const int right_reg, error_t* error)
+{
+    assert(code);
+    assert(error);
+
+    unsigned char opcode = GetInlineOpcode(operation);
+
+    if (opcode != 0)
+    {
+        EmitSseRegReg(code, PREFIX_F2, opcode, left_reg, right_reg, error);
+        EmitMove(code, reg, left_reg, error);
+        return;
+    }
+
+    jit_callee_f callee = GetCallee(operation);
+    if (callee == nullptr)
+    {
+        error->code = (int) ExpressionErrors::UNKNOWN_OPERATION;
+        return;
+    }
+
+    // all xmm registers are caller-saved, so live ones are kept in frame during call
+
+    for (int i = 0; i < reg; i++)
+        EmitSseMem(code, PREFIX_F2, MOVSD_STORE, i, RSP, SaveSlot(i), error);
+
+    EmitMove(code, SCRATCH_A, right_reg, error);
+    EmitMove(code, 0, left_reg, error);
+    EmitMove(code, 1, SCRATCH_A, error);
+
+    EmitCall(code, callee, error);
+
+    EmitMove(code, reg, 0, error);
+
+    for (int i = 0; i < reg; i++)
+        EmitSseMem(code, PREFIX_F2, MOVSD_LOAD, i, RSP, SaveSlot(i), error);
+}
+
+//------------------------------------------------------------------
+
+static void MapCode(jit_t* jit, const CodeBuffer* code, error_t* error)
+{
+    assert(jit);
+    assert(code);
+    assert(error);
+
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    size_t map_size  = (code->size + page_size - 1) / page_size * page_size;
+
+    void* mem = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "JIT EXECUTABLE MEMORY";
+        return;
+    }
+
+    memcpy(mem, code->buf, code->size);
+
+    if (mprotect(mem, map_size, PROT_READ | PROT_EXEC) != 0)
+    {
+        munmap(mem, map_size);
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "JIT EXECUTABLE MEMORY";
+        return;
+    }
+
+    jit->code      = (unsigned char*) mem;
+    jit->code_size = map_size;
+
+    static_assert(sizeof(jit->func) == sizeof(mem), "function and data pointers differ");
+    memcpy(&jit->func, &mem, sizeof(jit->func));
+}
+
+#endif
+
+//------------------------------------------------------------------
+
+bool IsJitSupported()
+{
+    return JIT_X86_64;
+}
+
+//------------------------------------------------------------------
+
+ExpressionErrors JitCompile(jit_t* jit, const expr_t* expr, error_t* error)
+{
+    assert(jit);
+    assert(expr);
+    assert(error);
+
+    jit->expr      = expr;
+    jit->code      = nullptr;
+    jit->code_size = 0;
+    jit->nodes_amt = CountNodes(expr->root);
+    jit->func      = nullptr;
+
+#if JIT_X86_64
+    JitLabel* labels = (JitLabel*) calloc(CountNodes(expr->root) + 1, sizeof(JitLabel));
+    if (labels == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "JIT LABELS";
+        return ExpressionErrors::ALLOCATE_MEMORY;
+    }
+
+    LabelNodes(expr->root, labels, 0);
+
+    CodeBuffer code = {};
+
+    size_t frame_size_pos = EmitPrologue(&code, error);
+
+    GenerateNode(&code, expr->root, labels, 0, 0, error);
+
+    uint32_t frame_size = (uint32_t) SpillSlot(code.max_spill_depth);
+    frame_size = (frame_size + 15) / 16 * 16;
+
+    EmitEpilogue(&code, frame_size, error);
+
+    if (error->code == (int) ExpressionErrors::NONE)
+    {
+        memcpy(code.buf + frame_size_pos, &frame_size, sizeof(frame_size));
+        MapCode(jit, &code, error);
+    }
+
+    free(code.buf);
+    free(labels);
+#endif
+
+    return (ExpressionErrors) error->code;
+}
+
+//------------------------------------------------------------------
+
+double JitCalculate(const jit_t* jit, const variable_t* vars, error_t* error)
+{
+    assert(jit);
+    assert(vars);
+    assert(error);
+
+    if (jit->func != nullptr)
+        return jit->func(vars);
+
+    return CalculateExpression(jit->expr, vars, error);
+}
+
+//------------------------------------------------------------------
+
+void JitDtor(jit_t* jit)
+{
+    assert(jit);
+
+#if JIT_X86_64
+    if (jit->code != nullptr)
+        munmap(jit->code, jit->code_size);
+#endif
+
+    jit->expr      = nullptr;
+    jit->code      = nullptr;
+    jit->code_size = 0;
+    jit->nodes_amt = 0;
+    jit->func      = nullptr;
+}
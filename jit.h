@@ -0,0 +1,34 @@
+#ifndef __JIT_H_
+#define __JIT_H_
+
+#include "expression/expression.h"
+
+// ======================================================================
+// NATIVE CODE
+// ======================================================================
+
+// compiled expression: takes symbol table with variables values, returns result
+typedef double (*jit_f)(const variable_t* vars);
+
+struct JitFunction
+{
+    const expr_t*  expr;
+
+    unsigned char* code;
+    size_t         code_size;
+    size_t         nodes_amt;      // of expression tree, every one is a few instructions
+
+    jit_f          func;
+};
+typedef struct JitFunction jit_t;
+
+static const int JIT_REGISTERS_AMT = 14;
+
+// on hosts without x86-64 code generator jit->func stays nullptr and JitCalculate interprets the tree
+ExpressionErrors    JitCompile(jit_t* jit, const expr_t* expr, error_t* error);
+double              JitCalculate(const jit_t* jit, const variable_t* vars, error_t* error);
+void                JitDtor(jit_t* jit);
+
+bool                IsJitSupported();
+
+#endif
@@ -0,0 +1,556 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lut.h"
+#include "ir.h"
+#include "calculation.h"
+
+struct LutHeader
+{
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    reserved;
+
+    uint64_t    cells_amt;
+    uint64_t    segments_amt;
+    uint64_t    knots_amt;
+
+    double      left;
+    double      right;
+    double      max_error;
+};
+
+struct LutContext
+{
+    ir_kernel_t     kernel;         // expression and its derivative
+    variable_t*     vars;           // shallow copy of expr->vars, var_id value is changed
+    int             var_id;
+
+    double          tolerance;
+
+    int*            depths;         // dyadic position of every segment
+    size_t*         positions;
+    size_t          segments_capacity;
+    size_t          knots_capacity;
+};
+
+static ExpressionErrors LutContextCtor(LutContext* ctx, const expr_t* expr, const int var_id,
+                                       const double tolerance, error_t* error);
+static void             LutContextDtor(LutContext* ctx);
+
+static void     CalculateFunction(LutContext* ctx, const double x, double* results, error_t* error);
+static double*  ReserveKnots(lut_t* lut, LutContext* ctx, const size_t amt, error_t* error);
+static bool     FitSegment(lut_t* lut, LutContext* ctx, LutSegment* segment, const double left, const double right,
+                           const size_t max_intervals, double* max_error, error_t* error);
+static void     AddSegment(lut_t* lut, LutContext* ctx, LutSegment* segment, const double max_error,
+                           const int depth, const size_t position, error_t* error);
+static void     BuildAdaptive(lut_t* lut, LutContext* ctx, const double left, const double right, const int depth,
+                              const size_t position, error_t* error);
+static void     BuildCells(lut_t* lut, const LutContext* ctx, error_t* error);
+
+static bool     CheckLutLayout(const lut_t* lut);
+
+//------------------------------------------------------------------
+
+static ExpressionErrors LutContextCtor(LutContext* ctx, const expr_t* expr, const int var_id,
+                                       const double tolerance, error_t* error)
+{
+    assert(ctx);
+    assert(expr);
+    assert(error);
+
+    ctx->var_id    = var_id;
+    ctx->tolerance = tolerance;
+
+    ctx->vars = (variable_t*) calloc(expr->max_vars_amt, sizeof(variable_t));
+    if (ctx->vars == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "LOOKUP TABLE";
+        return ExpressionErrors::ALLOCATE_MEMORY;
+    }
+
+    memcpy(ctx->vars, expr->vars, expr->max_vars_amt * sizeof(variable_t));
+
+    expr_t* derivative = DifferentiateExpression(expr, expr->vars[var_id].variable_name, error);
+
+    if (error->code == (int) ExpressionErrors::NONE)
+    {
+        const expr_t* outputs[] = {expr, derivative};
+
+        IrKernelCtor(&ctx->kernel, outputs, 2, error);
+    }
+
+    if (derivative != nullptr)
+    {
+        ExpressionDtor(derivative);
+        free(derivative);
+    }
+
+    return (ExpressionErrors) error->code;
+}
+
+//------------------------------------------------------------------
+
+static void LutContextDtor(LutContext* ctx)
+{
+    assert(ctx);
+
+    IrKernelDtor(&ctx->kernel);
+
+    free(ctx->vars);
+    free(ctx->depths);
+    free(ctx->positions);
+}
+
+//------------------------------------------------------------------
+
+// results get value and derivative
+static void CalculateFunction(LutContext* ctx, const double x, double* results, error_t* error)
+{
+    assert(ctx);
+    assert(results);
+    assert(error);
+
+    ctx->vars[ctx->var_id].value = x;
+    IrKernelCalculate(&ctx->kernel, ctx->vars, results, error);
+
+    if (error->code == (int) ExpressionErrors::NONE && (!isfinite(results[0]) || !isfinite(results[1])))
+    {
+        error->code = (int) ExpressionErrors::INVALID_EXPRESSION_FORMAT;
+        error->data = "LOOKUP TABLE RANGE";
+    }
+}
+
+//------------------------------------------------------------------
+
+// amt knots after ones already in table, they are not counted in knots_amt yet
+static double* ReserveKnots(lut_t* lut, LutContext* ctx, const size_t amt, error_t* error)
+{
+    assert(lut);
+    assert(ctx);
+    assert(error);
+
+    if (lut->knots_amt + amt > ctx->knots_capacity)
+    {
+        size_t capacity = ctx->knots_capacity * 2;
+        if (capacity < lut->knots_amt + amt)
+            capacity = lut->knots_amt + amt;
+
+        double* knots = (double*) realloc(lut->knots, 2 * capacity * sizeof(double));
+        if (knots == nullptr)
+        {
+            error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+            error->data = "LOOKUP TABLE KNOTS";
+            return nullptr;
+        }
+
+        lut->knots          = knots;
+        ctx->knots_capacity = capacity;
+    }
+
+    return lut->knots + 2 * lut->knots_amt;
+}
+
+//------------------------------------------------------------------
+
+// doubles intervals amount until tolerance is met; knots are left right after table's ones
+static bool FitSegment(lut_t* lut, LutContext* ctx, LutSegment* segment, const double left, const double right,
+                       const size_t max_intervals, double* max_error, error_t* error)
+{
+    assert(lut);
+    assert(ctx);
+    assert(segment);
+    assert(max_error);
+    assert(error);
+
+    segment->left       = left;
+    segment->first_knot = 0;
+
+    for (size_t intervals = 1; intervals <= max_intervals; intervals *= 2)
+    {
+        double* knots = ReserveKnots(lut, ctx, intervals + 1, error);
+        if (knots == nullptr)
+            return false;
+
+        double step = (right - left) / (double) intervals;
+
+        segment->inv_step  = (double) intervals / (right - left);
+        segment->intervals = intervals;
+
+        for (size_t i = 0; i <= intervals; i++)
+        {
+            double results[2] = {};
+
+            CalculateFunction(ctx, (i == intervals) ? right : left + step * (double) i, results, error);
+            if (error->code != (int) ExpressionErrors::NONE)
+                return false;
+
+            knots[2 * i]     = results[0];
+            knots[2 * i + 1] = results[1] * step;
+        }
+
+        *max_error = 0;
+
+        for (size_t i = 0; i < intervals; i++)
+        {
+            for (size_t point = 1; point <= LUT_CHECK_POINTS; point++)
+            {
+                double x          = left + step * ((double) i + (double) point / (LUT_CHECK_POINTS + 1));
+                double results[2] = {};
+
+                CalculateFunction(ctx, x, results, error);
+                if (error->code != (int) ExpressionErrors::NONE)
+                    return false;
+
+                double delta = fabs(CalculateLutSegment(knots, segment, x) - results[0]);
+                if (delta > *max_error)
+                    *max_error = delta;
+            }
+        }
+
+        if (*max_error <= ctx->tolerance)
+            return true;
+    }
+
+    return false;
+}
+
+//------------------------------------------------------------------
+
+// segment's knots are the ones FitSegment left after table's ones
+static void AddSegment(lut_t* lut, LutContext* ctx, LutSegment* segment, const double max_error,
+                       const int depth, const size_t position, error_t* error)
+{
+    assert(lut);
+    assert(ctx);
+    assert(segment);
+    assert(error);
+
+    if (lut->segments_amt == ctx->segments_capacity)
+    {
+        size_t capacity = (ctx->segments_capacity == 0) ? 4 : ctx->segments_capacity * 2;
+
+        LutSegment* segments  = (LutSegment*) realloc(lut->segments, capacity * sizeof(LutSegment));
+        if (segments != nullptr)
+            lut->segments = segments;
+
+        int* depths = (int*) realloc(ctx->depths, capacity * sizeof(int));
+        if (depths != nullptr)
+            ctx->depths = depths;
+
+        size_t* positions = (size_t*) realloc(ctx->positions, capacity * sizeof(size_t));
+        if (positions != nullptr)
+            ctx->positions = positions;
+
+        if (segments == nullptr || depths == nullptr || positions == nullptr)
+        {
+            error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+            error->data = "LOOKUP TABLE SEGMENTS";
+            return;
+        }
+
+        ctx->segments_capacity = capacity;
+    }
+
+    segment->first_knot = lut->knots_amt;
+
+    lut->knots_amt += segment->intervals + 1;
+
+    ctx->depths[lut->segments_amt]    = depth;
+    ctx->positions[lut->segments_amt] = position;
+    lut->segments[lut->segments_amt]  = *segment;
+    lut->segments_amt++;
+
+    if (max_error > lut->max_error)
+        lut->max_error = max_error;
+}
+
+//------------------------------------------------------------------
+
+// segment at depth d and position p is p-th of 2^d equal parts of domain
+static void BuildAdaptive(lut_t* lut, LutContext* ctx, const double left, const double right, const int depth,
+                          const size_t position, error_t* error)
+{
+    assert(lut);
+    assert(ctx);
+    assert(error);
+
+    LutSegment segment   = {};
+    double     max_error = 0;
+
+    bool met = FitSegment(lut, ctx, &segment, left, right, LUT_SEGMENT_INTERVALS, &max_error, error);
+    if (error->code != (int) ExpressionErrors::NONE)
+        return;
+
+    if (met || depth == LUT_MAX_DEPTH)
+    {
+        AddSegment(lut, ctx, &segment, max_error, depth, position, error);
+        return;
+    }
+
+    double middle = (left + right) / 2;
+
+    BuildAdaptive(lut, ctx, left, middle, depth + 1, 2 * position, error);
+    if (error->code == (int) ExpressionErrors::NONE)
+        BuildAdaptive(lut, ctx, middle, right, depth + 1, 2 * position + 1, error);
+}
+
+//------------------------------------------------------------------
+
+static void BuildCells(lut_t* lut, const LutContext* ctx, error_t* error)
+{
+    assert(lut);
+    assert(ctx);
+    assert(error);
+
+    int max_depth = 0;
+    for (size_t i = 0; i < lut->segments_amt; i++)
+    {
+        if (ctx->depths[i] > max_depth)
+            max_depth = ctx->depths[i];
+    }
+
+    lut->cells_amt = (size_t) 1 << max_depth;
+    lut->inv_cell  = (double) lut->cells_amt / (lut->right - lut->left);
+
+    lut->cells = (uint32_t*) calloc(lut->cells_amt, sizeof(uint32_t));
+    if (lut->cells == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "LOOKUP TABLE CELLS";
+        return;
+    }
+
+    for (size_t i = 0; i < lut->segments_amt; i++)
+    {
+        int    shift = max_depth - ctx->depths[i];
+        size_t first = ctx->positions[i] << shift;
+        size_t last  = (ctx->positions[i] + 1) << shift;
+
+        for (size_t cell = first; cell < last; cell++)
+            lut->cells[cell] = (uint32_t) i;
+    }
+}
+
+//------------------------------------------------------------------
+
+ExpressionErrors LutCtor(lut_t* lut, const expr_t* expr, const char* var, const double left, const double right,
+                         const double tolerance, const LutKind kind, error_t* error)
+{
+    assert(lut);
+    assert(expr);
+    assert(var);
+    assert(error);
+    assert(left < right);
+    assert(tolerance > 0);
+
+    *lut = {};
+
+    lut->left  = left;
+    lut->right = right;
+
+    int var_id = FindVariableAmongSaved(expr->vars, var);
+    if (var_id == NO_VARIABLE)
+    {
+        error->code = (int) ExpressionErrors::NO_DIFF_VARIABLE;
+        error->data = var;
+        return ExpressionErrors::NO_DIFF_VARIABLE;
+    }
+
+    LutContext ctx = {};
+
+    if (LutContextCtor(&ctx, expr, var_id, tolerance, error) == ExpressionErrors::NONE)
+    {
+        if (kind == LutKind::UNIFORM)
+        {
+            LutSegment segment   = {};
+            double     max_error = 0;
+
+            FitSegment(lut, &ctx, &segment, left, right, LUT_MAX_INTERVALS, &max_error, error);
+            if (error->code == (int) ExpressionErrors::NONE)
+                AddSegment(lut, &ctx, &segment, max_error, 0, 0, error);
+        }
+        else
+            BuildAdaptive(lut, &ctx, left, right, 0, 0, error);
+    }
+
+    if (error->code == (int) ExpressionErrors::NONE)
+        BuildCells(lut, &ctx, error);
+
+    LutContextDtor(&ctx);
+
+    if (error->code != (int) ExpressionErrors::NONE)
+        LutDtor(lut);
+
+    return (ExpressionErrors) error->code;
+}
+
+//------------------------------------------------------------------
+
+void LutDtor(lut_t* lut)
+{
+    assert(lut);
+
+    free(lut->cells);
+    free(lut->segments);
+    free(lut->knots);
+
+    *lut = {};
+}
+
+//------------------------------------------------------------------
+
+void LutSave(const lut_t* lut, const char* name, error_t* error)
+{
+    assert(lut);
+    assert(name);
+    assert(error);
+
+    FILE* fp = fopen(name, "wb");
+    if (fp == nullptr)
+    {
+        error->code = (int) ERRORS::OPEN_FILE;
+        error->data = name;
+        return;
+    }
+
+    LutHeader header = {};
+
+    memcpy(header.magic, LUT_MAGIC, sizeof(LUT_MAGIC));
+    header.version      = LUT_VERSION;
+    header.cells_amt    = lut->cells_amt;
+    header.segments_amt = lut->segments_amt;
+    header.knots_amt    = lut->knots_amt;
+    header.left         = lut->left;
+    header.right        = lut->right;
+    header.max_error    = lut->max_error;
+
+    bool written = fwrite(&header, sizeof(LutHeader), 1, fp) == 1 &&
+                   fwrite(lut->segments, sizeof(LutSegment), lut->segments_amt, fp) == lut->segments_amt &&
+                   fwrite(lut->knots, 2 * sizeof(double), lut->knots_amt, fp) == lut->knots_amt &&
+                   fwrite(lut->cells, sizeof(uint32_t), lut->cells_amt, fp) == lut->cells_amt;
+
+    if (fclose(fp) != 0 || !written)
+    {
+        error->code = (int) ERRORS::PRINT_DATA;
+        error->data = name;
+    }
+}
+
+//------------------------------------------------------------------
+
+static bool CheckLutLayout(const lut_t* lut)
+{
+    assert(lut);
+
+    if (!(lut->left < lut->right) || !isfinite(lut->right - lut->left))
+        return false;
+
+    for (size_t i = 0; i < lut->segments_amt; i++)
+    {
+        const LutSegment* segment = &lut->segments[i];
+
+        if (segment->intervals == 0 || segment->first_knot > lut->knots_amt ||
+            lut->knots_amt - segment->first_knot <= segment->intervals)
+            return false;
+    }
+
+    for (size_t i = 0; i < lut->cells_amt; i++)
+    {
+        if (lut->cells[i] >= lut->segments_amt)
+            return false;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------
+
+void LutLoad(lut_t* lut, const char* name, error_t* error)
+{
+    assert(lut);
+    assert(name);
+    assert(error);
+
+    *lut = {};
+
+    FILE* fp = fopen(name, "rb");
+    if (fp == nullptr)
+    {
+        error->code = (int) ERRORS::OPEN_FILE;
+        error->data = name;
+        return;
+    }
+
+    LutHeader header = {};
+    long      size   = -1;
+
+    if (fseek(fp, 0, SEEK_END) == 0)
+        size = ftell(fp);
+
+    bool read = size >= (long) sizeof(LutHeader) && fseek(fp, 0, SEEK_SET) == 0 &&
+                fread(&header, sizeof(LutHeader), 1, fp) == 1 &&
+                memcmp(header.magic, LUT_MAGIC, sizeof(LUT_MAGIC)) == 0 && header.version == LUT_VERSION &&
+                header.cells_amt > 0 && header.segments_amt > 0 && header.knots_amt > 0;
+
+    // amounts are compared with file size by division, so huge ones do not overflow
+    if (read)
+    {
+        size_t rest = (size_t) size - sizeof(LutHeader);
+
+        read = header.segments_amt <= rest / sizeof(LutSegment);
+        if (read)
+        {
+            rest -= header.segments_amt * sizeof(LutSegment);
+            read  = header.knots_amt <= rest / (2 * sizeof(double));
+        }
+        if (read)
+        {
+            rest -= header.knots_amt * 2 * sizeof(double);
+            read  = header.cells_amt <= rest / sizeof(uint32_t);
+        }
+    }
+
+    if (read)
+    {
+        lut->left         = header.left;
+        lut->right        = header.right;
+        lut->max_error    = header.max_error;
+        lut->cells_amt    = header.cells_amt;
+        lut->segments_amt = header.segments_amt;
+        lut->knots_amt    = header.knots_amt;
+        lut->inv_cell     = (double) lut->cells_amt / (lut->right - lut->left);
+
+        lut->cells    = (uint32_t*)   calloc(lut->cells_amt, sizeof(uint32_t));
+        lut->segments = (LutSegment*) calloc(lut->segments_amt, sizeof(LutSegment));
+        lut->knots    = (double*)     calloc(2 * lut->knots_amt, sizeof(double));
+
+        if (lut->cells == nullptr || lut->segments == nullptr || lut->knots == nullptr)
+        {
+            fclose(fp);
+            LutDtor(lut);
+
+            error->code = (int) ERRORS::ALLOCATE_MEMORY;
+            error->data = name;
+            return;
+        }
+
+        read = fread(lut->segments, sizeof(LutSegment), lut->segments_amt, fp) == lut->segments_amt &&
+               fread(lut->knots, 2 * sizeof(double), lut->knots_amt, fp) == lut->knots_amt &&
+               fread(lut->cells, sizeof(uint32_t), lut->cells_amt, fp) == lut->cells_amt &&
+               CheckLutLayout(lut);
+    }
+
+    fclose(fp);
+
+    if (!read)
+    {
+        LutDtor(lut);
+
+        error->code = (int) ERRORS::READ_FILE;
+        error->data = name;
+    }
+}
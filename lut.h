@@ -0,0 +1,99 @@
+#ifndef __LUT_H_
+#define __LUT_H_
+
+#include <stdint.h>
+
+#include "expression/expression.h"
+
+// ======================================================================
+// LOOKUP TABLES
+// ======================================================================
+
+// expression of one variable (others keep their values) is replaced with cubic Hermite spline:
+// knots keep value and derivative from DifferentiateExpression. Table is made of segments
+// with uniform knots; uniform table is one segment, adaptive one halves domain where spline needs
+// more than LUT_SEGMENT_INTERVALS intervals. Segment of x is found by one more uniform array of cells,
+// so calculation has no search and no branches but clamping
+
+enum class LutKind
+{
+    UNIFORM,
+    ADAPTIVE,
+};
+
+static const size_t   LUT_MAX_INTERVALS       = 1 << 22;   // of uniform table
+static const size_t   LUT_SEGMENT_INTERVALS   = 64;        // adaptive table splits above it
+static const int      LUT_MAX_DEPTH           = 12;
+static const size_t   LUT_CHECK_POINTS        = 3;         // inside every interval
+
+static const char     LUT_MAGIC[8]            = {'D', 'I', 'F', 'F', 'L', 'U', 'T', '\0'};
+static const uint32_t LUT_VERSION             = 1;
+
+struct LutSegment
+{
+    double      left;
+    double      inv_step;
+    uint64_t    first_knot;
+    uint64_t    intervals;
+};
+
+struct Lut
+{
+    double      left;
+    double      right;
+    double      inv_cell;
+
+    uint32_t*   cells;              // segment of every cell
+    size_t      cells_amt;
+
+    LutSegment* segments;
+    size_t      segments_amt;
+
+    double*     knots;              // value and derivative * step for every knot
+    size_t      knots_amt;          // pairs of doubles
+
+    double      max_error;          // on check points, exceeds tolerance only at size limits
+};
+typedef struct Lut lut_t;
+
+// function and its derivative must be finite on [left, right], otherwise INVALID_EXPRESSION_FORMAT
+ExpressionErrors    LutCtor(lut_t* lut, const expr_t* expr, const char* var, const double left, const double right,
+                            const double tolerance, const LutKind kind, error_t* error);
+void                LutDtor(lut_t* lut);
+
+// file errors are reported with ERRORS codes, data is file name
+void                LutSave(const lut_t* lut, const char* name, error_t* error);
+void                LutLoad(lut_t* lut, const char* name, error_t* error);
+
+// knot is value and derivative * step, then the same for next knot; t is position between them
+static inline double CalculateHermite(const double* knot, const double t)
+{
+    double delta = knot[2] - knot[0];
+    double c2    = 3 * delta - 2 * knot[1] - knot[3];
+    double c3    = knot[1] + knot[3] - 2 * delta;
+
+    return knot[0] + t * (knot[1] + t * (c2 + t * c3));
+}
+
+static inline double CalculateLutSegment(const double* knots, const LutSegment* segment, const double x)
+{
+    double pos      = (x - segment->left) * segment->inv_step;
+    size_t interval = (pos <= 0) ? 0 : (size_t) (int64_t) pos;
+    if (interval >= segment->intervals)
+        interval = segment->intervals - 1;
+
+    return CalculateHermite(knots + 2 * (segment->first_knot + interval), pos - (double) interval);
+}
+
+// x out of domain is extrapolated by outer interval
+static inline double CalculateLut(const lut_t* lut, const double x)
+{
+    double cell_pos = (x - lut->left) * lut->inv_cell;
+    size_t cell     = (cell_pos <= 0) ? 0 : (size_t) (int64_t) cell_pos;
+    if (cell >= lut->cells_amt)
+        cell = lut->cells_amt - 1;
+
+    return CalculateLutSegment(lut->knots, &lut->segments[lut->cells[cell]], x);
+}
+
+#endif
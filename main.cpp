@@ -1,4 +1,7 @@
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "common/logs.h"
@@ -10,14 +13,32 @@
 #include "expression/expr_input.h"
 #include "calculation.h"
 #include "tex.h"
+#include "csv_stream.h"
+#include "columns.h"
+#include "shards.h"
 
 void UnrealTangent(const int argc, const char* argv[], FILE* out_stream, error_t* error);
 void EasyX3Differentiation(const int argc, const char* argv[], FILE* out_stream, error_t* error);
 void UnrealTaylor(const int argc, const char* argv[], FILE* out_stream, error_t* error);
+void CompareScalarTypes(expr_t* expr, FILE* out_stream, error_t* error);
+// file errors go to file_error with ERRORS codes, calculation errors go to error
+void StreamCsvFiles(const int argc, const char* argv[], const expr_t* expr, error_t* file_error, error_t* error);
+// tier is used by one process, sharded workers use system library
+void CalculateColumnsFiles(const int argc, const char* argv[], const int first_arg, const long workers_amt,
+                           const MathTier tier, const expr_t* expr, error_t* file_error, error_t* error);
+
+static const char* CSV_MODE_FLAG     = "--csv";
+static const char* COLUMNS_MODE_FLAG = "--columns";
+static const char* FAST_COLUMNS_FLAG = "--fast-columns";
+static const char* SHARDED_MODE_FLAG = "--sharded";
+static const char* COMPARE_TYPES_FLAG = "--compare-types";
+
+static const long  NO_WORKERS        = -1;
 
 int main(const int argc, const char* argv[])
 {
     OpenLogFile(argv[0]);
+    atexit(ReleaseNodePool);
 
     error_t error = {};
 
@@ -45,6 +66,50 @@ int main(const int argc, const char* argv[])
     PrintInfixExpression(stdout, &expr);
     DUMP_EXPRESSION(&expr);
 
+    error_t calc_error = {};
+
+    // diff OUTPUT INPUT --csv ROWS_FILE RESULTS_FILE [DIFF_VAR...]
+    if (argc > 3 && !strcmp(argv[3], CSV_MODE_FLAG))
+    {
+        StreamCsvFiles(argc, argv, &expr, &error, &calc_error);
+        EXIT_IF_ERROR(&error);
+        EXIT_IF_EXPRESSION_ERROR(&calc_error);
+    }
+
+    // diff OUTPUT INPUT --columns ROWS_FILE RESULTS_FILE [DIFF_VAR...]
+    if (argc > 3 && !strcmp(argv[3], COLUMNS_MODE_FLAG))
+    {
+        CalculateColumnsFiles(argc, argv, 4, NO_WORKERS, MathTier::LIBM, &expr, &error, &calc_error);
+        EXIT_IF_ERROR(&error);
+        EXIT_IF_EXPRESSION_ERROR(&calc_error);
+    }
+
+    // diff OUTPUT INPUT --fast-columns ROWS_FILE RESULTS_FILE [DIFF_VAR...], relative error about 1e-7
+    if (argc > 3 && !strcmp(argv[3], FAST_COLUMNS_FLAG))
+    {
+        CalculateColumnsFiles(argc, argv, 4, NO_WORKERS, MathTier::FAST, &expr, &error, &calc_error);
+        EXIT_IF_ERROR(&error);
+        EXIT_IF_EXPRESSION_ERROR(&calc_error);
+    }
+
+    // diff OUTPUT INPUT --sharded WORKERS_AMT ROWS_FILE RESULTS_FILE [DIFF_VAR...], 0 workers is one per core
+    if (argc > 4 && !strcmp(argv[3], SHARDED_MODE_FLAG))
+    {
+        long workers_amt = strtol(argv[4], nullptr, 10);
+
+        CalculateColumnsFiles(argc, argv, 5, (workers_amt > 0) ? workers_amt : 0, MathTier::LIBM, &expr,
+                              &error, &calc_error);
+        EXIT_IF_ERROR(&error);
+        EXIT_IF_EXPRESSION_ERROR(&calc_error);
+    }
+
+    // diff OUTPUT INPUT --compare-types, all variables go along the same grid
+    if (argc > 3 && !strcmp(argv[3], COMPARE_TYPES_FLAG))
+    {
+        CompareScalarTypes(&expr, out_stream, &calc_error);
+        EXIT_IF_EXPRESSION_ERROR(&calc_error);
+    }
+
     /*UnrealTangent(argc, argv, out_stream, &error);
 
     UnrealTaylor(argc, argv, out_stream, &error);
@@ -153,3 +218,170 @@ void EasyX3Differentiation(const int argc, const char* argv[], FILE* out_stream,
     ExpressionDtor(ddd_expr);
     fclose(fp);
 }
+
+//------------------------------------------------------------------
+
+static const int    BENCHMARK_POINTS_AMT = 100000;
+static const double BENCHMARK_LEFT       = 0.1;
+static const double BENCHMARK_RIGHT      = 2.1;
+
+void CompareScalarTypes(expr_t* expr, FILE* out_stream, error_t* error)
+{
+    PrintSection(out_stream, "Comparing float, double and long double");
+
+    static const char* type_names[] = {"float", "double", "long double"};
+    static const ScalarType types[] = {ScalarType::FLOAT, ScalarType::DOUBLE, ScalarType::LONG_DOUBLE};
+
+    long double* reference = (long double*) calloc(BENCHMARK_POINTS_AMT, sizeof(long double));
+    if (reference == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "BENCHMARK REFERENCE";
+        return;
+    }
+
+    // long double results are the reference
+    for (int type = (int) (sizeof(types) / sizeof(types[0])) - 1; type >= 0; type--)
+    {
+        double  max_rel_error = 0;
+        clock_t start         = clock();
+
+        for (int i = 0; i < BENCHMARK_POINTS_AMT && error->code == (int) ExpressionErrors::NONE; i++)
+        {
+            double x = BENCHMARK_LEFT + (BENCHMARK_RIGHT - BENCHMARK_LEFT) * i / BENCHMARK_POINTS_AMT;
+
+            for (size_t var = 0; var < expr->max_vars_amt; var++)
+                expr->vars[var].value = x;
+
+            long double result = CalculateExpression(expr, expr->vars, types[type], error);
+
+            if (types[type] == ScalarType::LONG_DOUBLE)
+                reference[i] = result;
+            else if (isfinite((double) reference[i]) && fabsl(reference[i]) > 0)
+                max_rel_error = fmax(max_rel_error, (double) fabsl((result - reference[i]) / reference[i]));
+        }
+
+        if (error->code != (int) ExpressionErrors::NONE)
+            break;
+
+        double ns_per_eval = 1e9 * (double) (clock() - start) / CLOCKS_PER_SEC / BENCHMARK_POINTS_AMT;
+
+        printf("%-12s %8.1lf ns/eval, max relative error %lg\n", type_names[type], ns_per_eval, max_rel_error);
+    }
+
+    free(reference);
+}
+
+
+//------------------------------------------------------------------
+
+static const int CSV_FIRST_DIFF_VAR_ARG = 6;
+
+void StreamCsvFiles(const int argc, const char* argv[], const expr_t* expr, error_t* file_error, error_t* error)
+{
+    const char* rows_file = GetFileName(argc, argv, 4, "CSV ROWS", file_error);
+    BREAK_IF_ERROR(file_error);
+    const char* results_file = GetFileName(argc, argv, 5, "CSV RESULTS", file_error);
+    BREAK_IF_ERROR(file_error);
+
+    FILE* in = OpenInputFile(rows_file, file_error);
+    BREAK_IF_ERROR(file_error);
+    FILE* out = OpenOutputFile(results_file, file_error);
+    if (file_error->code != (int) ERRORS::NONE)
+    {
+        fclose(in);
+        return;
+    }
+
+    const char* const* diff_vars = argv + CSV_FIRST_DIFF_VAR_ARG;
+    size_t             diff_amt  = (argc > CSV_FIRST_DIFF_VAR_ARG) ? (size_t) (argc - CSV_FIRST_DIFF_VAR_ARG) : 0;
+
+    StreamCsv(expr, diff_vars, diff_amt, in, out, error);
+
+    fclose(in);
+    fclose(out);
+}
+
+//------------------------------------------------------------------
+
+void CalculateColumnsFiles(const int argc, const char* argv[], const int first_arg, const long workers_amt,
+                           const MathTier tier, const expr_t* expr, error_t* file_error, error_t* error)
+{
+    const char* rows_file = GetFileName(argc, argv, first_arg, "COLUMNS ROWS", file_error);
+    BREAK_IF_ERROR(file_error);
+    const char* results_file = GetFileName(argc, argv, first_arg + 1, "COLUMNS RESULTS", file_error);
+    BREAK_IF_ERROR(file_error);
+
+    columns_file_t in = {};
+    ColumnsFileOpen(&in, rows_file, file_error);
+    BREAK_IF_ERROR(file_error);
+
+    const char* const* diff_vars = argv + first_arg + 2;
+    size_t             diff_amt  = (argc > first_arg + 2) ? (size_t) (argc - first_arg - 2) : 0;
+
+    // results are float32 only if every used input is float32
+    ColumnType type = ColumnType::FLOAT64;
+
+    for (size_t i = 0; i < expr->max_vars_amt; i++)
+    {
+        if (expr->vars[i].isfree)
+            continue;
+
+        int column = FindColumn(&in, expr->vars[i].variable_name);
+        if (column == NO_COLUMN)
+            continue;
+
+        if (in.columns[column].type != ColumnType::FLOAT32)
+        {
+            type = ColumnType::FLOAT64;
+            break;
+        }
+
+        type = ColumnType::FLOAT32;
+    }
+
+    const char** names = (const char**) calloc(diff_amt + 1, sizeof(char*));
+    char*        texts = (char*)        calloc(diff_amt + 1, MAX_COLUMN_NAME_LEN);
+    ColumnType*  types = (ColumnType*)  calloc(diff_amt + 1, sizeof(ColumnType));
+    if (names == nullptr || texts == nullptr || types == nullptr)
+    {
+        free(names);
+        free(texts);
+        free(types);
+        ColumnsFileClose(&in);
+
+        file_error->code = (int) ERRORS::ALLOCATE_MEMORY;
+        return;
+    }
+
+    for (size_t i = 0; i <= diff_amt; i++)
+    {
+        char* name = texts + i * MAX_COLUMN_NAME_LEN;
+
+        if (i == 0)
+            snprintf(name, MAX_COLUMN_NAME_LEN, "f");
+        else
+            snprintf(name, MAX_COLUMN_NAME_LEN, "df/d%s", diff_vars[i - 1]);
+
+        names[i] = name;
+        types[i] = type;
+    }
+
+    columns_file_t out = {};
+    ColumnsFileCreate(&out, results_file, names, types, diff_amt + 1, in.header->rows_amt, file_error);
+
+    if (file_error->code == (int) ERRORS::NONE)
+    {
+        if (workers_amt == NO_WORKERS)
+            CalculateExpressionColumns(expr, diff_vars, diff_amt, &in, &out, tier, error);
+        else
+            CalculateExpressionSharded(expr, diff_vars, diff_amt, &in, &out, (size_t) workers_amt, error);
+
+        ColumnsFileClose(&out);
+    }
+
+    free(names);
+    free(texts);
+    free(types);
+    ColumnsFileClose(&in);
+}
@@ -0,0 +1,1123 @@
+#include <assert.h>
+
+#include "math_tiers.h"
+#include "calculation.h"
+#include "columns.h"
+
+// ports of fdlibm (Sun Microsystems, freely distributable) with the same constants,
+// words of double are taken through memcpy instead of pointer casts
+
+static double   ReduceHalfPi(const double x, double* y0, double* y1);
+static double   KernelSin(const double x, const double y, const bool has_tail);
+static double   KernelCos(const double x, const double y);
+static double   KernelTan(double x, double y, const int iy);
+static double   ScaleByPowerOfTwo(const double x, const int n);
+
+static double   CalculateTierSubtree(const variable_t* vars, const Node* node, const MathTier tier, error_t* error);
+static bool     IsFastTrigOperation(const Operators operation);
+
+
+// exact compares with special values are the point of these algorithms
+#pragma GCC diagnostic ignored "-Wfloat-equal"
+
+// ======================================================================
+// EXP AND LOG
+// ======================================================================
+
+static const double LN2_HI          = 6.93147180369123816490e-01;
+static const double LN2_LO          = 1.90821492927058770002e-10;
+static const double INV_LN2         = 1.44269504088896338700e+00;
+
+static const double EXP_P1          = 1.66666666666666019037e-01;
+static const double EXP_P2          = -2.77777777770155933842e-03;
+static const double EXP_P3          = 6.61375632143793436117e-05;
+static const double EXP_P4          = -1.65339022054652515390e-06;
+static const double EXP_P5          = 4.13813679705723846039e-08;
+
+static const double EXP_OVERFLOW    = 7.09782712893383973096e+02;
+static const double EXP_UNDERFLOW   = -7.45133219101941108420e+02;
+
+static const double LOG_LG1         = 6.666666666666735130e-01;
+static const double LOG_LG2         = 3.999999999940941908e-01;
+static const double LOG_LG3         = 2.857142874366239149e-01;
+static const double LOG_LG4         = 2.222219843214978396e-01;
+static const double LOG_LG5         = 1.818357216161805012e-01;
+static const double LOG_LG6         = 1.531383769920937332e-01;
+static const double LOG_LG7         = 1.479819860511658591e-01;
+
+static const double TWO_54          = 1.80143985094819840000e+16;
+
+//------------------------------------------------------------------
+
+static double ScaleByPowerOfTwo(const double x, const int n)
+{
+    // exponent of normal result is patched directly, rest is done by library with single rounding
+    int32_t high     = HighWord(x);
+    int     exponent = ((high >> 20) & 0x7ff) + n;
+
+    if (exponent > 0 && exponent < 0x7ff && ((high >> 20) & 0x7ff) != 0)
+        return WordsToDouble((int32_t) (((uint32_t) high & 0x800fffff) | ((uint32_t) exponent << 20)), LowWord(x));
+
+    return ldexp(x, n);
+}
+
+//------------------------------------------------------------------
+
+double StrictExp(const double x)
+{
+    if (isnan(x))               return x + x;
+    if (x > EXP_OVERFLOW)       return INFINITY;
+    if (x < EXP_UNDERFLOW)      return 0;
+
+    double  hi = x;
+    double  lo = 0;
+    int     k  = 0;
+
+    double  ax = fabs(x);
+
+    if (ax > 0.5 * LN2_HI)
+    {
+        k  = (int) (INV_LN2 * x + ((x < 0) ? -0.5 : 0.5));
+        hi = x - k * LN2_HI;
+        lo = k * LN2_LO;
+    }
+    else if (ax < 0x1p-28)
+        return 1 + x;
+
+    // x = k ln2 + r, exp(r) = 1 + r + r c / (2 - c)
+    double r = hi - lo;
+    double t = r * r;
+    double c = r - t * (EXP_P1 + t * (EXP_P2 + t * (EXP_P3 + t * (EXP_P4 + t * EXP_P5))));
+
+    if (k == 0)
+        return 1 - ((r * c) / (c - 2.0) - r);
+
+    double y = 1 - ((lo - (r * c) / (2.0 - c)) - hi);
+
+    return ScaleByPowerOfTwo(y, k);
+}
+
+//------------------------------------------------------------------
+
+double StrictLog(const double x)
+{
+    int32_t  hx = HighWord(x);
+    uint32_t lx = LowWord(x);
+    int      k  = 0;
+
+    double   arg = x;
+
+    if (hx < 0x00100000)
+    {
+        if (((hx & 0x7fffffff) | (int32_t) lx) == 0)
+            return -INFINITY;
+        if (hx < 0)
+            return NAN;
+
+        // subnormal
+        k  -= 54;
+        arg *= TWO_54;
+        hx  = HighWord(arg);
+    }
+
+    if (hx >= 0x7ff00000)
+        return arg + arg;
+
+    k  += (hx >> 20) - 1023;
+    hx &= 0x000fffff;
+
+    // normalize arg or arg/2 into [sqrt(2)/2, sqrt(2))
+    int32_t i = (hx + 0x95f64) & 0x100000;
+    arg       = WordsToDouble(hx | (i ^ 0x3ff00000), LowWord(arg));
+    k        += (i >> 20);
+
+    double f  = arg - 1.0;
+    double dk = (double) k;
+
+    // |f| < 2^-20
+    if ((0x000fffff & (2 + hx)) < 3)
+    {
+        if (f == 0)
+            return (k == 0) ? 0 : dk * LN2_HI + dk * LN2_LO;
+
+        double r = f * f * (0.5 - 0.33333333333333333 * f);
+
+        return (k == 0) ? f - r : dk * LN2_HI - ((r - dk * LN2_LO) - f);
+    }
+
+    double s  = f / (2.0 + f);
+    double z  = s * s;
+    double w  = z * z;
+
+    int32_t j = 0x6b851 - hx;
+    i         = hx - 0x6147a;
+
+    double t1 = w * (LOG_LG2 + w * (LOG_LG4 + w * LOG_LG6));
+    double t2 = z * (LOG_LG1 + w * (LOG_LG3 + w * (LOG_LG5 + w * LOG_LG7)));
+    double r  = t2 + t1;
+
+    i |= j;
+
+    if (i > 0)
+    {
+        double hfsq = 0.5 * f * f;
+
+        if (k == 0)
+            return f - (hfsq - s * (hfsq + r));
+
+        return dk * LN2_HI - ((hfsq - (s * (hfsq + r) + dk * LN2_LO)) - f);
+    }
+
+    if (k == 0)
+        return f - s * (f - r);
+
+    return dk * LN2_HI - ((s * (f - r) - dk * LN2_LO) - f);
+}
+
+// ======================================================================
+// POW
+// ======================================================================
+
+static const double POW_BP[]        = {1.0, 1.5};
+static const double POW_DP_H[]      = {0.0, 5.84962487220764160156e-01};
+static const double POW_DP_L[]      = {0.0, 1.35003920212974897128e-08};
+
+static const double POW_L1          = 5.99999999999994648725e-01;
+static const double POW_L2          = 4.28571428578550184252e-01;
+static const double POW_L3          = 3.33333329818377432918e-01;
+static const double POW_L4          = 2.72728123808534006489e-01;
+static const double POW_L5          = 2.30660745775561754067e-01;
+static const double POW_L6          = 2.06975017800338417784e-01;
+
+static const double POW_LG2         = 6.93147180559945286227e-01;
+static const double POW_LG2_H       = 6.93147182464599609375e-01;
+static const double POW_LG2_L       = -1.90465429995776804525e-09;
+static const double POW_OVT         = 8.0085662595372944372e-17;
+
+static const double POW_CP          = 9.61796693925975554329e-01;
+static const double POW_CP_H        = 9.61796700954437255859e-01;
+static const double POW_CP_L        = -7.02846165095275826516e-09;
+
+static const double POW_IVLN2       = 1.44269504088896338700e+00;
+static const double POW_IVLN2_H     = 1.44269502162933349609e+00;
+static const double POW_IVLN2_L     = 1.92596299112661746887e-08;
+
+static const double TWO_53          = 9007199254740992.0;
+
+//------------------------------------------------------------------
+
+double StrictPow(const double x, const double y)
+{
+    int32_t  hx = HighWord(x);
+    uint32_t lx = LowWord(x);
+    int32_t  hy = HighWord(y);
+    uint32_t ly = LowWord(y);
+
+    int32_t  ix = hx & 0x7fffffff;
+    int32_t  iy = hy & 0x7fffffff;
+
+    // x^0 = 1 and 1^y = 1 even for NaN
+    if ((iy | (int32_t) ly) == 0 || x == 1)
+        return 1;
+
+    if (isnan(x) || isnan(y))
+        return x + y;
+
+    // y_is_int: 0 - not an integer, 1 - odd, 2 - even; matters only for negative x
+    int y_is_int = 0;
+
+    if (hx < 0)
+    {
+        if (iy >= 0x43400000)
+            y_is_int = 2;
+        else if (iy >= 0x3ff00000)
+        {
+            int exponent = (iy >> 20) - 0x3ff;
+
+            if (exponent > 20)
+            {
+                uint32_t j = ly >> (52 - exponent);
+                if ((j << (52 - exponent)) == ly)
+                    y_is_int = 2 - (int) (j & 1);
+            }
+            else if (ly == 0)
+            {
+                int32_t j = iy >> (20 - exponent);
+                if ((j << (20 - exponent)) == iy)
+                    y_is_int = 2 - (j & 1);
+            }
+        }
+    }
+
+    // special y
+    if (ly == 0)
+    {
+        if (iy == 0x7ff00000)
+        {
+            if (((ix - 0x3ff00000) | (int32_t) lx) == 0)
+                return 1;                                               // (-1)^inf
+            else if (ix >= 0x3ff00000)
+                return (hy >= 0) ? y : 0;
+            else
+                return (hy < 0) ? -y : 0;
+        }
+
+        if (iy == 0x3ff00000)
+            return (hy < 0) ? 1 / x : x;
+
+        if (hy == 0x40000000)
+            return x * x;
+
+        if (hy == 0x3fe00000 && hx >= 0)
+            return sqrt(x);
+    }
+
+    double ax = fabs(x);
+
+    // special x: +-0, +-inf, +-1
+    if (lx == 0 && (ix == 0x7ff00000 || ix == 0 || ix == 0x3ff00000))
+    {
+        double z = ax;
+
+        if (hy < 0)
+            z = 1 / z;
+
+        if (hx < 0)
+        {
+            if (((ix - 0x3ff00000) | y_is_int) == 0)
+                z = NAN;
+            else if (y_is_int == 1)
+                z = -z;
+        }
+
+        return z;
+    }
+
+    // negative x: NaN for non integer y, sign of result for odd y
+    if (hx < 0 && y_is_int == 0)
+        return NAN;
+
+    double sign = (hx < 0 && y_is_int == 1) ? -1 : 1;
+
+    double t1 = 0;
+    double t2 = 0;
+
+    if (iy > 0x41e00000)
+    {
+        // |y| > 2^31
+        if (iy > 0x43f00000)
+        {
+            if (ix <= 0x3fefffff) return (hy < 0) ? INFINITY : 0;
+            if (ix >= 0x3ff00000) return (hy > 0) ? INFINITY : 0;
+        }
+
+        if (ix < 0x3fefffff) return (hy < 0) ? sign * INFINITY : sign * 0.0;
+        if (ix > 0x3ff00000) return (hy > 0) ? sign * INFINITY : sign * 0.0;
+
+        // |1 - x| <= 2^-20, log(x) = t - t^2/2 + t^3/3 - t^4/4
+        double t = ax - 1;
+        double w = (t * t) * (0.5 - t * (0.3333333333333333333333 - t * 0.25));
+        double u = POW_IVLN2_H * t;
+        double v = t * POW_IVLN2_L - w * POW_IVLN2;
+
+        t1 = WordsToDouble(HighWord(u + v), 0);
+        t2 = v - (t1 - u);
+    }
+    else
+    {
+        int n = 0;
+
+        if (ix < 0x00100000)
+        {
+            ax *= TWO_53;
+            n  -= 53;
+            ix  = HighWord(ax);
+        }
+
+        n += (ix >> 20) - 0x3ff;
+
+        int32_t j = ix & 0x000fffff;
+        int     k = 0;
+
+        // ax into [1, sqrt(2)) or [sqrt(2), 1.5 sqrt(2)), k selects expansion point
+        ix = j | 0x3ff00000;
+
+        if (j <= 0x3988E)
+            k = 0;
+        else if (j < 0xBB67A)
+            k = 1;
+        else
+        {
+            k   = 0;
+            n  += 1;
+            ix -= 0x00100000;
+        }
+
+        ax = WordsToDouble(ix, LowWord(ax));
+
+        // ss = s_h + s_l = (x - bp) / (x + bp)
+        double u   = ax - POW_BP[k];
+        double v   = 1 / (ax + POW_BP[k]);
+        double ss  = u * v;
+        double s_h = WordsToDouble(HighWord(ss), 0);
+
+        double t_h = WordsToDouble(((ix >> 1) | 0x20000000) + 0x00080000 + (k << 18), 0);
+        double t_l = ax - (t_h - POW_BP[k]);
+        double s_l = v * ((u - s_h * t_h) - s_h * t_l);
+
+        // log(ax)
+        double s2  = ss * ss;
+        double r   = s2 * s2 * (POW_L1 + s2 * (POW_L2 + s2 * (POW_L3 + s2 * (POW_L4 + s2 * (POW_L5 + s2 * POW_L6)))));
+        r         += s_l * (s_h + ss);
+        s2         = s_h * s_h;
+
+        t_h        = WordsToDouble(HighWord(3.0 + s2 + r), 0);
+        t_l        = r - ((t_h - 3.0) - s2);
+
+        u          = s_h * t_h;
+        v          = s_l * t_h + t_l * ss;
+
+        double p_h = WordsToDouble(HighWord(u + v), 0);
+        double p_l = v - (p_h - u);
+
+        double z_h = POW_CP_H * p_h;
+        double z_l = POW_CP_L * p_h + p_l * POW_CP + POW_DP_L[k];
+
+        // log2(ax) = n + dp_h + z_h + z_l = t1 + t2
+        double t   = (double) n;
+
+        t1 = WordsToDouble(HighWord(((z_h + z_l) + POW_DP_H[k]) + t), 0);
+        t2 = z_l - (((t1 - t) - POW_DP_H[k]) - z_h);
+    }
+
+    // y * log2(x) = p_h + p_l, y is split into y1 + y2
+    double y1  = WordsToDouble(hy, 0);
+    double p_l = (y - y1) * t1 + y * t2;
+    double p_h = y1 * t1;
+    double z   = p_l + p_h;
+
+    int32_t  j = HighWord(z);
+    uint32_t i = LowWord(z);
+
+    if (j >= 0x40900000)
+    {
+        // z >= 1024
+        if (((j - 0x40900000) | (int32_t) i) != 0 || p_l + POW_OVT > z - p_h)
+            return sign * INFINITY;
+    }
+    else if ((j & 0x7fffffff) >= 0x4090cc00)
+    {
+        // z <= -1075
+        if ((((uint32_t) j - 0xc090cc00) | i) != 0 || p_l <= z - p_h)
+            return sign * 0.0;
+    }
+
+    // 2^(p_h + p_l), p_h is reduced by its integer part n
+    int32_t abs_j = j & 0x7fffffff;
+    int     k     = (abs_j >> 20) - 0x3ff;
+    int     n     = 0;
+
+    if (abs_j > 0x3fe00000)
+    {
+        n = j + (0x00100000 >> (k + 1));
+        k = ((n & 0x7fffffff) >> 20) - 0x3ff;
+
+        double t = WordsToDouble(n & ~(0x000fffff >> k), 0);
+
+        n = ((n & 0x000fffff) | 0x00100000) >> (20 - k);
+        if (j < 0)
+            n = -n;
+
+        p_h -= t;
+    }
+
+    double t  = WordsToDouble(HighWord(p_l + p_h), 0);
+    double u  = t * POW_LG2_H;
+    double v  = (p_l - (t - p_h)) * POW_LG2 + t * POW_LG2_L;
+
+    z         = u + v;
+
+    double w  = v - (z - u);
+    t         = z * z;
+    t1        = z - t * (EXP_P1 + t * (EXP_P2 + t * (EXP_P3 + t * (EXP_P4 + t * EXP_P5))));
+
+    double r  = (z * t1) / (t1 - 2) - (w + z * w);
+    z         = 1 - (r - z);
+
+    return sign * ScaleByPowerOfTwo(z, n);
+}
+
+// ======================================================================
+// TRIGONOMETRY
+// ======================================================================
+
+static const double INV_PIO2        = 6.36619772367581382433e-01;
+static const double PIO2_1          = 1.57079632673412561417e+00;
+static const double PIO2_1T         = 6.07710050650619224932e-11;
+static const double PIO2_2          = 6.07710050630396597660e-11;
+static const double PIO2_2T         = 2.02226624879595063154e-21;
+static const double PIO2_3          = 2.02226624871116645580e-21;
+static const double PIO2_3T         = 8.47842766036889956997e-32;
+
+static const double ROUND_MAGIC     = 6755399441055744.0;
+
+static const double SIN_S1          = -1.66666666666666324348e-01;
+static const double SIN_S2          = 8.33333333332248946124e-03;
+static const double SIN_S3          = -1.98412698298579493134e-04;
+static const double SIN_S4          = 2.75573137070700676789e-06;
+static const double SIN_S5          = -2.50507602534068634195e-08;
+static const double SIN_S6          = 1.58969099521155010221e-10;
+
+static const double COS_C1          = 4.16666666666666019037e-02;
+static const double COS_C2          = -1.38888888888741095749e-03;
+static const double COS_C3          = 2.48015872894767294178e-05;
+static const double COS_C4          = -2.75573143513906633035e-07;
+static const double COS_C5          = 2.08757232129817482790e-09;
+static const double COS_C6          = -1.13596475577881948265e-11;
+
+static const double TAN_T[]         = { 3.33333333333334091986e-01,  1.33333333333201242699e-01,
+                                        5.39682539762260521377e-02,  2.18694882948595424599e-02,
+                                        8.86323982359930005737e-03,  3.59207910759131235356e-03,
+                                        1.45620945432529025516e-03,  5.88041240820264096874e-04,
+                                        2.46463134818469906812e-04,  7.81794442939557092300e-05,
+                                        7.14072491382608190305e-05, -1.85586374855275456654e-05,
+                                        2.59073051863633712884e-05 };
+static const double PIO4            = 7.85398163397448278999e-01;
+static const double PIO4_LO         = 3.06161699786838301793e-17;
+
+// |x| <= pi/4 for kernels, 2^20 * pi/2 for reduction
+static const int32_t PIO4_HIGH      = 0x3fe921fb;
+static const int32_t MEDIUM_HIGH    = 0x413921fb;
+
+//------------------------------------------------------------------
+
+// x - n pi/2 = y0 + y1 with pi/2 in up to three parts, returns n; only for |x| <= 2^20 pi/2
+static double ReduceHalfPi(const double x, double* y0, double* y1)
+{
+    double  fn = (x * INV_PIO2 + ROUND_MAGIC) - ROUND_MAGIC;
+
+    double  r  = x - fn * PIO2_1;
+    double  w  = fn * PIO2_1T;
+
+    *y0        = r - w;
+
+    int32_t j  = (HighWord(x) >> 20) & 0x7ff;
+    int32_t i  = j - ((HighWord(*y0) >> 20) & 0x7ff);
+
+    // cancellation: second and third parts of pi/2 are needed
+    if (i > 16)
+    {
+        double t = r;
+
+        w   = fn * PIO2_2;
+        r   = t - w;
+        w   = fn * PIO2_2T - ((t - r) - w);
+        *y0 = r - w;
+
+        i   = j - ((HighWord(*y0) >> 20) & 0x7ff);
+
+        if (i > 49)
+        {
+            t   = r;
+            w   = fn * PIO2_3;
+            r   = t - w;
+            w   = fn * PIO2_3T - ((t - r) - w);
+            *y0 = r - w;
+        }
+    }
+
+    *y1 = (r - *y0) - w;
+
+    return fn;
+}
+
+//------------------------------------------------------------------
+
+static double KernelSin(const double x, const double y, const bool has_tail)
+{
+    double z = x * x;
+    double v = z * x;
+    double r = SIN_S2 + z * (SIN_S3 + z * (SIN_S4 + z * (SIN_S5 + z * SIN_S6)));
+
+    if (!has_tail)
+        return x + v * (SIN_S1 + z * r);
+
+    return x - ((z * (0.5 * y - v * r) - y) - v * SIN_S1);
+}
+
+//------------------------------------------------------------------
+
+static double KernelCos(const double x, const double y)
+{
+    double z  = x * x;
+    double w  = z * z;
+    double r  = z * (COS_C1 + z * (COS_C2 + z * COS_C3)) + w * w * (COS_C4 + z * (COS_C5 + z * COS_C6));
+
+    double hz = 0.5 * z;
+    w         = 1.0 - hz;
+
+    return w + (((1.0 - w) - hz) + (z * r - x * y));
+}
+
+//------------------------------------------------------------------
+
+// tan(x + y) for iy = 1, -1 / tan(x + y) for iy = -1
+static double KernelTan(double x, double y, const int iy)
+{
+    int32_t hx = HighWord(x);
+    int32_t ix = hx & 0x7fffffff;
+
+    bool big = ix >= 0x3FE59428;
+
+    // |x| >= 0.6744: tan(x) = tan(pi/4 - (pi/4 - x))
+    if (big)
+    {
+        if (hx < 0)
+        {
+            x = -x;
+            y = -y;
+        }
+
+        double z = PIO4 - x;
+        double w = PIO4_LO - y;
+
+        x = z + w;
+        y = 0.0;
+    }
+
+    double z = x * x;
+    double w = z * z;
+
+    double r = TAN_T[1] + w * (TAN_T[3] + w * (TAN_T[5] + w * (TAN_T[7] + w * (TAN_T[9] + w * TAN_T[11]))));
+    double v = z * (TAN_T[2] + w * (TAN_T[4] + w * (TAN_T[6] + w * (TAN_T[8] + w * (TAN_T[10] + w * TAN_T[12])))));
+    double s = z * x;
+
+    r  = y + z * (s * (r + v) + y);
+    r += TAN_T[0] * s;
+    w  = x + r;
+
+    if (big)
+    {
+        v = (double) iy;
+        return (double) (1 - ((hx >> 30) & 2)) * (v - 2.0 * (x - (w * w / (w + v) - r)));
+    }
+
+    if (iy == 1)
+        return w;
+
+    // -1 / (x + r) with extra precision
+    z = WordsToDouble(HighWord(w), 0);
+    v = r - (z - x);
+
+    double a = -1.0 / w;
+    double t = WordsToDouble(HighWord(a), 0);
+    s        = 1.0 + t * z;
+
+    return t + a * (s + t * v);
+}
+
+//------------------------------------------------------------------
+
+double StrictSin(const double x)
+{
+    int32_t ix = HighWord(x) & 0x7fffffff;
+
+    if (ix <= PIO4_HIGH)        return KernelSin(x, 0, false);
+    if (ix >= 0x7ff00000)       return x - x;
+    if (ix > MEDIUM_HIGH)       return sin(x);
+
+    double y0 = 0;
+    double y1 = 0;
+    int    n  = (int) ReduceHalfPi(x, &y0, &y1);
+
+    switch (n & 3)
+    {
+        case 0:  return  KernelSin(y0, y1, true);
+        case 1:  return  KernelCos(y0, y1);
+        case 2:  return -KernelSin(y0, y1, true);
+        default: return -KernelCos(y0, y1);
+    }
+}
+
+//------------------------------------------------------------------
+
+double StrictCos(const double x)
+{
+    int32_t ix = HighWord(x) & 0x7fffffff;
+
+    if (ix <= PIO4_HIGH)        return KernelCos(x, 0);
+    if (ix >= 0x7ff00000)       return x - x;
+    if (ix > MEDIUM_HIGH)       return cos(x);
+
+    double y0 = 0;
+    double y1 = 0;
+    int    n  = (int) ReduceHalfPi(x, &y0, &y1);
+
+    switch (n & 3)
+    {
+        case 0:  return  KernelCos(y0, y1);
+        case 1:  return -KernelSin(y0, y1, true);
+        case 2:  return -KernelCos(y0, y1);
+        default: return  KernelSin(y0, y1, true);
+    }
+}
+
+//------------------------------------------------------------------
+
+double StrictTan(const double x)
+{
+    int32_t ix = HighWord(x) & 0x7fffffff;
+
+    if (ix <= PIO4_HIGH)        return KernelTan(x, 0, 1);
+    if (ix >= 0x7ff00000)       return x - x;
+    if (ix > MEDIUM_HIGH)       return tan(x);
+
+    double y0 = 0;
+    double y1 = 0;
+    int    n  = (int) ReduceHalfPi(x, &y0, &y1);
+
+    return KernelTan(y0, y1, 1 - ((n & 1) << 1));
+}
+
+// ======================================================================
+// INVERSE TRIGONOMETRY
+// ======================================================================
+
+static const double ATAN_HI[]       = { 4.63647609000806093515e-01, 7.85398163397448278999e-01,
+                                        9.82793723247329054082e-01, 1.57079632679489655800e+00 };
+static const double ATAN_LO[]       = { 2.26987774529616870924e-17, 3.06161699786838301793e-17,
+                                        1.39033110312309984516e-17, 6.12323399573676603587e-17 };
+static const double ATAN_T[]        = { 3.33333333333329318027e-01, -1.99999999998764832476e-01,
+                                        1.42857142725034663711e-01, -1.11111104054623557880e-01,
+                                        9.09088713343650656196e-02, -7.69187620504482999495e-02,
+                                        6.66107313738753120669e-02, -5.83357013379057348645e-02,
+                                        4.97687799461593236017e-02, -3.65315727442169155270e-02,
+                                        1.62858201153657823623e-02 };
+
+static const double PI              = 3.14159265358979311600e+00;
+static const double PIO2_HI         = 1.57079632679489655800e+00;
+static const double PIO2_LO         = 6.12323399573676603587e-17;
+static const double PIO4_HI         = 7.85398163397448278999e-01;
+
+static const double ASIN_P0         = 1.66666666666666657415e-01;
+static const double ASIN_P1         = -3.25565818622400915405e-01;
+static const double ASIN_P2         = 2.01212532134862925881e-01;
+static const double ASIN_P3         = -4.00555345006794114027e-02;
+static const double ASIN_P4         = 7.91534994289814532176e-04;
+static const double ASIN_P5         = 3.47933107596021167570e-05;
+static const double ASIN_Q1         = -2.40339491173441421878e+00;
+static const double ASIN_Q2         = 2.02094576023350569471e+00;
+static const double ASIN_Q3         = -6.88283971605453293030e-01;
+static const double ASIN_Q4         = 7.70381505559019352791e-02;
+
+//------------------------------------------------------------------
+
+double StrictAtan(const double x)
+{
+    int32_t hx = HighWord(x);
+    int32_t ix = hx & 0x7fffffff;
+
+    // |x| >= 2^66
+    if (ix >= 0x44100000)
+    {
+        if (isnan(x))
+            return x + x;
+
+        return (hx > 0) ? ATAN_HI[3] + ATAN_LO[3] : -ATAN_HI[3] - ATAN_LO[3];
+    }
+
+    int    id = -1;
+    double t  = x;
+
+    if (ix < 0x3fdc0000)
+    {
+        // |x| < 2^-27
+        if (ix < 0x3e400000)
+            return x;
+    }
+    else
+    {
+        t = fabs(x);
+
+        if (ix < 0x3ff30000)
+        {
+            if (ix < 0x3fe60000)
+            {
+                id = 0;
+                t  = (2.0 * t - 1.0) / (2.0 + t);
+            }
+            else
+            {
+                id = 1;
+                t  = (t - 1.0) / (t + 1.0);
+            }
+        }
+        else
+        {
+            if (ix < 0x40038000)
+            {
+                id = 2;
+                t  = (t - 1.5) / (1.0 + 1.5 * t);
+            }
+            else
+            {
+                id = 3;
+                t  = -1.0 / t;
+            }
+        }
+    }
+
+    double z  = t * t;
+    double w  = z * z;
+
+    double s1 = z * (ATAN_T[0] + w * (ATAN_T[2] + w * (ATAN_T[4] + w * (ATAN_T[6] + w * (ATAN_T[8] + w * ATAN_T[10])))));
+    double s2 = w * (ATAN_T[1] + w * (ATAN_T[3] + w * (ATAN_T[5] + w * (ATAN_T[7] + w * ATAN_T[9]))));
+
+    if (id < 0)
+        return t - t * (s1 + s2);
+
+    z = ATAN_HI[id] - ((t * (s1 + s2) - ATAN_LO[id]) - t);
+
+    return (hx < 0) ? -z : z;
+}
+
+//------------------------------------------------------------------
+
+static inline double AsinRational(const double t)
+{
+    double p = t * (ASIN_P0 + t * (ASIN_P1 + t * (ASIN_P2 + t * (ASIN_P3 + t * (ASIN_P4 + t * ASIN_P5)))));
+    double q = 1.0 + t * (ASIN_Q1 + t * (ASIN_Q2 + t * (ASIN_Q3 + t * ASIN_Q4)));
+
+    return p / q;
+}
+
+//------------------------------------------------------------------
+
+double StrictAsin(const double x)
+{
+    int32_t  hx = HighWord(x);
+    int32_t  ix = hx & 0x7fffffff;
+    uint32_t lx = LowWord(x);
+
+    if (ix >= 0x3ff00000)
+    {
+        if (((ix - 0x3ff00000) | (int32_t) lx) == 0)
+            return x * PIO2_HI + x * PIO2_LO;
+
+        return NAN;
+    }
+
+    // |x| < 0.5
+    if (ix < 0x3fe00000)
+    {
+        if (ix < 0x3e500000)
+            return x;
+
+        return x + x * AsinRational(x * x);
+    }
+
+    // asin(x) = pi/2 - 2 asin(sqrt((1 - |x|) / 2))
+    double w = 1.0 - fabs(x);
+    double t = w * 0.5;
+    double s = sqrt(t);
+    double r = AsinRational(t);
+
+    if (ix >= 0x3FEF3333)
+        t = PIO2_HI - (2.0 * (s + s * r) - PIO2_LO);
+    else
+    {
+        w        = WordsToDouble(HighWord(s), 0);
+        double c = (t - w * w) / (s + w);
+        double p = 2.0 * s * r - (PIO2_LO - 2.0 * c);
+        double q = PIO4_HI - 2.0 * w;
+
+        t = PIO4_HI - (p - q);
+    }
+
+    return (hx > 0) ? t : -t;
+}
+
+//------------------------------------------------------------------
+
+double StrictAcos(const double x)
+{
+    int32_t  hx = HighWord(x);
+    int32_t  ix = hx & 0x7fffffff;
+    uint32_t lx = LowWord(x);
+
+    if (ix >= 0x3ff00000)
+    {
+        if (((ix - 0x3ff00000) | (int32_t) lx) == 0)
+            return (hx > 0) ? 0.0 : PI + 2.0 * PIO2_LO;
+
+        return NAN;
+    }
+
+    // |x| < 0.5
+    if (ix < 0x3fe00000)
+    {
+        if (ix <= 0x3c600000)
+            return PIO2_HI + PIO2_LO;
+
+        double r = AsinRational(x * x);
+
+        return PIO2_HI - (x - (PIO2_LO - x * r));
+    }
+
+    if (hx < 0)
+    {
+        double z = (1.0 + x) * 0.5;
+        double s = sqrt(z);
+        double w = AsinRational(z) * s - PIO2_LO;
+
+        return PI - 2.0 * (s + w);
+    }
+
+    double z  = (1.0 - x) * 0.5;
+    double s  = sqrt(z);
+    double df = WordsToDouble(HighWord(s), 0);
+    double c  = (z - df * df) / (s + df);
+    double w  = AsinRational(z) * s + c;
+
+    return 2.0 * (df + w);
+}
+
+//------------------------------------------------------------------
+
+double StrictAcot(const double x)
+{
+    // pi/2 - atan(x) cancels for large x, there it is atan(1/x)
+    if (fabs(x) <= 1)
+        return PIO2_HI - (StrictAtan(x) - PIO2_LO);
+
+    // rounding error of 1/x is taken back with first derivative of atan
+    double reciprocal = 1 / x;
+    double correction = isinf(x) ? 0 : fma(-reciprocal, x, 1) / x;
+    double inverse    = StrictAtan(reciprocal) + correction / (1 + reciprocal * reciprocal);
+
+    return (x > 0) ? inverse : PI + (inverse + 2.0 * PIO2_LO);
+}
+
+#pragma GCC diagnostic warning "-Wfloat-equal"
+
+// ======================================================================
+// OPERATIONS
+// ======================================================================
+
+// DEF_OP actions call sin, cos, ... unqualified, so inside these namespaces they resolve to tier functions
+
+#define DEF_OP(name, symb, priority, arg_amt, action, ...)      \
+            case (Operators::name):                             \
+                return action;                                  \
+
+namespace strict_tier
+{
+    static inline double exp(const double x)                    { return StrictExp(x);     }
+    static inline double log(const double x)                    { return StrictLog(x);     }
+    static inline double pow(const double x, const double y)    { return StrictPow(x, y);  }
+    static inline double sin(const double x)                    { return StrictSin(x);     }
+    static inline double cos(const double x)                    { return StrictCos(x);     }
+    static inline double tan(const double x)                    { return StrictTan(x);     }
+    static inline double atan(const double x)                   { return StrictAtan(x);    }
+    static inline double asin(const double x)                   { return StrictAsin(x);    }
+    static inline double acos(const double x)                   { return StrictAcos(x);    }
+
+    static double OperatorAction(const double NUMBER_1, const double NUMBER_2, const Operators operation,
+                                 error_t* error)
+    {
+        if (operation == Operators::ARCCOT)
+            return StrictAcot(NUMBER_2);
+
+        switch (operation)
+        {
+            #include "operations.h"
+            default:
+                error->code = (int) ExpressionErrors::UNKNOWN_OPERATION;
+                return POISON;
+        }
+    }
+}
+
+namespace fast_tier
+{
+    static inline double exp(const double x)                    { return FastExp(x);       }
+    static inline double log(const double x)                    { return FastLog(x);       }
+    static inline double pow(const double x, const double y)    { return FastPow(x, y);    }
+    static inline double sin(const double x)                    { return FastSin(x);       }
+    static inline double cos(const double x)                    { return FastCos(x);       }
+    static inline double tan(const double x)                    { return FastTan(x);       }
+    static inline double atan(const double x)                   { return FastAtan(x);      }
+    static inline double asin(const double x)                   { return FastAsin(x);      }
+    static inline double acos(const double x)                   { return FastAcos(x);      }
+
+    static double OperatorAction(const double NUMBER_1, const double NUMBER_2, const Operators operation,
+                                 error_t* error)
+    {
+        if (IsFastTrigOperation(operation) && !(fabs(NUMBER_2) <= FAST_MAX_TRIG_ARG))
+            return strict_tier::OperatorAction(NUMBER_1, NUMBER_2, operation, error);
+
+        if (operation == Operators::ARCCOT)
+            return FastAcot(NUMBER_2);
+
+        switch (operation)
+        {
+            #include "operations.h"
+            default:
+                error->code = (int) ExpressionErrors::UNKNOWN_OPERATION;
+                return POISON;
+        }
+    }
+}
+
+#undef DEF_OP
+
+//------------------------------------------------------------------
+
+static bool IsFastTrigOperation(const Operators operation)
+{
+    return operation == Operators::SIN || operation == Operators::COS || operation == Operators::TAN ||
+           operation == Operators::COT;
+}
+
+//------------------------------------------------------------------
+
+// operation is chosen once for whole column, so loop body is one branch-free action
+
+#define NUMBER_1 left[i]
+#define NUMBER_2 right[i]
+
+#define DEF_OP(name, symb, priority, arg_amt, action, ...)      \
+            case (Operators::name):                             \
+                for (size_t i = 0; i < amt; i++)                \
+                    result[i] = (action);                       \
+                break;                                          \
+
+namespace fast_tier
+{
+    static void ColumnAction(const Operators operation, const double* left, const double* right,
+                             double* result, const size_t amt, error_t* error)
+    {
+        if (operation == Operators::ARCCOT)
+        {
+            for (size_t i = 0; i < amt; i++)
+                result[i] = FastAcot(right[i]);
+            return;
+        }
+
+        switch (operation)
+        {
+            #include "operations.h"
+            default:
+                error->code = (int) ExpressionErrors::UNKNOWN_OPERATION;
+                break;
+        }
+    }
+}
+
+#undef DEF_OP
+#undef NUMBER_1
+#undef NUMBER_2
+
+//------------------------------------------------------------------
+
+void CalculateColumnOperation(const Operators operation, const double* left, const double* right,
+                              double* result, const size_t amt, const MathTier tier, error_t* error)
+{
+    assert(left);
+    assert(right);
+    assert(result);
+    assert(error);
+
+    switch (tier)
+    {
+        case (MathTier::FAST):
+            fast_tier::ColumnAction(operation, left, right, result, amt, error);
+
+            // huge arguments are rare, so they are fixed after the loop instead of branching in it
+            if (IsFastTrigOperation(operation))
+                for (size_t i = 0; i < amt; i++)
+                    if (!(fabs(right[i]) <= FAST_MAX_TRIG_ARG))
+                        result[i] = strict_tier::OperatorAction(left[i], right[i], operation, error);
+            break;
+
+        case (MathTier::STRICT):
+            for (size_t i = 0; i < amt; i++)
+                result[i] = strict_tier::OperatorAction(left[i], right[i], operation, error);
+            break;
+
+        case (MathTier::LIBM):
+            CalculateColumnOperation(operation, left, right, result, amt, error);
+            break;
+
+        default:
+            error->code = (int) ExpressionErrors::UNKNOWN;
+            break;
+    }
+}
+
+//------------------------------------------------------------------
+
+double CalculateOperation(const double left, const double right, const Operators operation, const MathTier tier,
+                          error_t* error)
+{
+    assert(error);
+
+    switch (tier)
+    {
+        case (MathTier::STRICT):
+            return strict_tier::OperatorAction(left, right, operation, error);
+        case (MathTier::FAST):
+            return fast_tier::OperatorAction(left, right, operation, error);
+        case (MathTier::LIBM):
+            return CalculateOperation(left, right, operation, error);
+        default:
+            error->code = (int) ExpressionErrors::UNKNOWN;
+            return POISON;
+    }
+}
+
+//------------------------------------------------------------------
+
+static double CalculateTierSubtree(const variable_t* vars, const Node* node, const MathTier tier, error_t* error)
+{
+    assert(vars);
+    assert(error);
+
+    if (!node) return 0;
+
+    switch (node->type)
+    {
+        case (NodeType::NUMBER):
+            return node->value.val;
+
+        case (NodeType::VARIABLE):
+            return vars[node->value.var].value;
+
+        case (NodeType::OPERATOR):
+        {
+            double left  = CalculateTierSubtree(vars, node->left,  tier, error);
+            double right = CalculateTierSubtree(vars, node->right, tier, error);
+
+            if (error->code != (int) ExpressionErrors::NONE)
+                return POISON;
+
+            return CalculateOperation(left, right, node->value.opt, tier, error);
+        }
+
+        case (NodeType::POISON):
+        default:
+            error->code = (int) ExpressionErrors::INVALID_EXPRESSION_FORMAT;
+            return POISON;
+    }
+}
+
+//------------------------------------------------------------------
+
+double CalculateExpression(const expr_t* expr, const variable_t* vars, const MathTier tier, error_t* error)
+{
+    assert(expr);
+    assert(vars);
+    assert(error);
+
+    return CalculateTierSubtree(vars, expr->root, tier, error);
+}
@@ -0,0 +1,301 @@
+#ifndef __MATH_TIERS_H_
+#define __MATH_TIERS_H_
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "expression/expression.h"
+
+// ======================================================================
+// TIERS
+// ======================================================================
+
+enum class MathTier
+{
+    LIBM,           // system math library
+    STRICT,         // in-project, error under 1 ulp (1.2 for arccot)
+    FAST,           // in-project, relative error about 1e-7
+};
+
+// DEF_OP actions with math functions of given tier
+double CalculateOperation(const double left, const double right, const Operators operation, const MathTier tier,
+                          error_t* error);
+double CalculateExpression(const expr_t* expr, const variable_t* vars, const MathTier tier, error_t* error);
+
+// one operator over amt rows like CalculateColumnOperation; fast tier is one branch-free loop,
+// arguments out of its trigonometric range are recalculated by strict tier after it
+void   CalculateColumnOperation(const Operators operation, const double* left, const double* right,
+                                double* result, const size_t amt, const MathTier tier, error_t* error);
+
+// ======================================================================
+// STRICT
+// ======================================================================
+
+// fdlibm algorithms; trigonometric arguments beyond 2^20 * pi/2 are passed to system library,
+// because their reduction needs multiprecision pi. StrictAcot is made of StrictAtan without
+// cancellation, its error is up to 1.2 ulp
+
+double StrictExp(const double x);
+double StrictLog(const double x);
+double StrictPow(const double x, const double y);
+double StrictSin(const double x);
+double StrictCos(const double x);
+double StrictTan(const double x);
+double StrictAtan(const double x);
+double StrictAsin(const double x);
+double StrictAcos(const double x);
+double StrictAcot(const double x);
+
+// ======================================================================
+// BITS
+// ======================================================================
+
+static inline uint64_t DoubleToBits(const double x)
+{
+    uint64_t bits = 0;
+    memcpy(&bits, &x, sizeof(bits));
+
+    return bits;
+}
+
+static inline double BitsToDouble(const uint64_t bits)
+{
+    double x = 0;
+    memcpy(&x, &bits, sizeof(x));
+
+    return x;
+}
+
+static inline int32_t  HighWord(const double x) { return (int32_t)  (DoubleToBits(x) >> 32); }
+static inline uint32_t LowWord(const double x)  { return (uint32_t) DoubleToBits(x); }
+
+static inline double WordsToDouble(const int32_t high, const uint32_t low)
+{
+    return BitsToDouble(((uint64_t) (uint32_t) high << 32) | low);
+}
+
+// ======================================================================
+// FAST
+// ======================================================================
+
+// short polynomials after one-step range reduction, no tables and no branches: special cases are
+// selects and integers are taken from bits of doubles, so column loops of every operator are
+// vectorized at -O3 once -fno-trapping-math and -fno-math-errno allow selects and sqrt in vectors.
+// Subnormal arguments and results are not supported; sin, cos and tan are NaN beyond
+// FAST_MAX_TRIG_ARG, which tier operations pass to strict functions
+
+#pragma GCC diagnostic ignored "-Wfloat-equal"
+
+static const double FAST_LN2_HI         = 6.93147180369123816490e-01;
+static const double FAST_LN2_LO         = 1.90821492927058770002e-10;
+static const double FAST_INV_LN2        = 1.44269504088896338700e+00;
+static const double FAST_PIO2_HI        = 1.57079632673412561417e+00;
+static const double FAST_PIO2_LO        = 6.07710050650619224932e-11;
+static const double FAST_INV_PIO2       = 6.36619772367581382433e-01;
+static const double FAST_SQRT3          = 1.73205080756887719318e+00;
+static const double FAST_TAN_PI_12      = 2.67949192431122706473e-01;
+
+static const double FAST_ROUND_MAGIC    = 6755399441055744.0;           // 1.5 * 2^52, integer in low bits
+static const double FAST_MAX_EXP_ARG    = 709.782712893383973096;
+static const double FAST_MIN_EXP_ARG    = -708.39641853226410622;
+static const double FAST_MAX_TRIG_ARG   = 1e6;
+
+//------------------------------------------------------------------
+
+static inline double FastExp(const double x)
+{
+    // comparisons instead of fmin and fmax, which are library calls
+    double t = (x > FAST_MIN_EXP_ARG) ? x : FAST_MIN_EXP_ARG;
+    t        = (t < FAST_MAX_EXP_ARG) ? t : FAST_MAX_EXP_ARG;
+
+    double k = (t * FAST_INV_LN2 + FAST_ROUND_MAGIC) - FAST_ROUND_MAGIC;
+    double r = (t - k * FAST_LN2_HI) - k * FAST_LN2_LO;
+
+    // |r| <= ln2 / 2
+    double p = 1 + r * (1 + r * (1.0 / 2 + r * (1.0 / 6 + r * (1.0 / 24 + r * (1.0 / 120 + r * (1.0 / 720))))));
+
+    // 2^k is split in two factors, so k = 1024 does not overflow the exponent field;
+    // biased exponents are low bits of rounded doubles
+    double half = (k * 0.5 + FAST_ROUND_MAGIC) - FAST_ROUND_MAGIC;
+
+    double scale_1 = BitsToDouble(DoubleToBits(half + 1023 + FAST_ROUND_MAGIC) << 52);
+    double scale_2 = BitsToDouble(DoubleToBits(k - half + 1023 + FAST_ROUND_MAGIC) << 52);
+
+    double result = p * scale_1 * scale_2;
+
+    result = (x > FAST_MAX_EXP_ARG) ? INFINITY : result;
+    result = (x < FAST_MIN_EXP_ARG) ? 0        : result;
+
+    return (x != x) ? x : result;
+}
+
+//------------------------------------------------------------------
+
+static inline double FastLog(const double x)
+{
+    uint64_t bits = DoubleToBits(x);
+
+    // mantissa m in [sqrt(2)/2, sqrt(2)), x = m * 2^e
+    uint64_t frac = bits & 0x000fffffffffffffULL;
+    bool     big  = frac > 0x6a09e667f3bcdULL;
+
+    double m = BitsToDouble(frac | ((uint64_t) (big ? 1022 : 1023) << 52));
+    double e = (BitsToDouble(DoubleToBits(FAST_ROUND_MAGIC) + ((bits >> 52) & 0x7ff)) - FAST_ROUND_MAGIC) - 1023;
+    e       += big ? 1 : 0;
+
+    // log(m) = 2 atanh(f)
+    double f = (m - 1) / (m + 1);
+    double s = f * f;
+
+    double log_m = 2 * f * (1 + s * (1.0 / 3 + s * (1.0 / 5 + s * (1.0 / 7))));
+
+    double result = e * FAST_LN2_HI + (e * FAST_LN2_LO + log_m);
+
+    result = (x == INFINITY) ? x        : result;
+    result = (x == 0)        ? -INFINITY : result;
+
+    return (x < 0 || x != x) ? NAN : result;
+}
+
+//------------------------------------------------------------------
+
+// quadrant (its low bits) and reduced argument of x, |r| <= pi/4; arguments out of
+// FAST_MAX_TRIG_ARG are reduced as 0
+static inline double FastReduceHalfPi(const double x, uint64_t* quadrant)
+{
+    double t = (fabs(x) <= FAST_MAX_TRIG_ARG) ? x : 0;
+
+    double rounded = t * FAST_INV_PIO2 + FAST_ROUND_MAGIC;
+    double k       = rounded - FAST_ROUND_MAGIC;
+
+    *quadrant = DoubleToBits(rounded);
+
+    return (t - k * FAST_PIO2_HI) - k * FAST_PIO2_LO;
+}
+
+static inline double FastSinKernel(const double r)
+{
+    double z = r * r;
+
+    return r + r * z * (-1.0 / 6 + z * (1.0 / 120 + z * (-1.0 / 5040 + z * (1.0 / 362880))));
+}
+
+static inline double FastCosKernel(const double r)
+{
+    double z = r * r;
+
+    return 1 + z * (-1.0 / 2 + z * (1.0 / 24 + z * (-1.0 / 720 + z * (1.0 / 40320))));
+}
+
+//------------------------------------------------------------------
+
+static inline double FastSin(const double x)
+{
+    uint64_t quadrant = 0;
+    double   r        = FastReduceHalfPi(x, &quadrant);
+
+    double   value    = (quadrant & 1) ? FastCosKernel(r) : FastSinKernel(r);
+    value             = (quadrant & 2) ? -value : value;
+
+    return (fabs(x) <= FAST_MAX_TRIG_ARG) ? value : NAN;
+}
+
+//------------------------------------------------------------------
+
+static inline double FastCos(const double x)
+{
+    uint64_t quadrant = 0;
+    double   r        = FastReduceHalfPi(x, &quadrant);
+
+    double   value    = (quadrant & 1) ? FastSinKernel(r) : FastCosKernel(r);
+    value             = ((quadrant + 1) & 2) ? -value : value;
+
+    return (fabs(x) <= FAST_MAX_TRIG_ARG) ? value : NAN;
+}
+
+//------------------------------------------------------------------
+
+static inline double FastTan(const double x)
+{
+    uint64_t quadrant = 0;
+    double   r        = FastReduceHalfPi(x, &quadrant);
+
+    double   sin_r    = FastSinKernel(r);
+    double   cos_r    = FastCosKernel(r);
+
+    double   value    = (quadrant & 1) ? -cos_r / sin_r : sin_r / cos_r;
+
+    return (fabs(x) <= FAST_MAX_TRIG_ARG) ? value : NAN;
+}
+
+//------------------------------------------------------------------
+
+static inline double FastAtan(const double x)
+{
+    double t      = fabs(x);
+    bool   invert = t > 1;
+
+    t = invert ? 1 / t : t;
+
+    // atan(t) = pi/6 + atan((sqrt(3) t - 1) / (sqrt(3) + t)), so |u| <= tan(pi/12)
+    bool   shift  = t > FAST_TAN_PI_12;
+
+    double u = shift ? (FAST_SQRT3 * t - 1) / (FAST_SQRT3 + t) : t;
+    double z = u * u;
+
+    double atan_u = u + u * z * (-1.0 / 3 + z * (1.0 / 5 + z * (-1.0 / 7 + z * (1.0 / 9 + z * (-1.0 / 11)))));
+
+    double result = shift  ? M_PI / 6 + atan_u   : atan_u;
+    result        = invert ? M_PI / 2 - result   : result;
+
+    return (x < 0) ? -result : result;
+}
+
+//------------------------------------------------------------------
+
+static inline double FastAsin(const double x)
+{
+    // 1 - x^2 is factored to keep precision near +-1
+    return FastAtan(x / sqrt((1 - x) * (1 + x)));
+}
+
+//------------------------------------------------------------------
+
+static inline double FastAcos(const double x)
+{
+    // pi/2 - asin(x) loses all precision near 1
+    return 2 * FastAtan(sqrt((1 - x) / (1 + x)));
+}
+
+//------------------------------------------------------------------
+
+static inline double FastAcot(const double x)
+{
+    // pi/2 - atan(x) loses all precision for large x
+    double inverse = FastAtan(1 / x);
+    double result  = (x > 0) ? inverse : M_PI + inverse;
+
+    return (fabs(x) > 1) ? result : M_PI / 2 - FastAtan(x);
+}
+
+//------------------------------------------------------------------
+
+static inline double FastPow(const double x, const double y)
+{
+    double result  = FastExp(y * FastLog(fabs(x)));
+
+    // negative base is defined only for integer powers
+    bool   integer = trunc(y) == y;
+    bool   odd     = integer && trunc(y * 0.5) != y * 0.5;
+
+    // sign bit is taken from bits, signbit is not vectorized
+    double negative = integer ? (odd ? -result : result) : NAN;
+    result          = (DoubleToBits(x) >> 63) ? negative : result;
+
+    return (y == 0 || x == 1 || (x == -1 && isinf(y))) ? 1 : result;
+}
+
+#pragma GCC diagnostic warning "-Wfloat-equal"
+
+#endif
@@ -10,7 +10,9 @@
 //        NEED_LEFT_BRACKETS, LEFT_FIGURE_BRACKET, NEED_RIGHT_BRACKETS, RIGHT_FIGURE_BRACKET,
 //        {
 //              DIFFERENTIATED OPERATION
-//        })
+//        }, PARTIAL_BY_NUMBER_1, PARTIAL_BY_NUMBER_2)
+
+// partials of ACTION may use RESULT, value of ACTION; unary operators have 0 by NUMBER_1
 
 // ======================================================================
 // OPERATIONS
@@ -20,14 +22,14 @@
 DEF_OP(ADD, "+", 1, 2, (NUMBER_1 + NUMBER_2), "+", LatexOperationTypes::INFIX, "+", false, false, false, false,
 {
     return _ADD(d(node->left), d(node->right));
-})
+}, (1), (1))
 
 //------------------------------------------------------------------
 
 DEF_OP(SUB, "-", 1, 2, (NUMBER_1 - NUMBER_2), "-", LatexOperationTypes::INFIX, "-", false, false, false, false,
 {
     return _SUB(d(node->left), d(node->right));
-})
+}, (1), (-1))
 
 //------------------------------------------------------------------
 
@@ -35,14 +37,14 @@ DEF_OP(DIV, "/", 2, 2, (NUMBER_1 / NUMBER_2), "/", LatexOperationTypes::PREFIX,
 {
     return _DIV(_SUB(_MUL(d(node->left), CPY(node->right)), _MUL(CPY(node->left), d(node->right))),
                 _DEG(CPY(node->right), _NUM(2)));
-})
+}, (1 / NUMBER_2), (-RESULT / NUMBER_2))
 
 //------------------------------------------------------------------
 
 DEF_OP(MUL, "*", 2, 2, (NUMBER_1 * NUMBER_2), "*", LatexOperationTypes::INFIX, "\\cdot", false, false, false, false,
 {
     return _ADD(_MUL(d(node->left), CPY(node->right)), _MUL(CPY(node->left), d(node->right)));;
-})
+}, (NUMBER_2), (NUMBER_1))
 
 //------------------------------------------------------------------
 
@@ -63,11 +65,11 @@ DEF_OP(DEG, "^", 2, 2, (pow(NUMBER_1, NUMBER_2)), "**", LatexOperationTypes::INF
     }
     else if (has_var_in_deg)
     {
-        return _MUL(_LN(CPY(node->left)), CPY(node));
+        return _MUL(d(node->right), _MUL(_LN(CPY(node->left)), CPY(node)));
     }
     else
         return _NUM(0);
-})
+}, (NUMBER_2 * pow(NUMBER_1, NUMBER_2 - 1)), (RESULT * log(NUMBER_1)))
 
 //==================================================================
 //==================================================================
@@ -75,14 +77,14 @@ DEF_OP(DEG, "^", 2, 2, (pow(NUMBER_1, NUMBER_2)), "**", LatexOperationTypes::INF
 DEF_OP(LN, "ln", 2, 1, (log(NUMBER_2)), "log", LatexOperationTypes::PREFIX, "\\ln", false, false, true, false,
 {
     return _MUL(d(node->right), _DIV(_NUM(1), CPY(node->right)));
-})
+}, (0), (1 / NUMBER_2))
 
 //------------------------------------------------------------------
 
 DEF_OP(EXP, "exp", 2, 1, (exp(NUMBER_2)), "exp", LatexOperationTypes::PREFIX, "\\exp", false, false, true, false,
 {
     return _MUL(d(node->right), CPY(node));
-})
+}, (0), (RESULT))
 
 //==================================================================
 //==================================================================
@@ -90,55 +92,55 @@ DEF_OP(EXP, "exp", 2, 1, (exp(NUMBER_2)), "exp", LatexOperationTypes::PREFIX, "\
 DEF_OP(SIN, "sin", 2, 1, (sin(NUMBER_2)), "sin", LatexOperationTypes::PREFIX, "\\sin", false, false, true, false,
 {
     return _MUL(d(node->right), _COS(CPY(node->right)));
-})
+}, (0), (cos(NUMBER_2)))
 
 //------------------------------------------------------------------
 
 DEF_OP(COS, "cos", 2, 1, (cos(NUMBER_2)), "cos", LatexOperationTypes::PREFIX, "\\cos", false, false, true, false,
 {
     return _MUL(_NUM(-1), _MUL(d(node->right), _SIN(CPY(node->right))));
-})
+}, (0), (-sin(NUMBER_2)))
 
 //------------------------------------------------------------------
 
 DEF_OP(COT, "ctg", 2, 1, (1/tan(NUMBER_2)), "1/tan", LatexOperationTypes::PREFIX, "\\cot", false, false, true, false,
 {
     return _MUL(_NUM(-1), _MUL(d(node->right), _DIV(_NUM(1), _DEG(_SIN(CPY(node->right)), _NUM(2)))));
-})
+}, (0), (-1 - RESULT * RESULT))
 
 //------------------------------------------------------------------
 
 DEF_OP(TAN, "tg", 2, 1, (tan(NUMBER_2)), "tan", LatexOperationTypes::PREFIX, "\\tan", false, false, true, false,
 {
     return _MUL(d(node->right), _DIV(_NUM(1), _DEG(_COS(CPY(node->right)), _NUM(2))));
-})
+}, (0), (1 + RESULT * RESULT))
 
 //==================================================================
 //==================================================================
 
 DEF_OP(ARCSIN, "arcsin", 2, 1, (asin(NUMBER_2)), "asin", LatexOperationTypes::PREFIX, "\\arcsin", false, false, true, false,
 {
-    return _DEG(_SUB(_NUM(1), _DEG(CPY(node->right), _NUM(2))), _NUM(-0.5));
-})
+    return _MUL(d(node->right), _DEG(_SUB(_NUM(1), _DEG(CPY(node->right), _NUM(2))), _NUM(-0.5)));
+}, (0), (1 / sqrt(1 - NUMBER_2 * NUMBER_2)))
 
 //------------------------------------------------------------------
 
 DEF_OP(ARCCOS, "arccos", 2, 1, (acos(NUMBER_2)), "acos", LatexOperationTypes::PREFIX, "\\arccos", false, false, true, false,
 {
-    return _MUL(_NUM(-1), _DEG(_SUB(_NUM(1), _DEG(CPY(node->right), _NUM(2))), _NUM(-0.5)));
-})
+    return _MUL(_NUM(-1), _MUL(d(node->right), _DEG(_SUB(_NUM(1), _DEG(CPY(node->right), _NUM(2))), _NUM(-0.5))));
+}, (0), (-1 / sqrt(1 - NUMBER_2 * NUMBER_2)))
 
 //------------------------------------------------------------------
 
 DEF_OP(ARCCOT, "arcctg", 2, 1, (M_PI/2 - atan(NUMBER_2)), "pi/2 - atan", LatexOperationTypes::PREFIX, "\\arccot", false, false, true, false,
 {
-    return _DIV(_NUM(-1), _ADD(_NUM(1), _DEG(CPY(node->right), _NUM(2))));
-})
+    return _MUL(d(node->right), _DIV(_NUM(-1), _ADD(_NUM(1), _DEG(CPY(node->right), _NUM(2)))));
+}, (0), (-1 / (1 + NUMBER_2 * NUMBER_2)))
 
 //------------------------------------------------------------------
 
 DEF_OP(ARCTAN, "arctg", 2, 1, (atan(NUMBER_2)), "atan", LatexOperationTypes::PREFIX, "\\arctan", false, false, true, false,
 {
-    return _DIV(_NUM(1), _ADD(_NUM(1), _DEG(CPY(node->right), _NUM(2))));
-})
+    return _MUL(d(node->right), _DIV(_NUM(1), _ADD(_NUM(1), _DEG(CPY(node->right), _NUM(2)))));
+}, (0), (1 / (1 + NUMBER_2 * NUMBER_2)))
 
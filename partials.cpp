@@ -0,0 +1,127 @@
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "partials.h"
+#include "calculation.h"
+#include "shards.h"
+
+struct PartialsPool
+{
+    const expr_t*       expr;
+    const char* const*  vars;
+    size_t              vars_amt;
+    expr_t**            partials;
+
+    pthread_mutex_t     lock;
+    size_t              next;               // first variable no worker has taken
+    error_t             error;              // first error of workers
+};
+
+static void*    DifferentiatePartials(void* arg);
+
+//------------------------------------------------------------------
+
+ExpressionErrors DifferentiateExpressionParallel(const expr_t* expr, const char* const* vars,
+                                                 const size_t vars_amt, expr_t** partials,
+                                                 const size_t threads_amt, error_t* error)
+{
+    assert(expr);
+    assert(vars);
+    assert(partials);
+    assert(error);
+
+    for (size_t i = 0; i < vars_amt; i++)
+        partials[i] = nullptr;
+
+    size_t workers_amt = (threads_amt == 0) ? AvailableCoresAmt() : threads_amt;
+    if (workers_amt > vars_amt)
+        workers_amt = vars_amt;
+
+    pthread_t* workers = (pthread_t*) calloc(workers_amt + 1, sizeof(pthread_t));
+    if (workers == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "PARTIALS WORKERS";
+        return ExpressionErrors::ALLOCATE_MEMORY;
+    }
+
+    PartialsPool pool = {.expr = expr, .vars = vars, .vars_amt = vars_amt, .partials = partials};
+
+    pthread_mutex_init(&pool.lock, nullptr);
+
+    size_t started = 0;
+
+    for (; started < workers_amt; started++)
+    {
+        if (pthread_create(&workers[started], nullptr, DifferentiatePartials, &pool) != 0)
+            break;
+    }
+
+    // without any thread caller does everything itself
+    if (started == 0)
+        DifferentiatePartials(&pool);
+
+    for (size_t i = 0; i < started; i++)
+        pthread_join(workers[i], nullptr);
+
+    pthread_mutex_destroy(&pool.lock);
+    free(workers);
+
+    if (pool.error.code != (int) ExpressionErrors::NONE)
+    {
+        for (size_t i = 0; i < vars_amt; i++)
+        {
+            if (partials[i] == nullptr)
+                continue;
+
+            ExpressionDtor(partials[i]);
+            free(partials[i]);
+            partials[i] = nullptr;
+        }
+
+        *error = pool.error;
+    }
+
+    return (ExpressionErrors) error->code;
+}
+
+//------------------------------------------------------------------
+
+static void* DifferentiatePartials(void* arg)
+{
+    assert(arg);
+
+    PartialsPool* pool = (PartialsPool*) arg;
+
+    while (true)
+    {
+        pthread_mutex_lock(&pool->lock);
+
+        size_t var    = pool->next++;
+        bool   failed = pool->error.code != (int) ExpressionErrors::NONE;
+
+        pthread_mutex_unlock(&pool->lock);
+
+        if (var >= pool->vars_amt || failed)
+            break;
+
+        error_t error = {};
+
+        pool->partials[var] = DifferentiateExpression(pool->expr, pool->vars[var], &error);
+
+        if (error.code != (int) ExpressionErrors::NONE)
+        {
+            pthread_mutex_lock(&pool->lock);
+
+            if (pool->error.code == (int) ExpressionErrors::NONE)
+                pool->error = error;
+
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+    }
+
+    ReleaseNodePool();
+
+    return nullptr;
+}
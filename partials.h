@@ -0,0 +1,22 @@
+#ifndef __PARTIALS_H_
+#define __PARTIALS_H_
+
+#include "expression/expression.h"
+
+// ======================================================================
+// PARALLEL PARTIALS
+// ======================================================================
+
+// derivatives by different variables share only the original, which is just read, so they are made
+// by a pool of threads that take variables one by one. Workers differentiate and simplify without
+// narration (it is the only user of page counter and random phrases) and build trees from their
+// own node pools
+
+// partials[i] gets simplified derivative by vars[i], it belongs to caller; if any of them fails,
+// all are freed. threads_amt = 0 means one thread for every core available to this process.
+// Nodes of partials freed by caller go to caller's pool, releasing it is up to caller
+ExpressionErrors DifferentiateExpressionParallel(const expr_t* expr, const char* const* vars,
+                                                 const size_t vars_amt, expr_t** partials,
+                                                 const size_t threads_amt, error_t* error);
+
+#endif
@@ -0,0 +1,522 @@
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "shards.h"
+
+// protocol: program once after start, then command -> reply for every shard,
+// command with zero rows stops worker
+
+struct ProgramHeader
+{
+    uint64_t    instr_amt;
+    uint64_t    outputs_amt;
+    uint64_t    vars_amt;
+};
+
+struct ShardCommand
+{
+    uint64_t    first_row;
+    uint64_t    rows_amt;
+};
+
+struct ShardReply
+{
+    uint64_t    first_row;
+    int64_t     code;
+};
+
+enum class ShardState
+{
+    PENDING,
+    RUNNING,
+    DONE,
+};
+
+struct Shard
+{
+    size_t      first_row;
+    size_t      rows_amt;
+    ShardState  state;
+    int         attempts;
+};
+
+static const int NO_SHARD = -1;
+
+struct Worker
+{
+    pid_t       pid;
+    int         socket;         // coordinator end
+    int         shard;          // running shard or NO_SHARD
+};
+
+struct Coordinator
+{
+    const ir_t*             ir;
+    const double*           var_values;
+    const int*              var_columns;
+    size_t                  vars_amt;
+
+    const columns_file_t*   in;
+    const columns_file_t*   out;
+
+    Shard*                  shards;
+    size_t                  shards_amt;
+    size_t                  done_amt;
+
+    Worker*                 workers;
+    size_t                  workers_amt;
+
+    struct pollfd*          polls;
+};
+
+static bool     WriteAll(const int fd, const void* data, const size_t size);
+static bool     ReadAll(const int fd, void* data, const size_t size);
+
+static bool     SendProgram(const Coordinator* coord, const int fd);
+static bool     ReceiveProgram(const int fd, ir_t* ir, double** var_values, int** var_columns);
+
+[[noreturn]] static void RunWorker(const int fd, const columns_file_t* in, const columns_file_t* out);
+
+static void     StartWorker(Coordinator* coord, Worker* worker, error_t* error);
+static void     StopWorker(Worker* worker);
+static void     ReplaceWorker(Coordinator* coord, Worker* worker, error_t* error);
+
+static void     AssignShards(Coordinator* coord, error_t* error);
+static void     CollectReplies(Coordinator* coord, error_t* error);
+
+
+//------------------------------------------------------------------
+
+static bool WriteAll(const int fd, const void* data, const size_t size)
+{
+    assert(data);
+
+    const char* ptr  = (const char*) data;
+    size_t      left = size;
+
+    while (left > 0)
+    {
+        // dead reader must not kill coordinator with SIGPIPE; no signal handlers are set,
+        // so failure is not EINTR and means closed socket
+        ssize_t written = send(fd, ptr, left, MSG_NOSIGNAL);
+
+        if (written <= 0)
+            return false;
+
+        ptr  += written;
+        left -= (size_t) written;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------
+
+static bool ReadAll(const int fd, void* data, const size_t size)
+{
+    assert(data);
+
+    char*  ptr  = (char*) data;
+    size_t left = size;
+
+    while (left > 0)
+    {
+        ssize_t got = read(fd, ptr, left);
+
+        if (got <= 0)
+            return false;
+
+        ptr  += got;
+        left -= (size_t) got;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------
+
+static bool SendProgram(const Coordinator* coord, const int fd)
+{
+    assert(coord);
+
+    const ir_t*   ir     = coord->ir;
+    ProgramHeader header = {ir->size, ir->outputs_amt, coord->vars_amt};
+
+    // instructions are plain data and workers run the same binary, so they are sent as they are
+    return WriteAll(fd, &header, sizeof(header)) &&
+           WriteAll(fd, ir->code, ir->size * sizeof(IrInstruction)) &&
+           WriteAll(fd, ir->outputs, ir->outputs_amt * sizeof(int)) &&
+           WriteAll(fd, coord->var_values, coord->vars_amt * sizeof(double)) &&
+           WriteAll(fd, coord->var_columns, coord->vars_amt * sizeof(int));
+}
+
+//------------------------------------------------------------------
+
+static bool ReceiveProgram(const int fd, ir_t* ir, double** var_values, int** var_columns)
+{
+    assert(ir);
+    assert(var_values);
+    assert(var_columns);
+
+    ProgramHeader header = {};
+    if (!ReadAll(fd, &header, sizeof(header)))
+        return false;
+
+    *ir = {};
+
+    ir->code         = (IrInstruction*) calloc(header.instr_amt + 1,   sizeof(IrInstruction));
+    ir->outputs      = (int*)           calloc(header.outputs_amt + 1, sizeof(int));
+    ir->size         = ir->capacity         = header.instr_amt;
+    ir->outputs_amt  = ir->outputs_capacity = header.outputs_amt;
+
+    *var_values      = (double*)        calloc(header.vars_amt + 1, sizeof(double));
+    *var_columns     = (int*)           calloc(header.vars_amt + 1, sizeof(int));
+
+    if (ir->code == nullptr || ir->outputs == nullptr || *var_values == nullptr || *var_columns == nullptr)
+        return false;
+
+    return ReadAll(fd, ir->code, header.instr_amt * sizeof(IrInstruction)) &&
+           ReadAll(fd, ir->outputs, header.outputs_amt * sizeof(int)) &&
+           ReadAll(fd, *var_values, header.vars_amt * sizeof(double)) &&
+           ReadAll(fd, *var_columns, header.vars_amt * sizeof(int));
+}
+
+//------------------------------------------------------------------
+
+[[noreturn]] static void RunWorker(const int fd, const columns_file_t* in, const columns_file_t* out)
+{
+    assert(in);
+    assert(out);
+
+    ir_t    ir          = {};
+    double* var_values  = nullptr;
+    int*    var_columns = nullptr;
+
+    // _exit: buffers and atexit handlers belong to coordinator
+    if (!ReceiveProgram(fd, &ir, &var_values, &var_columns))
+        _exit(EXIT_FAILURE);
+
+    ShardCommand command = {};
+
+    while (ReadAll(fd, &command, sizeof(command)) && command.rows_amt > 0)
+    {
+        error_t error = {};
+
+        CalculateIrColumns(&ir, var_values, var_columns, in, out, command.first_row, command.rows_amt, &error);
+
+        ShardReply reply = {command.first_row, error.code};
+        if (!WriteAll(fd, &reply, sizeof(reply)))
+            break;
+    }
+
+    _exit(EXIT_SUCCESS);
+}
+
+//------------------------------------------------------------------
+
+static void StartWorker(Coordinator* coord, Worker* worker, error_t* error)
+{
+    assert(coord);
+    assert(worker);
+    assert(error);
+
+    worker->pid    = -1;
+    worker->socket = -1;
+    worker->shard  = NO_SHARD;
+
+    int ends[2] = {};
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, ends) != 0)
+    {
+        error->code = (int) ExpressionErrors::UNKNOWN;
+        error->data = "WORKER SOCKET";
+        return;
+    }
+
+    pid_t pid = fork();
+
+    if (pid < 0)
+    {
+        close(ends[0]);
+        close(ends[1]);
+
+        error->code = (int) ExpressionErrors::UNKNOWN;
+        error->data = "WORKER START";
+        return;
+    }
+
+    if (pid == 0)
+    {
+        close(ends[0]);
+        for (size_t i = 0; i < coord->workers_amt; i++)
+            if (coord->workers[i].socket >= 0)
+                close(coord->workers[i].socket);
+
+        RunWorker(ends[1], coord->in, coord->out);
+    }
+
+    close(ends[1]);
+
+    worker->pid    = pid;
+    worker->socket = ends[0];
+
+    // failed sending shows up as closed socket in CollectReplies
+    SendProgram(coord, worker->socket);
+}
+
+//------------------------------------------------------------------
+
+static void StopWorker(Worker* worker)
+{
+    assert(worker);
+
+    if (worker->socket >= 0)
+    {
+        ShardCommand command = {0, 0};
+        WriteAll(worker->socket, &command, sizeof(command));
+
+        close(worker->socket);
+    }
+
+    if (worker->pid > 0)
+        waitpid(worker->pid, nullptr, 0);
+
+    worker->pid    = -1;
+    worker->socket = -1;
+    worker->shard  = NO_SHARD;
+}
+
+//------------------------------------------------------------------
+
+static void ReplaceWorker(Coordinator* coord, Worker* worker, error_t* error)
+{
+    assert(coord);
+    assert(worker);
+    assert(error);
+
+    if (worker->shard != NO_SHARD)
+    {
+        Shard* shard = &coord->shards[worker->shard];
+
+        shard->state = ShardState::PENDING;
+
+        if (shard->attempts >= SHARD_MAX_ATTEMPTS)
+        {
+            error->code = (int) ExpressionErrors::UNKNOWN;
+            error->data = "SHARD WORKERS CRASHED";
+        }
+    }
+
+    // dead worker is not sent stop command, it is only reaped
+    close(worker->socket);
+    kill(worker->pid, SIGKILL);
+    waitpid(worker->pid, nullptr, 0);
+
+    worker->pid    = -1;
+    worker->socket = -1;
+    worker->shard  = NO_SHARD;
+
+    if (error->code == (int) ExpressionErrors::NONE)
+        StartWorker(coord, worker, error);
+}
+
+//------------------------------------------------------------------
+
+static void AssignShards(Coordinator* coord, error_t* error)
+{
+    assert(coord);
+    assert(error);
+
+    size_t next = 0;
+
+    for (size_t i = 0; i < coord->workers_amt && error->code == (int) ExpressionErrors::NONE; i++)
+    {
+        Worker* worker = &coord->workers[i];
+
+        if (worker->shard != NO_SHARD)
+            continue;
+
+        while (next < coord->shards_amt && coord->shards[next].state != ShardState::PENDING)
+            next++;
+
+        if (next == coord->shards_amt)
+            return;
+
+        Shard*       shard   = &coord->shards[next];
+        ShardCommand command = {shard->first_row, shard->rows_amt};
+
+        shard->state = ShardState::RUNNING;
+        shard->attempts++;
+        worker->shard = (int) next;
+
+        if (!WriteAll(worker->socket, &command, sizeof(command)))
+            ReplaceWorker(coord, worker, error);
+    }
+}
+
+//------------------------------------------------------------------
+
+static void CollectReplies(Coordinator* coord, error_t* error)
+{
+    assert(coord);
+    assert(error);
+
+    nfds_t polls_amt = 0;
+
+    for (size_t i = 0; i < coord->workers_amt; i++)
+    {
+        coord->polls[i].fd      = (coord->workers[i].shard != NO_SHARD) ? coord->workers[i].socket : -1;
+        coord->polls[i].events  = POLLIN;
+        coord->polls[i].revents = 0;
+
+        if (coord->workers[i].shard != NO_SHARD)
+            polls_amt++;
+    }
+
+    if (polls_amt == 0)
+        return;
+
+    // interrupted poll is repeated by caller's loop
+    if (poll(coord->polls, coord->workers_amt, -1) <= 0)
+        return;
+
+    for (size_t i = 0; i < coord->workers_amt && error->code == (int) ExpressionErrors::NONE; i++)
+    {
+        Worker* worker = &coord->workers[i];
+
+        if (coord->polls[i].fd < 0 || coord->polls[i].revents == 0)
+            continue;
+
+        ShardReply reply = {};
+
+        // reply is read whole even if worker has closed socket after it
+        if (!ReadAll(worker->socket, &reply, sizeof(reply)))
+        {
+            ReplaceWorker(coord, worker, error);
+            continue;
+        }
+
+        if (reply.code != (int64_t) ExpressionErrors::NONE)
+        {
+            error->code = (int) reply.code;
+            error->data = "SHARD CALCULATION";
+            return;
+        }
+
+        coord->shards[worker->shard].state = ShardState::DONE;
+        coord->done_amt++;
+
+        worker->shard = NO_SHARD;
+    }
+}
+
+//------------------------------------------------------------------
+
+size_t AvailableCoresAmt()
+{
+    // affinity mask shows cores given to container, not all cores of machine
+    cpu_set_t cores = {};
+
+    if (sched_getaffinity(0, sizeof(cores), &cores) == 0 && CPU_COUNT(&cores) > 0)
+        return (size_t) CPU_COUNT(&cores);
+
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (online > 0) ? (size_t) online : 1;
+}
+
+//------------------------------------------------------------------
+
+ExpressionErrors CalculateExpressionSharded(const expr_t* expr, const char* const* diff_vars, const size_t diff_amt,
+                                            const columns_file_t* in, const columns_file_t* out,
+                                            const size_t workers_amt, error_t* error)
+{
+    assert(expr);
+    assert(in);
+    assert(out);
+    assert(error);
+
+    Coordinator coord = {};
+
+    size_t rows_amt   = in->header->rows_amt;
+
+    coord.in          = in;
+    coord.out         = out;
+    coord.vars_amt    = expr->max_vars_amt;
+    coord.workers_amt = (workers_amt > 0) ? workers_amt : AvailableCoresAmt();
+
+    // small shards balance load and make crash cheap, but every shard is one round trip
+    size_t shard_rows = rows_amt / (coord.workers_amt * SHARDS_PER_WORKER) + 1;
+    shard_rows        = (shard_rows > MIN_SHARD_ROWS) ? shard_rows : MIN_SHARD_ROWS;
+
+    coord.shards_amt  = (rows_amt + shard_rows - 1) / shard_rows;
+
+    ir_kernel_t kernel = {};
+    double*     var_values  = (double*)        calloc(coord.vars_amt + 1,    sizeof(double));
+    int*        var_columns = (int*)           calloc(coord.vars_amt + 1,    sizeof(int));
+    coord.shards            = (Shard*)         calloc(coord.shards_amt + 1,  sizeof(Shard));
+    coord.workers           = (Worker*)        calloc(coord.workers_amt,     sizeof(Worker));
+    coord.polls             = (struct pollfd*) calloc(coord.workers_amt,     sizeof(struct pollfd));
+
+    if (var_values == nullptr || var_columns == nullptr || coord.shards == nullptr || coord.workers == nullptr ||
+        coord.polls == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "SHARDS";
+    }
+    else
+        ColumnsKernelCtor(&kernel, expr, diff_vars, diff_amt, error);
+
+    if (error->code == (int) ExpressionErrors::NONE && out->header->columns_amt != kernel.ir.outputs_amt)
+    {
+        error->code = (int) ExpressionErrors::INVALID_EXPRESSION_FORMAT;
+        error->data = "COLUMNS LAYOUT";
+    }
+
+    if (error->code == (int) ExpressionErrors::NONE)
+    {
+        MatchColumnsVariables(expr, in, var_values, var_columns);
+
+        coord.ir          = &kernel.ir;
+        coord.var_values  = var_values;
+        coord.var_columns = var_columns;
+
+        for (size_t i = 0; i < coord.shards_amt; i++)
+        {
+            coord.shards[i].first_row = i * shard_rows;
+            coord.shards[i].rows_amt  = (rows_amt - i * shard_rows < shard_rows) ? rows_amt - i * shard_rows
+                                                                                  : shard_rows;
+            coord.shards[i].state     = ShardState::PENDING;
+        }
+
+        for (size_t i = 0; i < coord.workers_amt; i++)
+            coord.workers[i] = {-1, -1, NO_SHARD};
+
+        for (size_t i = 0; i < coord.workers_amt && error->code == (int) ExpressionErrors::NONE; i++)
+            StartWorker(&coord, &coord.workers[i], error);
+
+        while (coord.done_amt < coord.shards_amt && error->code == (int) ExpressionErrors::NONE)
+        {
+            AssignShards(&coord, error);
+
+            if (error->code == (int) ExpressionErrors::NONE)
+                CollectReplies(&coord, error);
+        }
+
+        for (size_t i = 0; i < coord.workers_amt; i++)
+            StopWorker(&coord.workers[i]);
+    }
+
+    IrKernelDtor(&kernel);
+    free(var_values);
+    free(var_columns);
+    free(coord.shards);
+    free(coord.workers);
+    free(coord.polls);
+
+    return (ExpressionErrors) error->code;
+}
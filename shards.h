@@ -0,0 +1,29 @@
+#ifndef __SHARDS_H_
+#define __SHARDS_H_
+
+#include "expression/expression.h"
+#include "columns.h"
+
+// ======================================================================
+// SHARDED EVALUATION
+// ======================================================================
+
+// coordinator forks local workers, sends them compiled program over unix sockets and then row ranges
+// (shards) of columns files one by one; input mapping is inherited, output mapping is shared,
+// so rows are never copied. Shard of crashed worker is given to its replacement up to
+// SHARD_MAX_ATTEMPTS times
+
+static const size_t SHARDS_PER_WORKER   = 8;
+static const size_t MIN_SHARD_ROWS      = 4096;
+static const int    SHARD_MAX_ATTEMPTS  = 3;
+
+// cores this process may run on
+size_t AvailableCoresAmt();
+
+// same as CalculateExpressionColumns, out must be created by ColumnsFileCreate (its mapping is shared);
+// workers_amt = 0 means one worker for every core available to this process
+ExpressionErrors CalculateExpressionSharded(const expr_t* expr, const char* const* diff_vars, const size_t diff_amt,
+                                            const columns_file_t* in, const columns_file_t* out,
+                                            const size_t workers_amt, error_t* error);
+
+#endif
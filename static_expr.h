@@ -0,0 +1,383 @@
+#ifndef __STATIC_EXPR_H_
+#define __STATIC_EXPR_H_
+
+#include <math.h>
+#include <type_traits>
+
+#include "expression/expression.h"
+
+// Expressions known at build time, written right in code:
+//
+//      static_expr::Var<0> x;
+//      static_expr::Var<1> y;
+//
+//      auto f  = sin(x) * exp(y);
+//      auto df = static_expr::Differentiate<0>(f);         // type of df is cos(x) * exp(y)
+//
+//      double val = static_expr::Calculate(df, expr->vars);
+//
+// Whole tree is a type, so evaluation has no dispatch and derivatives are built by compiler.
+
+// ======================================================================
+// ACTIONS
+// ======================================================================
+
+// outside of static_expr, because its sin/cos/... would hide math functions in actions
+
+template <Operators OP>
+struct StaticOperation;
+
+#define DEF_OP(name, symb, priority, arg_amt, action, ...)                                          \
+            template <>                                                                             \
+            struct StaticOperation<Operators::name>                                                 \
+            {                                                                                       \
+                static const int ARG_AMT = arg_amt;                                                 \
+                                                                                                    \
+                static inline double Action(const double NUMBER_1, const double NUMBER_2)           \
+                {                                                                                   \
+                    (void) NUMBER_1;                                                                \
+                    (void) NUMBER_2;                                                                \
+                                                                                                    \
+                    return action;                                                                  \
+                }                                                                                   \
+            };
+
+#include "operations.h"
+
+#undef DEF_OP
+
+namespace static_expr
+{
+
+// ======================================================================
+// NODES
+// ======================================================================
+
+struct Zero {};
+struct One  {};
+
+struct Const
+{
+    double val;
+};
+
+template <int ID>
+struct Var {};
+
+// left operand of unary operation
+struct None {};
+
+template <Operators OP, class L, class R>
+struct Op
+{
+    L left;
+    R right;
+};
+
+template <class E> struct IsExpr                        : std::false_type {};
+template <>        struct IsExpr<Zero>                  : std::true_type  {};
+template <>        struct IsExpr<One>                   : std::true_type  {};
+template <>        struct IsExpr<Const>                 : std::true_type  {};
+template <int ID>  struct IsExpr<Var<ID>>               : std::true_type  {};
+template <Operators OP, class L, class R>
+                   struct IsExpr<Op<OP, L, R>>          : std::true_type  {};
+
+template <class E, int ID> struct DependsOn                     : std::false_type {};
+template <int ID>          struct DependsOn<Var<ID>, ID>        : std::true_type  {};
+template <Operators OP, class L, class R, int ID>
+                           struct DependsOn<Op<OP, L, R>, ID>
+                                : std::integral_constant<bool, DependsOn<L, ID>::value || DependsOn<R, ID>::value> {};
+
+// ======================================================================
+// BUILDING
+// ======================================================================
+
+// neutral elements are folded by types, so derivatives do not grow with 0 * x and 1 * x
+
+// numbers of any arithmetic type become Const, otherwise int would pick template for expressions
+template <class N, typename std::enable_if<std::is_arithmetic<N>::value, int>::type = 0>
+constexpr Const Wrap(const N val) { return {(double) val}; }
+
+template <class E, typename std::enable_if<IsExpr<E>::value, int>::type = 0>
+constexpr E     Wrap(const E& expr) { return expr; }
+
+template <Operators OP, class L, class R>
+constexpr Op<OP, L, R> MakeOp(const L& left, const R& right)
+{
+    static_assert(StaticOperation<OP>::ARG_AMT == 2, "binary operation expected");
+
+    return {left, right};
+}
+
+template <Operators OP, class R>
+constexpr Op<OP, None, R> MakeOp(const R& right)
+{
+    static_assert(StaticOperation<OP>::ARG_AMT == 1, "unary operation expected");
+
+    return {None{}, right};
+}
+
+template <class L, class R>
+constexpr auto Add(const L& left, const R& right)
+{
+    if constexpr (std::is_same<L, Zero>::value)
+        return right;
+    else if constexpr (std::is_same<R, Zero>::value)
+        return left;
+    else
+        return MakeOp<Operators::ADD>(left, right);
+}
+
+template <class L, class R>
+constexpr auto Sub(const L& left, const R& right)
+{
+    if constexpr (std::is_same<R, Zero>::value)
+        return left;
+    else if constexpr (std::is_same<L, Zero>::value)
+        return MakeOp<Operators::MUL>(Const{-1}, right);
+    else
+        return MakeOp<Operators::SUB>(left, right);
+}
+
+template <class L, class R>
+constexpr auto Mul(const L& left, const R& right)
+{
+    if constexpr (std::is_same<L, Zero>::value || std::is_same<R, Zero>::value)
+        return Zero{};
+    else if constexpr (std::is_same<L, One>::value)
+        return right;
+    else if constexpr (std::is_same<R, One>::value)
+        return left;
+    else
+        return MakeOp<Operators::MUL>(left, right);
+}
+
+template <class L, class R>
+constexpr auto Div(const L& left, const R& right)
+{
+    if constexpr (std::is_same<L, Zero>::value)
+        return Zero{};
+    else if constexpr (std::is_same<R, One>::value)
+        return left;
+    else
+        return MakeOp<Operators::DIV>(left, right);
+}
+
+template <class L, class R>
+constexpr auto Deg(const L& left, const R& right)
+{
+    if constexpr (std::is_same<R, Zero>::value)
+        return One{};
+    else if constexpr (std::is_same<R, One>::value)
+        return left;
+    else
+        return MakeOp<Operators::DEG>(left, right);
+}
+
+// ======================================================================
+// FRONTEND
+// ======================================================================
+
+// operands may be doubles, but at least one of them has to be an expression
+
+template <class L, class R>
+using EnableIfExpr = typename std::enable_if<IsExpr<L>::value || IsExpr<R>::value, int>::type;
+
+template <class L, class R, EnableIfExpr<L, R> = 0>
+constexpr auto operator+(const L& left, const R& right) { return Add(Wrap(left), Wrap(right)); }
+
+template <class L, class R, EnableIfExpr<L, R> = 0>
+constexpr auto operator-(const L& left, const R& right) { return Sub(Wrap(left), Wrap(right)); }
+
+template <class L, class R, EnableIfExpr<L, R> = 0>
+constexpr auto operator*(const L& left, const R& right) { return Mul(Wrap(left), Wrap(right)); }
+
+template <class L, class R, EnableIfExpr<L, R> = 0>
+constexpr auto operator/(const L& left, const R& right) { return Div(Wrap(left), Wrap(right)); }
+
+template <class L, class R, EnableIfExpr<L, R> = 0>
+constexpr auto pow(const L& left, const R& right)       { return Deg(Wrap(left), Wrap(right)); }
+
+template <class E, EnableIfExpr<E, E> = 0>
+constexpr auto operator-(const E& expr) { return Mul(Const{-1}, expr); }
+
+#define STATIC_EXPR_UNARY(func, name)                                                   \
+            template <class E, EnableIfExpr<E, E> = 0>                                  \
+            constexpr auto func(const E& expr) { return MakeOp<Operators::name>(expr); }
+
+STATIC_EXPR_UNARY(ln,       LN)
+STATIC_EXPR_UNARY(exp,      EXP)
+STATIC_EXPR_UNARY(sin,      SIN)
+STATIC_EXPR_UNARY(cos,      COS)
+STATIC_EXPR_UNARY(cot,      COT)
+STATIC_EXPR_UNARY(tan,      TAN)
+STATIC_EXPR_UNARY(arcsin,   ARCSIN)
+STATIC_EXPR_UNARY(arccos,   ARCCOS)
+STATIC_EXPR_UNARY(arccot,   ARCCOT)
+STATIC_EXPR_UNARY(arctan,   ARCTAN)
+
+#undef STATIC_EXPR_UNARY
+
+static_assert(std::is_same<decltype(Var<0>{} * 2), Op<Operators::MUL, Var<0>, Const>>::value &&
+              std::is_same<decltype(1 + Var<0>{}), Op<Operators::ADD, Const, Var<0>>>::value &&
+              std::is_same<decltype(pow(Var<0>{}, 3u)), Op<Operators::DEG, Var<0>, Const>>::value,
+              "integer operands are constants");
+
+// ======================================================================
+// EVALUATION
+// ======================================================================
+
+inline double Calculate(const Zero&,      const variable_t*)        { return 0; }
+inline double Calculate(const One&,       const variable_t*)        { return 1; }
+inline double Calculate(const None&,      const variable_t*)        { return 0; }
+inline double Calculate(const Const& num, const variable_t*)        { return num.val; }
+
+template <int ID>
+inline double Calculate(const Var<ID>&,   const variable_t* vars)   { return vars[ID].value; }
+
+template <Operators OP, class L, class R>
+inline double Calculate(const Op<OP, L, R>& expr, const variable_t* vars)
+{
+    return StaticOperation<OP>::Action(Calculate(expr.left, vars), Calculate(expr.right, vars));
+}
+
+// ======================================================================
+// DIFFERENTIATION
+// ======================================================================
+
+// same rules as in operations.h
+
+template <int ID>                           constexpr Zero Differentiate(const Zero&);
+template <int ID>                           constexpr Zero Differentiate(const One&);
+template <int ID>                           constexpr Zero Differentiate(const Const&);
+template <int ID, int VAR_ID>               constexpr auto Differentiate(const Var<VAR_ID>&);
+template <int ID, Operators OP, class L, class R>
+                                            constexpr auto Differentiate(const Op<OP, L, R>& expr);
+
+template <int ID> constexpr Zero Differentiate(const Zero&)     { return {}; }
+template <int ID> constexpr Zero Differentiate(const One&)      { return {}; }
+template <int ID> constexpr Zero Differentiate(const Const&)    { return {}; }
+
+template <int ID, int VAR_ID>
+constexpr auto Differentiate(const Var<VAR_ID>&)
+{
+    if constexpr (ID == VAR_ID)
+        return One{};
+    else
+        return Zero{};
+}
+
+template <int ID, Operators OP, class L, class R>
+constexpr auto Differentiate(const Op<OP, L, R>& expr)
+{
+    const L& l = expr.left;
+    const R& r = expr.right;
+
+    if constexpr (!DependsOn<Op<OP, L, R>, ID>::value)
+        return Zero{};
+    else if constexpr (OP == Operators::ADD)
+        return Add(Differentiate<ID>(l), Differentiate<ID>(r));
+    else if constexpr (OP == Operators::SUB)
+        return Sub(Differentiate<ID>(l), Differentiate<ID>(r));
+    else if constexpr (OP == Operators::MUL)
+        return Add(Mul(Differentiate<ID>(l), r), Mul(l, Differentiate<ID>(r)));
+    else if constexpr (OP == Operators::DIV)
+        return Div(Sub(Mul(Differentiate<ID>(l), r), Mul(l, Differentiate<ID>(r))), Deg(r, Const{2}));
+    else if constexpr (OP == Operators::DEG)
+    {
+        if constexpr (DependsOn<L, ID>::value && DependsOn<R, ID>::value)
+            return Mul(Add(Mul(Differentiate<ID>(r), ln(l)), Mul(r, Div(Differentiate<ID>(l), l))), expr);
+        else if constexpr (DependsOn<L, ID>::value)
+            return Mul(Differentiate<ID>(l), Mul(r, Deg(l, Sub(r, Const{1}))));
+        else
+            return Mul(Differentiate<ID>(r), Mul(ln(l), expr));
+    }
+    else if constexpr (OP == Operators::LN)
+        return Mul(Differentiate<ID>(r), Div(Const{1}, r));
+    else if constexpr (OP == Operators::EXP)
+        return Mul(Differentiate<ID>(r), expr);
+    else if constexpr (OP == Operators::SIN)
+        return Mul(Differentiate<ID>(r), cos(r));
+    else if constexpr (OP == Operators::COS)
+        return Mul(Const{-1}, Mul(Differentiate<ID>(r), sin(r)));
+    else if constexpr (OP == Operators::COT)
+        return Mul(Const{-1}, Mul(Differentiate<ID>(r), Div(Const{1}, Deg(sin(r), Const{2}))));
+    else if constexpr (OP == Operators::TAN)
+        return Mul(Differentiate<ID>(r), Div(Const{1}, Deg(cos(r), Const{2})));
+    else if constexpr (OP == Operators::ARCSIN)
+        return Mul(Differentiate<ID>(r), Deg(Sub(Const{1}, Deg(r, Const{2})), Const{-0.5}));
+    else if constexpr (OP == Operators::ARCCOS)
+        return Mul(Const{-1}, Mul(Differentiate<ID>(r), Deg(Sub(Const{1}, Deg(r, Const{2})), Const{-0.5})));
+    else if constexpr (OP == Operators::ARCCOT)
+        return Mul(Differentiate<ID>(r), Div(Const{-1}, Add(Const{1}, Deg(r, Const{2}))));
+    else if constexpr (OP == Operators::ARCTAN)
+        return Mul(Differentiate<ID>(r), Div(Const{1}, Add(Const{1}, Deg(r, Const{2}))));
+    else
+        static_assert(OP != OP, "no differentiation rule for operation");
+}
+
+// ======================================================================
+// RUNTIME BRIDGE
+// ======================================================================
+
+// nullptr if allocation failed, partially built subtree is freed
+
+inline Node* MakeTree(const None&)          { return nullptr; }
+inline Node* MakeTree(const Zero&)          { return MakeNode(NodeType::NUMBER, {.val = 0}); }
+inline Node* MakeTree(const One&)           { return MakeNode(NodeType::NUMBER, {.val = 1}); }
+inline Node* MakeTree(const Const& num)     { return MakeNode(NodeType::NUMBER, {.val = num.val}); }
+
+template <int ID>
+inline Node* MakeTree(const Var<ID>&)       { return MakeNode(NodeType::VARIABLE, {.var = ID}); }
+
+template <Operators OP, class L, class R>
+inline Node* MakeTree(const Op<OP, L, R>& expr)
+{
+    Node* left  = MakeTree(expr.left);
+    Node* right = MakeTree(expr.right);
+
+    if ((left == nullptr && !std::is_same<L, None>::value) || right == nullptr)
+    {
+        if (left)  DestructNodes(left);
+        if (right) DestructNodes(right);
+
+        return nullptr;
+    }
+
+    Node* node = MakeNode(NodeType::OPERATOR, {.opt = OP}, left, right);
+    if (node == nullptr)
+    {
+        if (left) DestructNodes(left);
+        DestructNodes(right);
+    }
+
+    return node;
+}
+
+// replaces tree of expr; Var<ID> becomes variable with id ID, so names have to be saved in expr->vars
+// by caller in the same order
+template <class E>
+inline ExpressionErrors ToExpression(expr_t* expr, const E& templ, error_t* error)
+{
+    assert(expr);
+    assert(error);
+
+    Node* root = MakeTree(templ);
+    if (root == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "STATIC EXPRESSION TREE";
+        return ExpressionErrors::ALLOCATE_MEMORY;
+    }
+
+    if (expr->root)
+        DestructNodes(expr->root);
+
+    expr->root = root;
+
+    return ExpressionErrors::NONE;
+}
+
+}
+
+#endif
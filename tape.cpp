@@ -0,0 +1,276 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tape.h"
+#include "calculation.h"
+
+static void     MarkActive(tape_t* tape);
+static void     SweepForward(tape_t* tape, const double* direction, error_t* error);
+static void     SweepBackward(tape_t* tape, const double* weights, const size_t weights_amt, double* product,
+                              error_t* error);
+
+//------------------------------------------------------------------
+
+ExpressionErrors TapeCtor(tape_t* tape, const expr_t* expr, error_t* error)
+{
+    assert(tape);
+    assert(expr);
+    assert(error);
+
+    return TapeCtor(tape, &expr, 1, error);
+}
+
+//------------------------------------------------------------------
+
+ExpressionErrors TapeCtor(tape_t* tape, const expr_t* const* exprs, const size_t exprs_amt, error_t* error)
+{
+    assert(tape);
+    assert(exprs);
+    assert(error);
+
+    *tape = {};
+
+    if (IrKernelCtor(&tape->kernel, exprs, exprs_amt, error) != ExpressionErrors::NONE)
+        return (ExpressionErrors) error->code;
+
+    for (size_t i = 0; i < exprs_amt; i++)
+    {
+        if (exprs[i]->max_vars_amt > tape->vars_amt)
+            tape->vars_amt = exprs[i]->max_vars_amt;
+    }
+
+    tape->active   = (bool*)   calloc(tape->kernel.ir.size + 1, sizeof(bool));
+    tape->adjoints = (double*) calloc(tape->kernel.ir.size + 1, sizeof(double));
+    tape->tangents = (double*) calloc(tape->kernel.ir.size + 1, sizeof(double));
+    tape->results  = (double*) calloc(exprs_amt + 1, sizeof(double));
+
+    if (tape->active == nullptr || tape->adjoints == nullptr || tape->tangents == nullptr ||
+        tape->results == nullptr)
+    {
+        TapeDtor(tape);
+
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "TAPE";
+        return ExpressionErrors::ALLOCATE_MEMORY;
+    }
+
+    MarkActive(tape);
+
+    return ExpressionErrors::NONE;
+}
+
+//------------------------------------------------------------------
+
+void TapeDtor(tape_t* tape)
+{
+    assert(tape);
+
+    IrKernelDtor(&tape->kernel);
+    free(tape->active);
+    free(tape->adjoints);
+    free(tape->tangents);
+    free(tape->results);
+
+    *tape = {};
+}
+
+//------------------------------------------------------------------
+
+static void MarkActive(tape_t* tape)
+{
+    assert(tape);
+
+    const ir_t* ir = &tape->kernel.ir;
+
+    for (size_t i = 0; i < ir->size; i++)
+    {
+        const IrInstruction* instr = &ir->code[i];
+
+        switch (instr->type)
+        {
+            case (NodeType::VARIABLE):
+                tape->active[i] = true;
+                break;
+
+            case (NodeType::OPERATOR):
+                tape->active[i] = (instr->left  != NO_IR_VALUE && tape->active[instr->left]) ||
+                                  (instr->right != NO_IR_VALUE && tape->active[instr->right]);
+                break;
+
+            case (NodeType::NUMBER):
+            case (NodeType::POISON):
+            default:
+                tape->active[i] = false;
+                break;
+        }
+    }
+}
+
+//------------------------------------------------------------------
+
+// tangent of variable is its component of direction, operands with zero tangent give no term
+static void SweepForward(tape_t* tape, const double* direction, error_t* error)
+{
+    assert(tape);
+    assert(direction);
+    assert(error);
+
+    const ir_t*   ir       = &tape->kernel.ir;
+    const double* values   = tape->kernel.values;
+    double*       tangents = tape->tangents;
+
+    for (size_t i = 0; i < ir->size; i++)
+    {
+        const IrInstruction* instr = &ir->code[i];
+
+        tangents[i] = 0;
+
+        if (instr->type == NodeType::VARIABLE)
+        {
+            tangents[i] = direction[instr->value.var];
+            continue;
+        }
+
+        if (!tape->active[i] || instr->type != NodeType::OPERATOR)
+            continue;
+
+        double left  = (instr->left  != NO_IR_VALUE) ? values[instr->left]  : 0;
+        double right = (instr->right != NO_IR_VALUE) ? values[instr->right] : 0;
+
+        if (instr->left != NO_IR_VALUE && fpclassify(tangents[instr->left]) != FP_ZERO)
+            tangents[i] += tangents[instr->left]  * CalculatePartial(left, right, values[i], instr->value.opt,
+                                                                     NodeKid::LEFT, error);
+        if (instr->right != NO_IR_VALUE && fpclassify(tangents[instr->right]) != FP_ZERO)
+            tangents[i] += tangents[instr->right] * CalculatePartial(left, right, values[i], instr->value.opt,
+                                                                     NodeKid::RIGHT, error);
+    }
+}
+
+//------------------------------------------------------------------
+
+// every output is seeded with its weight, so one pass gives their weighted sum;
+// partials are taken only by active operands, so constant exponent does not need log of base
+static void SweepBackward(tape_t* tape, const double* weights, const size_t weights_amt, double* product,
+                          error_t* error)
+{
+    assert(tape);
+    assert(weights);
+    assert(product);
+    assert(error);
+
+    const ir_t*   ir       = &tape->kernel.ir;
+    const double* values   = tape->kernel.values;
+    double*       adjoints = tape->adjoints;
+
+    memset(adjoints, 0, ir->size * sizeof(double));
+    memset(product,  0, tape->vars_amt * sizeof(double));
+
+    int last = NO_IR_VALUE;
+
+    for (size_t k = 0; k < weights_amt; k++)
+    {
+        int output = ir->outputs[k];
+        if (output == NO_IR_VALUE)
+            continue;
+
+        adjoints[output] += weights[k];
+
+        if (output > last)
+            last = output;
+    }
+
+    for (size_t i = (size_t) (last + 1); i-- > 0; )
+    {
+        const IrInstruction* instr = &ir->code[i];
+
+        if (!tape->active[i] || fpclassify(adjoints[i]) == FP_ZERO)
+            continue;
+
+        if (instr->type == NodeType::VARIABLE)
+        {
+            product[instr->value.var] += adjoints[i];
+            continue;
+        }
+
+        double left  = (instr->left  != NO_IR_VALUE) ? values[instr->left]  : 0;
+        double right = (instr->right != NO_IR_VALUE) ? values[instr->right] : 0;
+
+        if (instr->left != NO_IR_VALUE && tape->active[instr->left])
+            adjoints[instr->left]  += adjoints[i] * CalculatePartial(left, right, values[i], instr->value.opt,
+                                                                     NodeKid::LEFT, error);
+        if (instr->right != NO_IR_VALUE && tape->active[instr->right])
+            adjoints[instr->right] += adjoints[i] * CalculatePartial(left, right, values[i], instr->value.opt,
+                                                                     NodeKid::RIGHT, error);
+
+        if (error->code != (int) ExpressionErrors::NONE)
+            return;
+    }
+}
+
+//------------------------------------------------------------------
+
+double CalculateGradient(tape_t* tape, const variable_t* vars, double* gradient, error_t* error)
+{
+    assert(tape);
+    assert(vars);
+    assert(gradient);
+    assert(error);
+
+    double weight = 1;
+
+    memset(gradient, 0, tape->vars_amt * sizeof(double));
+
+    IrKernelCalculate(&tape->kernel, vars, tape->results, error);
+    if (error->code != (int) ExpressionErrors::NONE)
+        return POISON;
+
+    SweepBackward(tape, &weight, 1, gradient, error);
+
+    return tape->results[0];
+}
+
+//------------------------------------------------------------------
+
+void CalculateJvp(tape_t* tape, const variable_t* vars, const double* direction,
+                  double* values, double* product, error_t* error)
+{
+    assert(tape);
+    assert(vars);
+    assert(direction);
+    assert(values);
+    assert(product);
+    assert(error);
+
+    IrKernelCalculate(&tape->kernel, vars, values, error);
+    if (error->code != (int) ExpressionErrors::NONE)
+        return;
+
+    SweepForward(tape, direction, error);
+    if (error->code != (int) ExpressionErrors::NONE)
+        return;
+
+    const ir_t* ir = &tape->kernel.ir;
+
+    for (size_t k = 0; k < ir->outputs_amt; k++)
+        product[k] = (ir->outputs[k] != NO_IR_VALUE) ? tape->tangents[ir->outputs[k]] : 0;
+}
+
+//------------------------------------------------------------------
+
+void CalculateVjp(tape_t* tape, const variable_t* vars, const double* weights,
+                  double* values, double* product, error_t* error)
+{
+    assert(tape);
+    assert(vars);
+    assert(weights);
+    assert(values);
+    assert(product);
+    assert(error);
+
+    IrKernelCalculate(&tape->kernel, vars, values, error);
+    if (error->code != (int) ExpressionErrors::NONE)
+        return;
+
+    SweepBackward(tape, weights, tape->kernel.ir.outputs_amt, product, error);
+}
@@ -0,0 +1,44 @@
+#ifndef __TAPE_H_
+#define __TAPE_H_
+
+#include "expression/expression.h"
+#include "ir.h"
+
+// ======================================================================
+// REVERSE MODE
+// ======================================================================
+
+// expression is recorded once as optimized IR program; every calculation is forward pass that keeps
+// value of every instruction and backward pass in reverse program order that accumulates adjoints
+// with operator partials, so gradient by all variables costs a few evaluations
+
+struct Tape
+{
+    ir_kernel_t     kernel;             // values of the last forward pass
+    bool*           active;             // instruction depends on some variable
+    double*         adjoints;
+    double*         tangents;
+    double*         results;            // of every expression
+    size_t          vars_amt;
+};
+typedef struct Tape tape_t;
+
+ExpressionErrors    TapeCtor(tape_t* tape, const expr_t* expr, error_t* error);
+// several expressions over the same variables, subtrees they share are recorded once
+ExpressionErrors    TapeCtor(tape_t* tape, const expr_t* const* exprs, const size_t exprs_amt, error_t* error);
+void                TapeDtor(tape_t* tape);
+
+// returns value of (first) expression, gradient gets derivative by every variable (vars_amt, indexed
+// like vars); tape can be reused for any amount of points
+double              CalculateGradient(tape_t* tape, const variable_t* vars, double* gradient, error_t* error);
+
+// directional derivatives without Jacobian: values gets every expression, product gets J * direction
+// (one per expression) from forward pass that carries tangents along with values
+void                CalculateJvp(tape_t* tape, const variable_t* vars, const double* direction,
+                                 double* values, double* product, error_t* error);
+
+// product gets weights^T * J (vars_amt) from one backward pass seeded with weights of expressions
+void                CalculateVjp(tape_t* tape, const variable_t* vars, const double* weights,
+                                 double* values, double* product, error_t* error);
+
+#endif
@@ -0,0 +1,475 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "taylor.h"
+#include "ir.h"
+
+// series of (var - point): s[k] is coefficient of (var - point)^k, every array has amt = order + 1 of them
+
+struct TaylorProgram
+{
+    const ir_t*         ir;
+    const variable_t*   vars;
+    int                 var_id;
+    double              point;
+    size_t              amt;
+
+    bool*               active;         // depends on var, otherwise series is a constant
+    double*             series;         // amt for every instruction
+    double*             scratch;        // TAYLOR_SCRATCH_AMT arrays of amt
+    double*             zeros;          // operand of unary operators
+};
+
+static const size_t TAYLOR_SCRATCH_AMT = 3;
+
+static void     SeriesMul(const double* u, const double* v, double* w, const size_t amt);
+static void     SeriesDiv(const double* u, const double* v, double* w, const size_t amt);
+static void     SeriesExp(const double* u, double* w, const size_t amt);
+static void     SeriesLog(const double* u, double* w, const size_t amt);
+static void     SeriesSinCos(const double* u, double* s, double* c, const size_t amt);
+static void     SeriesTan(const double* u, double* w, double* q, const double sign, const size_t amt);
+static void     SeriesSqrt(const double* p, double* s, const size_t amt);
+static void     SeriesIntegrate(const double* u, const double* q, const double w_0, double* w, double* tmp,
+                                const size_t amt);
+static void     SeriesPow(const double* u, const double a, double* w, const size_t amt);
+static void     SeriesIntPow(const double* u, unsigned long a, double* w, double* base, double* tmp,
+                             const size_t amt);
+
+static bool     IsSmallNonNegativeInteger(const double a);
+
+static void     CalculateSeriesOperation(TaylorProgram* prog, const IrInstruction* instr, double* w,
+                                         error_t* error);
+
+//------------------------------------------------------------------
+
+static void SeriesMul(const double* u, const double* v, double* w, const size_t amt)
+{
+    for (size_t k = 0; k < amt; k++)
+    {
+        double sum = 0;
+
+        for (size_t j = 0; j <= k; j++)
+            sum += u[j] * v[k - j];
+
+        w[k] = sum;
+    }
+}
+
+//------------------------------------------------------------------
+
+static void SeriesDiv(const double* u, const double* v, double* w, const size_t amt)
+{
+    for (size_t k = 0; k < amt; k++)
+    {
+        double sum = u[k];
+
+        for (size_t j = 1; j <= k; j++)
+            sum -= v[j] * w[k - j];
+
+        w[k] = sum / v[0];
+    }
+}
+
+//------------------------------------------------------------------
+
+// w' = u' w
+static void SeriesExp(const double* u, double* w, const size_t amt)
+{
+    w[0] = exp(u[0]);
+
+    for (size_t k = 1; k < amt; k++)
+    {
+        double sum = 0;
+
+        for (size_t j = 1; j <= k; j++)
+            sum += (double) j * u[j] * w[k - j];
+
+        w[k] = sum / (double) k;
+    }
+}
+
+//------------------------------------------------------------------
+
+// u w' = u'
+static void SeriesLog(const double* u, double* w, const size_t amt)
+{
+    w[0] = log(u[0]);
+
+    for (size_t k = 1; k < amt; k++)
+    {
+        double sum = 0;
+
+        for (size_t j = 1; j < k; j++)
+            sum += (double) j * w[j] * u[k - j];
+
+        w[k] = (u[k] - sum / (double) k) / u[0];
+    }
+}
+
+//------------------------------------------------------------------
+
+// s' = u' c, c' = -u' s
+static void SeriesSinCos(const double* u, double* s, double* c, const size_t amt)
+{
+    s[0] = sin(u[0]);
+    c[0] = cos(u[0]);
+
+    for (size_t k = 1; k < amt; k++)
+    {
+        double sin_sum = 0;
+        double cos_sum = 0;
+
+        for (size_t j = 1; j <= k; j++)
+        {
+            sin_sum += (double) j * u[j] * c[k - j];
+            cos_sum += (double) j * u[j] * s[k - j];
+        }
+
+        s[k] =  sin_sum / (double) k;
+        c[k] = -cos_sum / (double) k;
+    }
+}
+
+//------------------------------------------------------------------
+
+// w' = sign * u' q, q = 1 + w^2; tan has sign 1, cot has -1
+static void SeriesTan(const double* u, double* w, double* q, const double sign, const size_t amt)
+{
+    w[0] = (sign > 0) ? tan(u[0]) : 1 / tan(u[0]);
+    q[0] = 1 + w[0] * w[0];
+
+    for (size_t k = 1; k < amt; k++)
+    {
+        double sum = 0;
+
+        for (size_t j = 1; j <= k; j++)
+            sum += (double) j * u[j] * q[k - j];
+
+        w[k] = sign * sum / (double) k;
+
+        double square = 0;
+        for (size_t j = 0; j <= k; j++)
+            square += w[j] * w[k - j];
+
+        q[k] = square;
+    }
+}
+
+//------------------------------------------------------------------
+
+static void SeriesSqrt(const double* p, double* s, const size_t amt)
+{
+    s[0] = sqrt(p[0]);
+
+    for (size_t k = 1; k < amt; k++)
+    {
+        double sum = p[k];
+
+        for (size_t j = 1; j < k; j++)
+            sum -= s[j] * s[k - j];
+
+        s[k] = sum / (2 * s[0]);
+    }
+}
+
+//------------------------------------------------------------------
+
+// w' = u' / q, w(point) = w_0
+static void SeriesIntegrate(const double* u, const double* q, const double w_0, double* w, double* tmp,
+                            const size_t amt)
+{
+    // tmp gets u', w + 1 gets u' / q shifted by one
+    for (size_t k = 0; k + 1 < amt; k++)
+        tmp[k] = (double) (k + 1) * u[k + 1];
+
+    SeriesDiv(tmp, q, w + 1, amt - 1);
+
+    w[0] = w_0;
+    for (size_t k = 1; k < amt; k++)
+        w[k] /= (double) k;
+}
+
+//------------------------------------------------------------------
+
+// u w' = a u' w, base must not vanish at point
+static void SeriesPow(const double* u, const double a, double* w, const size_t amt)
+{
+    w[0] = pow(u[0], a);
+
+    for (size_t k = 1; k < amt; k++)
+    {
+        double sum = 0;
+
+        for (size_t j = 1; j <= k; j++)
+            sum += ((a + 1) * (double) j - (double) k) * u[j] * w[k - j];
+
+        w[k] = sum / ((double) k * u[0]);
+    }
+}
+
+//------------------------------------------------------------------
+
+// for base vanishing at point, by squaring
+static void SeriesIntPow(const double* u, unsigned long a, double* w, double* base, double* tmp,
+                         const size_t amt)
+{
+    memcpy(base, u, amt * sizeof(double));
+    memset(w, 0, amt * sizeof(double));
+    w[0] = 1;
+
+    while (a > 0)
+    {
+        if (a & 1)
+        {
+            SeriesMul(w, base, tmp, amt);
+            memcpy(w, tmp, amt * sizeof(double));
+        }
+
+        a >>= 1;
+
+        if (a > 0)
+        {
+            SeriesMul(base, base, tmp, amt);
+            memcpy(base, tmp, amt * sizeof(double));
+        }
+    }
+}
+
+//------------------------------------------------------------------
+
+static bool IsSmallNonNegativeInteger(const double a)
+{
+    return a >= 0 && a <= (double) UINT32_MAX && fpclassify(a - floor(a)) == FP_ZERO;
+}
+
+//------------------------------------------------------------------
+
+static void CalculateSeriesOperation(TaylorProgram* prog, const IrInstruction* instr, double* w, error_t* error)
+{
+    assert(prog);
+    assert(instr);
+    assert(w);
+    assert(error);
+
+    size_t  amt     = prog->amt;
+    double* tmp_1   = prog->scratch;
+    double* tmp_2   = prog->scratch + amt;
+    double* tmp_3   = prog->scratch + 2 * amt;
+
+    const double* u = (instr->left  != NO_IR_VALUE) ? prog->series + (size_t) instr->left  * amt : prog->zeros;
+    const double* v = (instr->right != NO_IR_VALUE) ? prog->series + (size_t) instr->right * amt : prog->zeros;
+
+
+    // unary operators take right operand
+    switch (instr->value.opt)
+    {
+        case (Operators::ADD):
+            for (size_t k = 0; k < amt; k++)
+                w[k] = u[k] + v[k];
+            break;
+
+        case (Operators::SUB):
+            for (size_t k = 0; k < amt; k++)
+                w[k] = u[k] - v[k];
+            break;
+
+        case (Operators::MUL):
+            SeriesMul(u, v, w, amt);
+            break;
+
+        case (Operators::DIV):
+            SeriesDiv(u, v, w, amt);
+            break;
+
+        case (Operators::DEG):
+            if (instr->right == NO_IR_VALUE || !prog->active[instr->right])
+            {
+                if (fpclassify(u[0]) == FP_ZERO && IsSmallNonNegativeInteger(v[0]))
+                    SeriesIntPow(u, (unsigned long) v[0], w, tmp_1, tmp_2, amt);
+                else
+                    SeriesPow(u, v[0], w, amt);
+            }
+            else
+            {
+                // u^v = exp(v ln u)
+                SeriesLog(u, tmp_1, amt);
+                SeriesMul(tmp_1, v, tmp_2, amt);
+                SeriesExp(tmp_2, w, amt);
+            }
+            break;
+
+        case (Operators::LN):
+            SeriesLog(v, w, amt);
+            break;
+
+        case (Operators::EXP):
+            SeriesExp(v, w, amt);
+            break;
+
+        case (Operators::SIN):
+            SeriesSinCos(v, w, tmp_1, amt);
+            break;
+
+        case (Operators::COS):
+            SeriesSinCos(v, tmp_1, w, amt);
+            break;
+
+        case (Operators::TAN):
+            SeriesTan(v, w, tmp_1, 1, amt);
+            break;
+
+        case (Operators::COT):
+            SeriesTan(v, w, tmp_1, -1, amt);
+            break;
+
+        case (Operators::ARCSIN):
+        case (Operators::ARCCOS):
+        {
+            // arcsin' = u' / sqrt(1 - u^2)
+            SeriesMul(v, v, tmp_1, amt);
+            for (size_t k = 0; k < amt; k++)
+                tmp_1[k] = -tmp_1[k];
+            tmp_1[0] += 1;
+
+            SeriesSqrt(tmp_1, tmp_2, amt);
+            SeriesIntegrate(v, tmp_2, asin(v[0]), w, tmp_3, amt);
+
+            if (instr->value.opt == Operators::ARCCOS)
+            {
+                for (size_t k = 1; k < amt; k++)
+                    w[k] = -w[k];
+                w[0] = acos(v[0]);
+            }
+            break;
+        }
+
+        case (Operators::ARCTAN):
+        case (Operators::ARCCOT):
+        {
+            // arctan' = u' / (1 + u^2)
+            SeriesMul(v, v, tmp_1, amt);
+            tmp_1[0] += 1;
+
+            SeriesIntegrate(v, tmp_1, atan(v[0]), w, tmp_2, amt);
+
+            if (instr->value.opt == Operators::ARCCOT)
+            {
+                for (size_t k = 1; k < amt; k++)
+                    w[k] = -w[k];
+                w[0] = M_PI / 2 - atan(v[0]);
+            }
+            break;
+        }
+
+        case (Operators::OPENING_BRACKET):
+        case (Operators::CLOSING_BRACKET):
+        case (Operators::END):
+        case (Operators::UNKNOWN):
+        default:
+            error->code = (int) ExpressionErrors::UNKNOWN_OPERATION;
+            break;
+    }
+}
+
+//------------------------------------------------------------------
+
+ExpressionErrors CalculateTaylorCoefficients(const expr_t* expr, const variable_t* vars, const char* var,
+                                             const double point, const size_t order, double* coeffs,
+                                             error_t* error)
+{
+    assert(expr);
+    assert(vars);
+    assert(var);
+    assert(coeffs);
+    assert(error);
+
+    int var_id = FindVariableAmongSaved(expr->vars, var);
+    if (var_id == NO_VARIABLE)
+    {
+        error->code = (int) ExpressionErrors::NO_DIFF_VARIABLE;
+        error->data = var;
+        return ExpressionErrors::NO_DIFF_VARIABLE;
+    }
+
+    ir_kernel_t   kernel = {};
+    TaylorProgram prog   = {};
+
+    if (IrKernelCtor(&kernel, &expr, 1, error) != ExpressionErrors::NONE)
+        return (ExpressionErrors) error->code;
+
+    const ir_t* ir = &kernel.ir;
+
+    prog.ir      = ir;
+    prog.vars    = vars;
+    prog.var_id  = var_id;
+    prog.point   = point;
+    prog.amt     = order + 1;
+    prog.active  = (bool*)   calloc(ir->size + 1, sizeof(bool));
+    prog.series  = (double*) calloc((ir->size + 1) * prog.amt, sizeof(double));
+    prog.scratch = (double*) calloc(TAYLOR_SCRATCH_AMT * prog.amt, sizeof(double));
+    prog.zeros   = (double*) calloc(prog.amt, sizeof(double));
+
+    if (prog.active == nullptr || prog.series == nullptr || prog.scratch == nullptr || prog.zeros == nullptr)
+    {
+        error->code = (int) ExpressionErrors::ALLOCATE_MEMORY;
+        error->data = "TAYLOR SERIES";
+    }
+
+    for (size_t i = 0; i < ir->size && error->code == (int) ExpressionErrors::NONE; i++)
+    {
+        const IrInstruction* instr = &ir->code[i];
+        double*              w     = prog.series + i * prog.amt;
+
+        switch (instr->type)
+        {
+            case (NodeType::NUMBER):
+                w[0] = instr->value.val;
+                break;
+
+            case (NodeType::VARIABLE):
+                if (instr->value.var == var_id)
+                {
+                    prog.active[i] = true;
+
+                    w[0] = point;
+                    if (prog.amt > 1)
+                        w[1] = 1;
+                }
+                else
+                    w[0] = vars[instr->value.var].value;
+                break;
+
+            case (NodeType::OPERATOR):
+                prog.active[i] = (instr->left  != NO_IR_VALUE && prog.active[instr->left]) ||
+                                 (instr->right != NO_IR_VALUE && prog.active[instr->right]);
+
+                CalculateSeriesOperation(&prog, instr, w, error);
+                break;
+
+            case (NodeType::POISON):
+            default:
+                error->code = (int) ExpressionErrors::INVALID_EXPRESSION_FORMAT;
+                break;
+        }
+    }
+
+    if (error->code == (int) ExpressionErrors::NONE)
+    {
+        int output = ir->outputs[0];
+
+        if (output != NO_IR_VALUE)
+            memcpy(coeffs, prog.series + (size_t) output * prog.amt, prog.amt * sizeof(double));
+        else
+            memset(coeffs, 0, prog.amt * sizeof(double));
+    }
+
+    free(prog.active);
+    free(prog.series);
+    free(prog.scratch);
+    free(prog.zeros);
+    IrKernelDtor(&kernel);
+
+    return (ExpressionErrors) error->code;
+}
@@ -0,0 +1,23 @@
+#ifndef __TAYLOR_H_
+#define __TAYLOR_H_
+
+#include "expression/expression.h"
+
+// ======================================================================
+// TAYLOR MODE
+// ======================================================================
+
+// every IR instruction gets truncated power series in (var - point) instead of one value;
+// operators use the usual recurrences (products are convolutions, exp/ln/sin/cos/tan/arc* and pow
+// are found from their differential equations), so order n costs O(n^2) per instruction
+
+// TaylorSeries prints symbolic derivatives up to this order; its coefficients of every order
+// are found by CalculateTaylorCoefficients
+static const int TAYLOR_SYMBOLIC_MAX_ORDER = 4;
+
+// coeffs gets order + 1 Taylor coefficients f^(k)(point) / k!, other variables are taken from vars
+ExpressionErrors CalculateTaylorCoefficients(const expr_t* expr, const variable_t* vars, const char* var,
+                                             const double point, const size_t order, double* coeffs,
+                                             error_t* error);
+
+#endif